@@ -1,188 +1,195 @@
-/****************************************************************************
-**
-** OpenSCAD (www.openscad.org)
-** Copyright (C) 2009-2011 Clifford Wolf <clifford@clifford.at> and
-**                         Marius Kintel <marius@kintel.net>
-** Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
-** All rights reserved.
-** Contact: Nokia Corporation (qt-info@nokia.com)
-**
-** This file is part of the QtCore module of the Qt Toolkit.
-**
-** $QT_BEGIN_LICENSE:LGPL$
-** Commercial Usage
-** Licensees holding valid Qt Commercial licenses may use this file in
-** accordance with the Qt Commercial License Agreement provided with the
-** Software or, alternatively, in accordance with the terms contained in
-** a written agreement between you and Nokia.
-**
-** GNU Lesser General Public License Usage
-** Alternatively, this file may be used under the terms of the GNU Lesser
-** General Public License version 2.1 as published by the Free Software
-** Foundation and appearing in the file LICENSE.LGPL included in the
-** packaging of this file.  Please review the following information to
-** ensure the GNU Lesser General Public License version 2.1 requirements
-** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
-**
-** In addition, as a special exception, Nokia gives you certain additional
-** rights.  These rights are described in the Nokia Qt LGPL Exception
-** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
-**
-** GNU General Public License Usage
-** Alternatively, this file may be used under the terms of the GNU
-** General Public License version 3.0 as published by the Free Software
-** Foundation and appearing in the file LICENSE.GPL included in the
-** packaging of this file.  Please review the following information to
-** ensure the GNU General Public License version 3.0 requirements will be
-** met: http://www.gnu.org/copyleft/gpl.html.
-**
-** If you have questions regarding the use of this file, please contact
-** Nokia at qt-info@nokia.com.
-** $QT_END_LICENSE$
-**
-****************************************************************************/
-
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 #include "printutils.h"
 
-template <class Key, class T>
+/*!
+   A thread-safe, cost-bounded LRU cache.
+
+   Entries are distributed over a number of shards by key hash, each with its own
+   lock and LRU list, so concurrent lookups of different keys rarely contend.
+   The cost limit applies to the cache as a whole: When an insert exceeds it,
+   the least recently used entries of the inserting shard are evicted first,
+   then those of the other shards.
+
+   Values are held by shared_ptr, so an entry returned by get() stays valid even
+   if it is evicted concurrently.
+ */
+template <class Key, class T, class Hash = std::hash<Key>>
 class Cache
 {
-  struct Node {
-    inline Node() : keyPtr(nullptr), t(nullptr), c(0), p(nullptr), n(nullptr) {
-    }
-    inline Node(T * data, size_t cost) : keyPtr(nullptr), t(data), c(cost), p(nullptr), n(nullptr) {
-    }
-    const Key *keyPtr; T *t; size_t c; Node *p, *n;
-  };
-  using map_type = typename std::unordered_map<Key, Node>;
-  using iterator_type = typename map_type::iterator;
-  using value_type = typename map_type::value_type;
-
-  std::unordered_map<Key, Node> hash;
-  Node *f, *l;
-  void *unused{nullptr};
-  size_t mx, total{0};
-
-  inline void unlink(Node& n) {
-    if (n.p) n.p->n = n.n;
-    if (n.n) n.n->p = n.p;
-    if (l == &n) l = n.p;
-    if (f == &n) f = n.n;
-    total -= n.c;
-    T *obj = n.t;
-    hash.erase(*n.keyPtr);
-    delete obj;
-  }
-  inline T *relink(const Key& key) {
-    auto i = hash.find(key);
-    if (i == hash.end()) return nullptr;
-
-    Node& n = i->second;
-    if (f != &n) {
-      if (n.p) n.p->n = n.n;
-      if (n.n) n.n->p = n.p;
-      if (l == &n) l = n.p;
-      n.p = nullptr;
-      n.n = f;
-      f->p = &n;
-      f = &n;
+public:
+  using value_ptr = std::shared_ptr<T>;
+
+  explicit Cache(size_t maxCost = 100, size_t numShards = 16)
+    : shards(std::max<size_t>(numShards, 1)), mx(maxCost) {}
+  Cache(const Cache&) = delete;
+  Cache& operator=(const Cache&) = delete;
+
+  [[nodiscard]] size_t maxCost() const { return mx; }
+  void setMaxCost(size_t m) { mx = m; trim(0); }
+  [[nodiscard]] size_t totalCost() const { return total; }
+
+  [[nodiscard]] size_t size() const {
+    size_t n = 0;
+    for (const auto& shard : shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      n += shard.map.size();
     }
-    return n.t;
+    return n;
   }
+  [[nodiscard]] bool empty() const { return size() == 0; }
 
-public:
-  inline explicit Cache(size_t maxCost = 100)
-    : f(nullptr), l(nullptr), mx(maxCost) { }
-  inline ~Cache() { clear(); }
-
-  [[nodiscard]] inline size_t maxCost() const { return mx; }
-  void setMaxCost(size_t m) { mx = m; trim(mx); }
-  [[nodiscard]] inline size_t totalCost() const { return total; }
-
-  [[nodiscard]] inline size_t size() const { return hash.size(); }
-  [[nodiscard]] inline bool empty() const { return hash.empty(); }
+  [[nodiscard]] size_t hits() const { return numhits; }
+  [[nodiscard]] size_t misses() const { return nummisses; }
+  [[nodiscard]] size_t evictions() const { return numevictions; }
 
   void clear() {
-    while (f) {
-      delete f->t; f = f->n;
+    for (auto& shard : shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (const auto& entry : shard.lru) total -= entry.cost;
+      shard.map.clear();
+      shard.lru.clear();
     }
-    hash.clear();
-    l = nullptr;
-    total = 0;
   }
 
-  bool insert(const Key& key, T *object, size_t cost);
-  T *object(const Key& key) const { return const_cast<Cache<Key, T> *>(this)->relink(key); }
-  inline bool contains(const Key& key) const { return hash.find(key) != hash.end(); }
-  T *operator[](const Key& key) const { return object(key); }
+  /*!
+     Inserts object, replacing any existing entry for key.
+     Returns false if the object exceeds the cost limit on its own.
+   */
+  bool insert(const Key& key, value_ptr object, size_t cost);
+
+  /*!
+     Returns the entry for key and marks it as most recently used,
+     or nullptr on a miss.
+   */
+  value_ptr get(const Key& key);
+
+  /*!
+     Returns true if key is cached. Does not affect LRU order or statistics,
+     hits and misses are only counted by get().
+   */
+  [[nodiscard]] bool contains(const Key& key) const {
+    const auto& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.map.find(key) != shard.map.end();
+  }
+
+  /*!
+     Returns the entry for key, or nullptr. Like contains(), this does not
+     affect LRU order or statistics.
+   */
+  [[nodiscard]] value_ptr peek(const Key& key) const {
+    const auto& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.map.find(key);
+    return found == shard.map.end() ? nullptr : found->second->value;
+  }
 
   bool remove(const Key& key);
-  T *take(const Key& key);
 
 private:
-  void trim(size_t m);
-};
+  struct Entry {
+    Key key;
+    value_ptr value;
+    size_t cost;
+  };
+  using lru_type = std::list<Entry>;
 
-template <class Key, class T>
-inline bool Cache<Key, T>::remove(const Key& key)
-{
-  auto i = hash.find(key);
-  if (i == hash.end()) {
-    return false;
-  } else {
-    unlink(i->second);
-    return true;
+  struct Shard {
+    mutable std::mutex mutex;
+    // Most recently used entries first
+    lru_type lru;
+    std::unordered_map<Key, typename lru_type::iterator, Hash> map;
+  };
+
+  Shard& shardFor(const Key& key) { return shards[Hash()(key) % shards.size()]; }
+  const Shard& shardFor(const Key& key) const { return shards[Hash()(key) % shards.size()]; }
+
+  // Must be called with shard.mutex held
+  void unlink(Shard& shard, typename lru_type::iterator it) {
+    total -= it->cost;
+    shard.map.erase(it->key);
+    shard.lru.erase(it);
+  }
+  // Evicts from shard until the total cost is at most mx - reserve, or the shard is empty.
+  // Must be called with shard.mutex held.
+  void trimShard(Shard& shard, size_t reserve) {
+    while (!shard.lru.empty() && total + reserve > mx) {
+#ifdef DEBUG
+      PRINTDB("Trimming cache: %1$d bytes", shard.lru.back().cost);
+#endif
+      unlink(shard, std::prev(shard.lru.end()));
+      numevictions++;
+    }
+  }
+  void trim(size_t reserve) {
+    for (auto& shard : shards) {
+      if (total + reserve <= mx) break;
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      trimShard(shard, reserve);
+    }
   }
-}
 
-template <class Key, class T>
-inline T *Cache<Key, T>::take(const Key& key)
-{
-  iterator_type i = hash.find(key);
-  if (i == hash.end()) return 0;
-
-  Node& n = *i;
-  T *t = n.t;
-  n.t = 0;
-  unlink(n);
-  return t;
-}
+  std::vector<Shard> shards;
+  std::atomic<size_t> mx;
+  std::atomic<size_t> total{0};
+  std::atomic<size_t> numhits{0};
+  std::atomic<size_t> nummisses{0};
+  std::atomic<size_t> numevictions{0};
+};
 
-template <class Key, class T>
-bool Cache<Key, T>::insert(const Key& akey, T *aobject, size_t acost)
+template <class Key, class T, class Hash>
+bool Cache<Key, T, Hash>::insert(const Key& key, value_ptr object, size_t cost)
 {
-  remove(akey);
-  if (acost > mx) {
-    delete aobject;
+  if (cost > mx) {
+    remove(key);
     return false;
   }
-  trim(mx - acost);
-  Node node(aobject, acost);
-  hash[akey] = node;
-  auto i = hash.find(akey);
-  total += acost;
-  Node *n = &i->second;
-  n->keyPtr = &i->first;
-  if (f) f->p = n;
-  n->n = f;
-  f = n;
-  if (!l) l = f;
+  {
+    auto& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.map.find(key);
+    if (found != shard.map.end()) unlink(shard, found->second);
+    trimShard(shard, cost);
+    shard.lru.push_front(Entry{key, std::move(object), cost});
+    shard.map.emplace(key, shard.lru.begin());
+    total += cost;
+  }
+  // Only one shard lock is held at a time, so concurrent inserts cannot deadlock
+  if (total > mx) trim(0);
   return true;
 }
 
-template <class Key, class T>
-void Cache<Key, T>::trim(size_t m)
+template <class Key, class T, class Hash>
+typename Cache<Key, T, Hash>::value_ptr Cache<Key, T, Hash>::get(const Key& key)
 {
-  Node *n = l;
-  while (n && total > m) {
-    Node *u = n;
-    n = n->p;
-#ifdef DEBUG
-    LOG("Trimming cache: %1$s (%2$d bytes)", u->keyPtr->substr(0, 40), u->c);
-#endif
-    unlink(*u);
+  auto& shard = shardFor(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto found = shard.map.find(key);
+  if (found == shard.map.end()) {
+    nummisses++;
+    return nullptr;
   }
+  numhits++;
+  shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+  return found->second->value;
+}
+
+template <class Key, class T, class Hash>
+bool Cache<Key, T, Hash>::remove(const Key& key)
+{
+  auto& shard = shardFor(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto found = shard.map.find(key);
+  if (found == shard.map.end()) return false;
+  unlink(shard, found->second);
+  return true;
 }
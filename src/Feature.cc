@@ -38,6 +38,12 @@ const Feature Feature::ExperimentalManifold("manifold", "Use the Manifold librar
 const Feature Feature::ExperimentalRoof("roof", "Enable <code>roof</code>");
 const Feature Feature::ExperimentalInputDriverDBus("input-driver-dbus", "Enable DBus input drivers (requires restart)");
 const Feature Feature::ExperimentalLazyUnion("lazy-union", "Enable lazy unions.");
+const Feature Feature::ExperimentalParallelEvaluation("parallel-evaluation", "Evaluate independent child subtrees of groups and CSG operations concurrently.");
+const Feature Feature::ExperimentalIncrementalEvaluation("incremental-evaluation", "Reuse unchanged top level objects when recompiling in the GUI. Reused objects do not repeat their <code>echo()</code> output.");
+const Feature Feature::ExperimentalFunctionVM("function-vm", "Compile user-defined functions to bytecode and evaluate them on a register VM.");
+const Feature Feature::ExperimentalFunctionVMVerify("function-vm-verify", "Also evaluate functions run on the function VM with the interpreter, and warn if results differ.");
+const Feature Feature::ExperimentalLazyTransforms("lazy-transforms", "Transform cached 3D geometry only when its vertices are needed, and union far apart instances without CSG.");
+const Feature Feature::ExperimentalSurfaceDecimation("surface-decimation", "Mesh flat regions of <code>surface()</code> heightmaps with one polygon per rectangle instead of four triangles per pixel.");
 const Feature Feature::ExperimentalVxORenderers("vertex-object-renderers", "Enable vertex object renderers");
 const Feature Feature::ExperimentalVxORenderersIndexing("vertex-object-renderers-indexing", "Enable indexing in vertex object renderers");
 const Feature Feature::ExperimentalVxORenderersDirect("vertex-object-renderers-direct", "Enable direct buffer writes in vertex object renderers");
@@ -21,6 +21,12 @@ public:
   static const Feature ExperimentalRoof;
   static const Feature ExperimentalInputDriverDBus;
   static const Feature ExperimentalLazyUnion;
+  static const Feature ExperimentalParallelEvaluation;
+  static const Feature ExperimentalIncrementalEvaluation;
+  static const Feature ExperimentalFunctionVM;
+  static const Feature ExperimentalFunctionVMVerify;
+  static const Feature ExperimentalLazyTransforms;
+  static const Feature ExperimentalSurfaceDecimation;
   static const Feature ExperimentalVxORenderers;
   static const Feature ExperimentalVxORenderersIndexing;
   static const Feature ExperimentalVxORenderersDirect;
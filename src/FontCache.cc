@@ -110,7 +110,7 @@ void FontCache::defaultInitHandler(FontCacheInitializer *initializer, void *)
   initializer->run();
 }
 
-FontCache::FontCache()
+FontCache::FontCache() : cache(MAX_NR_OF_CACHE_ENTRIES, 1)
 {
   this->init_ok = false;
   this->library = nullptr;
@@ -264,45 +264,16 @@ void FontCache::clear()
   this->cache.clear();
 }
 
-void FontCache::dump_cache(const std::string& info)
-{
-  std::cout << info << ":";
-  for (const auto& item : this->cache) {
-    std::cout << " " << item.first << " (" << item.second.second << ")";
-  }
-  std::cout << std::endl;
-}
-
-void FontCache::check_cleanup()
-{
-  if (this->cache.size() < MAX_NR_OF_CACHE_ENTRIES) {
-    return;
-  }
-
-  auto pos = this->cache.begin()++;
-  for (auto it = this->cache.begin(); it != this->cache.end(); ++it) {
-    if ((*pos).second.second > (*it).second.second) {
-      pos = it;
-    }
-  }
-  FT_Done_Face((*pos).second.first);
-  this->cache.erase(pos);
-}
-
 FT_Face FontCache::get_font(const std::string& font)
 {
-  FT_Face face;
-  auto it = this->cache.find(font);
-  if (it == this->cache.end()) {
-    face = find_face(font);
-    if (!face) {
-      return nullptr;
-    }
-    check_cleanup();
-  } else {
-    face = (*it).second.first;
+  if (auto face = this->cache.get(font)) {
+    return face.get();
+  }
+  FT_Face face = find_face(font);
+  if (!face) {
+    return nullptr;
   }
-  this->cache[font] = cache_entry_t(face, time(nullptr));
+  this->cache.insert(font, std::shared_ptr<FT_FaceRec_>(face, FT_Done_Face), 1);
   return face;
 }
 
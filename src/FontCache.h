@@ -25,7 +25,7 @@
  */
 #pragma once
 
-#include <map>
+#include <memory>
 #include <string>
 #include <iostream>
 
@@ -42,6 +42,8 @@
 #include <hb.h>
 #include <hb-ft.h>
 
+#include "Cache.h"
+
 class FontInfo
 {
 public:
@@ -97,8 +99,10 @@ public:
   static void registerProgressHandler(InitHandlerFunc *handler, void *userdata = nullptr);
 
 private:
-  using cache_entry_t = std::pair<FT_Face, std::time_t>;
-  using cache_t = std::map<std::string, cache_entry_t>;
+  // Only used for its LRU eviction, with a single shard. FreeType faces must not be
+  // used concurrently, and get_font() returns plain faces, which FT_Done_Face
+  // releases as soon as they are evicted.
+  using cache_t = Cache<std::string, FT_FaceRec_>;
 
   static FontCache *self;
   static InitHandlerFunc *cb_handler;
@@ -111,9 +115,6 @@ private:
   FcConfig *config;
   FT_Library library;
 
-  void check_cleanup();
-  void dump_cache(const std::string& info);
-
   void add_font_dir(const std::string& path);
   void init_pattern(FcPattern *pattern) const;
 
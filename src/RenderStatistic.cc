@@ -26,8 +26,11 @@
 #include <json.hpp>
 
 #include "printutils.h"
+#include "BooleanCulling.h"
 #include "GeometryCache.h"
 #include "CGALCache.h"
+#include "GeometryDiskCache.h"
+#include "NodeHasher.h"
 #include "PolySet.h"
 #include "Polygon2d.h"
 #ifdef ENABLE_CGAL
@@ -148,6 +151,9 @@ static nlohmann::json getCache(C cache)
   cacheJson["entries"] = cache->size();
   cacheJson["bytes"] = cache->totalCost();
   cacheJson["max_size"] = cache->maxSizeMB() * 1024 * 1024;
+  cacheJson["hits"] = cache->hits();
+  cacheJson["misses"] = cache->misses();
+  cacheJson["evictions"] = cache->evictions();
   return cacheJson;
 }
 
@@ -162,6 +168,12 @@ void RenderStatistic::start()
   begin = std::chrono::steady_clock::now();
 }
 
+void RenderStatistic::resetCounts()
+{
+  NodeHasher::statistics().reset();
+  BooleanCulling::statistics().reset();
+}
+
 std::chrono::milliseconds RenderStatistic::ms()
 {
   const std::chrono::steady_clock::time_point end{std::chrono::steady_clock::now()};
@@ -314,6 +326,19 @@ void LogVisitor::printCacheStatistic()
 #ifdef ENABLE_CGAL
   CGALCache::instance()->print();
 #endif
+  GeometryDiskCache::instance()->print();
+
+  const auto& keys = NodeHasher::statistics();
+  if (keys.nodes > 0) {
+    LOG("Node cache keys: %1$d nodes, %2$d bytes (ID strings: %3$d bytes), %4$d ms, %5$d collisions",
+        keys.nodes.load(), keys.keybytes.load(), keys.idstringbytes.load(), keys.microseconds / 1000, keys.collisions.load());
+  }
+
+  const auto& culled = BooleanCulling::statistics();
+  if (culled.unions > 0 || culled.differences > 0 || culled.intersections > 0) {
+    LOG("Boolean operations avoided by bounding boxes: %1$d unions, %2$d differences, %3$d intersections",
+        culled.unions.load(), culled.differences.load(), culled.intersections.load());
+  }
 }
 
 void LogVisitor::printRenderingTime(const std::chrono::milliseconds ms)
@@ -435,6 +460,30 @@ void StreamVisitor::printCacheStatistic()
 #ifdef ENABLE_CGAL
     cacheJson["cgal_cache"] = getCache(CGALCache::instance());
 #endif // ENABLE_CGAL
+    const auto diskcache = GeometryDiskCache::instance();
+    if (diskcache->isEnabled()) {
+      nlohmann::json diskJson;
+      diskJson["hits"] = diskcache->hits();
+      diskJson["misses"] = diskcache->misses();
+      diskJson["writes"] = diskcache->writes();
+      diskJson["bytes"] = diskcache->totalSize();
+      diskJson["max_size"] = diskcache->maxSizeMB() * 1024 * 1024;
+      cacheJson["disk_cache"] = diskJson;
+    }
+    const auto& keys = NodeHasher::statistics();
+    nlohmann::json keysJson;
+    keysJson["nodes"] = keys.nodes.load();
+    keysJson["key_bytes"] = keys.keybytes.load();
+    keysJson["id_string_bytes"] = keys.idstringbytes.load();
+    keysJson["collisions"] = keys.collisions.load();
+    keysJson["time_ms"] = keys.microseconds / 1000;
+    cacheJson["node_keys"] = keysJson;
+    const auto& culled = BooleanCulling::statistics();
+    nlohmann::json culledJson;
+    culledJson["unions"] = culled.unions.load();
+    culledJson["differences"] = culled.differences.load();
+    culledJson["intersections"] = culled.intersections.load();
+    cacheJson["culled_operations"] = culledJson;
     json["cache"] = cacheJson;
   }
 }
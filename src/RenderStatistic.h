@@ -54,6 +54,12 @@ public:
    */
   void start();
 
+  /**
+   * Reset the process-wide node key and culling counts, so they are
+   * reported for a single render.
+   */
+  static void resetCounts();
+
   /**
    * Return render time in milliseconds.
    */
@@ -28,16 +28,14 @@ class Arguments : public std::vector<Argument>
 {
 public:
   Arguments(const AssignmentList& argument_expressions, const std::shared_ptr<const Context>& context);
+  // Empty argument list, for arguments that are already evaluated
+  Arguments(EvaluationSession *session) : evaluation_session(session) {}
   Arguments(Arguments&& other) = default;
   Arguments& operator=(Arguments&& other) = default;
   Arguments(const Arguments& other) = delete;
   Arguments& operator=(const Arguments& other) = delete;
   ~Arguments() = default;
 
-private:
-  Arguments(EvaluationSession *session) : evaluation_session(session) {}
-
-public:
   [[nodiscard]] Arguments clone() const;
 
   [[nodiscard]] EvaluationSession *session() const { return evaluation_session; }
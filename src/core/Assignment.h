@@ -8,19 +8,21 @@
 #include "AST.h"
 #include "memory.h"
 #include "Annotation.h"
+#include "Symbol.h"
 
 class Assignment : public ASTNode
 {
 public:
   Assignment(std::string name, const Location& loc)
-    : ASTNode(loc), name(std::move(name)), locOfOverwrite(Location::NONE) { }
+    : ASTNode(loc), name(std::move(name)), symbol(this->name), locOfOverwrite(Location::NONE) { }
   Assignment(std::string name,
              shared_ptr<class Expression> expr = shared_ptr<class Expression>(),
              const Location& loc = Location::NONE)
-    : ASTNode(loc), name(std::move(name)), expr(std::move(expr)), locOfOverwrite(Location::NONE){ }
+    : ASTNode(loc), name(std::move(name)), symbol(this->name), expr(std::move(expr)), locOfOverwrite(Location::NONE){ }
 
   void print(std::ostream& stream, const std::string& indent) const override;
   const std::string& getName() const { return name; }
+  const Symbol& getSymbol() const { return symbol; }
   const shared_ptr<Expression>& getExpr() const { return expr; }
   const AnnotationMap& getAnnotations() const { return annotations; }
   // setExpr used by customizer ParameterObject etc.
@@ -35,6 +37,7 @@ public:
 
 protected:
   const std::string name;
+  const Symbol symbol;
   shared_ptr<class Expression> expr;
   AnnotationMap annotations;
   Location locOfOverwrite;
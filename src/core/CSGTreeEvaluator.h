@@ -30,6 +30,7 @@ public:
   Response visit(State& state, const CgalAdvNode& node) override;
 
   shared_ptr<CSGNode> buildCSGTree(const AbstractNode& node);
+  const char *profileCategory() const override { return "csg"; }
 
   [[nodiscard]] const shared_ptr<CSGNode>& getRootNode() const {
     return this->rootNode;
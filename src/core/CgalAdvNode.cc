@@ -73,17 +73,17 @@ static std::shared_ptr<AbstractNode> builtin_resize(const ModuleInstantiation *i
   node->newsize << 0, 0, 0;
   if (parameters["newsize"].type() == Value::Type::VECTOR) {
     const auto& vs = parameters["newsize"].toVector();
-    if (vs.size() >= 1) node->newsize[0] = vs[0].toDouble();
-    if (vs.size() >= 2) node->newsize[1] = vs[1].toDouble();
-    if (vs.size() >= 3) node->newsize[2] = vs[2].toDouble();
+    if (vs.size() >= 1) node->newsize[0] = vs.at(0).toDouble();
+    if (vs.size() >= 2) node->newsize[1] = vs.at(1).toDouble();
+    if (vs.size() >= 3) node->newsize[2] = vs.at(2).toDouble();
   }
   const auto& autosize = parameters["auto"];
   node->autosize << false, false, false;
   if (autosize.type() == Value::Type::VECTOR) {
     const auto& va = autosize.toVector();
-    if (va.size() >= 1) node->autosize[0] = va[0].toBool();
-    if (va.size() >= 2) node->autosize[1] = va[1].toBool();
-    if (va.size() >= 3) node->autosize[2] = va[2].toBool();
+    if (va.size() >= 1) node->autosize[0] = va.at(0).toBool();
+    if (va.size() >= 2) node->autosize[1] = va.at(1).toBool();
+    if (va.size() >= 3) node->autosize[2] = va.at(2).toBool();
   } else if (autosize.type() == Value::Type::BOOL) {
     node->autosize << autosize.toBool(), autosize.toBool(), autosize.toBool();
   }
@@ -87,6 +87,43 @@ const Value& Context::lookup_variable(const std::string& name, const Location& l
   return *result;
 }
 
+/*!
+   Looks up a lexical variable by symbol. Lookups at the same site usually find
+   their binding at the same depth and slot, so the frame at the hinted depth is
+   checked by slot; closer frames are still searched, as they may shadow it.
+ */
+boost::optional<const Value&> Context::try_lookup_variable(const Symbol& symbol, SlotHint& hint) const
+{
+  if (symbol.isConfigVariable()) {
+    return session()->try_lookup_special_variable(symbol.name());
+  }
+  const auto [hintdepth, hintslot] = hint.load();
+  size_t depth = 0;
+  for (const Context *context = this; context != nullptr; context = context->getParent().get(), ++depth) {
+    if (depth == hintdepth) {
+      if (const Value *value = context->lexical_variables.get(hintslot, symbol)) {
+        return *value;
+      }
+    }
+    const size_t slot = context->lexical_variables.find(symbol);
+    if (slot != SlotMap::npos) {
+      hint.store(depth, slot);
+      return context->lexical_variables[slot];
+    }
+  }
+  return boost::none;
+}
+
+const Value& Context::lookup_variable(const Symbol& symbol, SlotHint& hint, const Location& loc) const
+{
+  boost::optional<const Value&> result = try_lookup_variable(symbol, hint);
+  if (!result) {
+    LOG(message_group::Warning, loc, documentRoot(), "Ignoring unknown variable '%1$s'", symbol.name());
+    return Value::undefined;
+  }
+  return *result;
+}
+
 boost::optional<CallableFunction> Context::lookup_function(const std::string& name, const Location& loc) const
 {
   if (is_config_variable(name)) {
@@ -117,9 +154,9 @@ boost::optional<InstantiableModule> Context::lookup_module(const std::string& na
   return boost::none;
 }
 
-bool Context::set_variable(const std::string& name, Value&& value)
+bool Context::set_variable(const Symbol& symbol, Value&& value)
 {
-  bool new_variable = ContextFrame::set_variable(name, std::move(value));
+  bool new_variable = ContextFrame::set_variable(symbol, std::move(value));
   if (new_variable) {
     session()->accounting().addContextVariable();
   }
@@ -81,9 +81,12 @@ public:
 
   boost::optional<const Value&> try_lookup_variable(const std::string& name) const;
   const Value& lookup_variable(const std::string& name, const Location& loc) const;
+  boost::optional<const Value&> try_lookup_variable(const Symbol& symbol, SlotHint& hint) const;
+  const Value& lookup_variable(const Symbol& symbol, SlotHint& hint, const Location& loc) const;
   boost::optional<CallableFunction> lookup_function(const std::string& name, const Location& loc) const;
   boost::optional<InstantiableModule> lookup_module(const std::string& name, const Location& loc) const;
-  bool set_variable(const std::string& name, Value&& value) override;
+  using ContextFrame::set_variable;
+  bool set_variable(const Symbol& symbol, Value&& value) override;
   size_t clear() override;
 
   const std::shared_ptr<const Context>& getParent() const { return this->parent; }
@@ -38,14 +38,26 @@ boost::optional<const Value&> ContextFrame::lookup_local_variable(const std::str
       return result->second;
     }
   } else {
-    auto result = lexical_variables.find(name);
-    if (result != lexical_variables.end()) {
-      return result->second;
+    const size_t slot = lexical_variables.find(name);
+    if (slot != SlotMap::npos) {
+      return lexical_variables[slot];
     }
   }
   return boost::none;
 }
 
+boost::optional<const Value&> ContextFrame::lookup_local_variable(const Symbol& symbol) const
+{
+  if (symbol.isConfigVariable()) {
+    return lookup_local_variable(symbol.name());
+  }
+  const size_t slot = lexical_variables.find(symbol);
+  if (slot != SlotMap::npos) {
+    return lexical_variables[slot];
+  }
+  return boost::none;
+}
+
 boost::optional<CallableFunction> ContextFrame::lookup_local_function(const std::string& name, const Location& /*loc*/) const
 {
   boost::optional<const Value&> value = lookup_local_variable(name);
@@ -64,7 +76,7 @@ std::vector<const Value *> ContextFrame::list_embedded_values() const
 {
   std::vector<const Value *> output;
   for (const auto& variable : lexical_variables) {
-    output.push_back(&variable.second);
+    output.push_back(&variable.value);
   }
   for (const auto& variable : config_variables) {
     output.push_back(&variable.second);
@@ -80,12 +92,12 @@ size_t ContextFrame::clear()
   return removed;
 }
 
-bool ContextFrame::set_variable(const std::string& name, Value&& value)
+bool ContextFrame::set_variable(const Symbol& symbol, Value&& value)
 {
-  if (is_config_variable(name)) {
-    return config_variables.insert_or_assign(name, std::move(value)).second;
+  if (symbol.isConfigVariable()) {
+    return config_variables.insert_or_assign(symbol.name(), std::move(value)).second;
   } else {
-    return lexical_variables.insert_or_assign(name, std::move(value)).second;
+    return lexical_variables.insert_or_assign(symbol, std::move(value));
   }
 }
 
@@ -96,6 +108,13 @@ void ContextFrame::apply_variables(const ValueMap& variables)
   }
 }
 
+void ContextFrame::apply_variables(const SlotMap& variables)
+{
+  for (const auto& variable : variables) {
+    set_variable(variable.symbol, variable.value.clone());
+  }
+}
+
 void ContextFrame::apply_lexical_variables(const ContextFrame& other)
 {
   apply_variables(other.lexical_variables);
@@ -114,6 +133,14 @@ void ContextFrame::apply_variables(ValueMap&& variables)
   variables.clear();
 }
 
+void ContextFrame::apply_variables(SlotMap&& variables)
+{
+  for (auto& variable : variables) {
+    set_variable(variable.symbol, std::move(variable.value));
+  }
+  variables.clear();
+}
+
 void ContextFrame::apply_lexical_variables(ContextFrame&& other)
 {
   apply_variables(std::move(other.lexical_variables));
@@ -141,7 +168,7 @@ std::string ContextFrame::dumpFrame() const
   std::ostringstream s;
   s << boost::format("ContextFrame %p:\n") % this;
   for (const auto& v : lexical_variables) {
-    s << boost::format("    %s = %s\n") % v.first % v.second.toEchoString();
+    s << boost::format("    %s = %s\n") % v.symbol.name() % v.value.toEchoString();
   }
   for (const auto& v : config_variables) {
     s << boost::format("    %s = %s\n") % v.first % v.second.toEchoString();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "EvaluationSession.h"
+#include "SlotMap.h"
 #include "ValueMap.h"
 
 class ContextFrame
@@ -12,15 +13,18 @@ public:
   ContextFrame(ContextFrame&& other) = default;
 
   virtual boost::optional<const Value&> lookup_local_variable(const std::string& name) const;
+  boost::optional<const Value&> lookup_local_variable(const Symbol& symbol) const;
   virtual boost::optional<CallableFunction> lookup_local_function(const std::string& name, const Location& loc) const;
   virtual boost::optional<InstantiableModule> lookup_local_module(const std::string& name, const Location& loc) const;
 
   virtual std::vector<const Value *> list_embedded_values() const;
   virtual size_t clear();
 
-  virtual bool set_variable(const std::string& name, Value&& value);
+  bool set_variable(const std::string& name, Value&& value) { return set_variable(Symbol(name), std::move(value)); }
+  virtual bool set_variable(const Symbol& symbol, Value&& value);
 
   void apply_variables(const ValueMap& variables);
+  void apply_variables(const SlotMap& variables);
   void apply_lexical_variables(const ContextFrame& other);
   void apply_config_variables(const ContextFrame& other);
   void apply_variables(const ContextFrame& other) {
@@ -29,6 +33,7 @@ public:
   }
 
   void apply_variables(ValueMap&& variables);
+  void apply_variables(SlotMap&& variables);
   void apply_lexical_variables(ContextFrame&& other);
   void apply_config_variables(ContextFrame&& other);
   void apply_variables(ContextFrame&& other);
@@ -39,7 +44,7 @@ public:
   const std::string& documentRoot() const { return evaluation_session->documentRoot(); }
 
 protected:
-  ValueMap lexical_variables;
+  SlotMap lexical_variables;
   ValueMap config_variables;
   EvaluationSession *evaluation_session;
 
@@ -12,22 +12,25 @@ class Context;
  * track of when a garbage collection run is due.
  *
  * Counts one point for each context, each context variable, and each element
- * in a VectorType value.
+ * in a VectorType value. The cumulative number of objects added is kept
+ * separately, for profiling.
  */
 class HeapSizeAccounting
 {
 public:
-  void addContext(size_t number = 1) { count += number; }
+  void addContext(size_t number = 1) { count += number; total += number; }
   void removeContext(size_t number = 1) { count -= number; }
-  void addContextVariable(size_t number = 1) { count += number; }
+  void addContextVariable(size_t number = 1) { count += number; total += number; }
   void removeContextVariable(size_t number = 1) { count -= number; }
-  void addVectorElement(size_t number = 1) { count += number; }
+  void addVectorElement(size_t number = 1) { count += number; total += number; }
   void removeVectorElement(size_t number = 1) { count -= number; }
 
   [[nodiscard]] size_t size() const { return count; }
+  [[nodiscard]] size_t allocations() const { return total; }
 
 private:
   size_t count = 0;
+  size_t total = 0;
 };
 
 class ContextMemoryManager
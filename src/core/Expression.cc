@@ -37,7 +37,9 @@
 #include <utility>
 #include <variant>
 #include "printutils.h"
+#include "FunctionVM.h"
 #include "StackCheck.h"
+#include "Profiler.h"
 #include "Context.h"
 #include "exceptions.h"
 #include "Parameters.h"
@@ -238,27 +240,12 @@ Value Range::evaluate(const std::shared_ptr<const Context>& context) const
   if (beginValue.type() == Value::Type::NUMBER) {
     Value endValue = this->end->evaluate(context);
     if (endValue.type() == Value::Type::NUMBER) {
-      double begin_val = beginValue.toDouble();
-      double end_val = endValue.toDouble();
-
       if (!this->step) {
-        if (end_val < begin_val) {
-          std::swap(begin_val, end_val);
-          print_range_depr(loc, context);
-        }
-        return RangeType(begin_val, end_val);
+        return makeRange(beginValue.toDouble(), 0, endValue.toDouble(), context);
       } else {
         Value stepValue = this->step->evaluate(context);
         if (stepValue.type() == Value::Type::NUMBER) {
-          double step_val = stepValue.toDouble();
-          if (this->isLiteral()) {
-            if ((step_val > 0) && (end_val < begin_val)) {
-              print_range_err("is greater", "is positive", loc, context);
-            } else if ((step_val < 0) && (end_val > begin_val)) {
-              print_range_err("is smaller", "is negative", loc, context);
-            }
-          }
-          return RangeType(begin_val, step_val, end_val);
+          return makeRange(beginValue.toDouble(), stepValue.toDouble(), endValue.toDouble(), context);
         }
       }
     }
@@ -266,6 +253,25 @@ Value Range::evaluate(const std::shared_ptr<const Context>& context) const
   return Value::undefined.clone();
 }
 
+Value Range::makeRange(double begin_val, double step_val, double end_val, const std::shared_ptr<const Context>& context) const
+{
+  if (!this->step) {
+    if (end_val < begin_val) {
+      std::swap(begin_val, end_val);
+      print_range_depr(loc, context);
+    }
+    return RangeType(begin_val, end_val);
+  }
+  if (this->isLiteral()) {
+    if ((step_val > 0) && (end_val < begin_val)) {
+      print_range_err("is greater", "is positive", loc, context);
+    } else if ((step_val < 0) && (end_val > begin_val)) {
+      print_range_err("is smaller", "is negative", loc, context);
+    }
+  }
+  return RangeType(begin_val, step_val, end_val);
+}
+
 void Range::print(std::ostream& stream, const std::string&) const
 {
   stream << "[" << *this->begin;
@@ -334,13 +340,13 @@ void Vector::print(std::ostream& stream, const std::string&) const
   stream << "]";
 }
 
-Lookup::Lookup(std::string name, const Location& loc) : Expression(loc), name(std::move(name))
+Lookup::Lookup(std::string name, const Location& loc) : Expression(loc), name(std::move(name)), symbol(this->name)
 {
 }
 
 Value Lookup::evaluate(const std::shared_ptr<const Context>& context) const
 {
-  return context->lookup_variable(this->name, loc).clone();
+  return context->lookup_variable(this->symbol, this->hint, loc).clone();
 }
 
 void Lookup::print(std::ostream& stream, const std::string&) const
@@ -481,6 +487,8 @@ struct SimplifiedExpression {
   const Expression *expression;
   boost::optional<ContextHandle<Context>> new_context = boost::none;
   boost::optional<const FunctionCall *> new_active_function_call = boost::none;
+  // The user function whose body expression is, if any
+  const UserFunction *function = nullptr;
 };
 using SimplificationResult = std::variant<SimplifiedExpression, Value>;
 
@@ -509,6 +517,7 @@ static SimplificationResult simplify_function_body(const Expression *expression,
 
       const Expression *function_body;
       const AssignmentList *required_parameters;
+      const UserFunction *user_function = nullptr;
       std::shared_ptr<const Context> defining_context;
 
       auto f = call->evaluate_function_expression(context);
@@ -520,7 +529,8 @@ static SimplificationResult simplify_function_body(const Expression *expression,
           return std::get<const BuiltinFunction *>(*f)->evaluate(context, call);
         } else if (index == 1) {
           CallableUserFunction callable = std::get<CallableUserFunction>(*f);
-          function_body = callable.function->expr.get();
+          user_function = callable.function;
+          function_body = user_function->expr.get();
           required_parameters = &callable.function->parameters;
           defining_context = callable.defining_context;
         } else {
@@ -543,7 +553,7 @@ static SimplificationResult simplify_function_body(const Expression *expression,
       Parameters parameters = Parameters::parse(std::move(arguments), call->location(), *required_parameters, defining_context);
       body_context->apply_variables(std::move(parameters).to_context_frame());
 
-      return SimplifiedExpression{function_body, std::move(body_context), call};
+      return SimplifiedExpression{function_body, std::move(body_context), call, user_function};
     } else {
       return expression->evaluate(context);
     }
@@ -557,6 +567,7 @@ Value FunctionCall::evaluate(const std::shared_ptr<const Context>& context) cons
     print_err(name.c_str(), loc, context);
     throw RecursionException::create("function", name, this->loc);
   }
+  Profiler::Scope profile("function", name, this->loc, &context->session()->accounting());
 
   // Repeatedly simplify expr until it reduces to either a tail call,
   // or an expression that cannot be simplified in-place. If the latter,
@@ -587,6 +598,13 @@ Value FunctionCall::evaluate(const std::shared_ptr<const Context>& context) cons
           LOG(message_group::Error, expression->location(), expression_context->documentRoot(), "Recursion detected calling function '%1$s'", current_call->name);
           throw RecursionException::create("function", current_call->name, current_call->location());
         }
+        // The first simplification resolves this call itself, later ones are tail calls
+        if (recursion_depth > 1 && Profiler::instance().isEnabled()) Profiler::tailCall(current_call->name);
+      }
+      if (simplified_expression->function) {
+        if (const FunctionProgram *program = FunctionVM::program(*simplified_expression->function)) {
+          return FunctionVM::run(*program, *expression_context);
+        }
       }
     } catch (EvaluationException& e) {
       if (e.traceDepth > 0) {
@@ -644,7 +662,8 @@ void Assert::performAssert(const AssignmentList& arguments, const Location& loca
 
 const Expression *Assert::evaluateStep(const std::shared_ptr<const Context>& context) const
 {
-  performAssert(this->arguments, this->loc, context);
+  // The VM run already checked the assertion
+  if (!FunctionVM::verifying()) performAssert(this->arguments, this->loc, context);
   return expr.get();
 }
 
@@ -668,6 +687,8 @@ Echo::Echo(AssignmentList args, Expression *expr, const Location& loc)
 
 const Expression *Echo::evaluateStep(const std::shared_ptr<const Context>& context) const
 {
+  // The VM run already printed the message
+  if (FunctionVM::verifying()) return expr.get();
   Arguments arguments{this->arguments, context};
   LOG(message_group::Echo, "%1$s", STR(arguments));
   return expr.get();
@@ -692,16 +713,16 @@ Let::Let(AssignmentList args, Expression *expr, const Location& loc)
 
 void Let::doSequentialAssignment(const AssignmentList& assignments, const Location& location, ContextHandle<Context>& targetContext)
 {
-  std::set<std::string> seen;
+  std::vector<Symbol> seen;
   for (const auto& assignment : assignments) {
     Value value = assignment->getExpr()->evaluate(*targetContext);
     if (assignment->getName().empty()) {
       LOG(message_group::Warning, location, targetContext->documentRoot(), "Assignment without variable name %1$s", value.toEchoStringNoThrow());
-    } else if (seen.find(assignment->getName()) != seen.end()) {
+    } else if (std::find(seen.begin(), seen.end(), assignment->getSymbol()) != seen.end()) {
       LOG(message_group::Warning, location, targetContext->documentRoot(), "Ignoring duplicate variable assignment %1$s = %2$s", assignment->getName(), value.toEchoStringNoThrow());
     } else {
-      targetContext->set_variable(assignment->getName(), std::move(value));
-      seen.insert(assignment->getName());
+      targetContext->set_variable(assignment->getSymbol(), std::move(value));
+      seen.push_back(assignment->getSymbol());
     }
   }
 }
@@ -814,10 +835,10 @@ LcFor::LcFor(AssignmentList args, Expression *expr, const Location& loc)
 {
 }
 
-static inline ContextHandle<Context> forContext(const std::shared_ptr<const Context>& context, const std::string& name, Value value)
+static inline ContextHandle<Context> forContext(const std::shared_ptr<const Context>& context, const Symbol& symbol, Value value)
 {
   ContextHandle<Context> innerContext{Context::create<Context>(context)};
-  innerContext->set_variable(name, std::move(value));
+  innerContext->set_variable(symbol, std::move(value));
   return innerContext;
 }
 
@@ -834,7 +855,7 @@ static void doForEach(
     return;
   }
 
-  const std::string& variable_name = assignments[assignment_index]->getName();
+  const Symbol& variable_name = assignments[assignment_index]->getSymbol();
   Value variable_values = assignments[assignment_index]->getExpr()->evaluate(context);
 
   if (variable_values.type() == Value::Type::RANGE) {
@@ -8,6 +8,7 @@
 #include "Assignment.h"
 #include "function.h"
 #include "memory.h"
+#include "SlotMap.h"
 #include "Value.h"
 
 template <class T> class ContextHandle;
@@ -34,6 +35,7 @@ public:
   void print(std::ostream& stream, const std::string& indent) const override;
 
 private:
+  friend class FunctionCompiler;
   [[nodiscard]] const char *opString() const;
 
   Op op;
@@ -65,6 +67,7 @@ public:
   void print(std::ostream& stream, const std::string& indent) const override;
 
 private:
+  friend class FunctionCompiler;
   [[nodiscard]] const char *opString() const;
 
   Op op;
@@ -80,6 +83,7 @@ public:
   [[nodiscard]] Value evaluate(const std::shared_ptr<const Context>& context) const override;
   void print(std::ostream& stream, const std::string& indent) const override;
 private:
+  friend class FunctionCompiler;
   shared_ptr<Expression> cond;
   shared_ptr<Expression> ifexpr;
   shared_ptr<Expression> elseexpr;
@@ -92,6 +96,7 @@ public:
   [[nodiscard]] Value evaluate(const std::shared_ptr<const Context>& context) const override;
   void print(std::ostream& stream, const std::string& indent) const override;
 private:
+  friend class FunctionCompiler;
   shared_ptr<Expression> array;
   shared_ptr<Expression> index;
 };
@@ -125,6 +130,8 @@ public:
   [[nodiscard]] const Expression *getStep() const { return step.get(); }
   [[nodiscard]] const Expression *getEnd() const { return end.get(); }
   [[nodiscard]] Value evaluate(const std::shared_ptr<const Context>& context) const override;
+  // Creates the range from evaluated bounds; step_val is ignored if the range has no step
+  [[nodiscard]] Value makeRange(double begin_val, double step_val, double end_val, const std::shared_ptr<const Context>& context) const;
   void print(std::ostream& stream, const std::string& indent) const override;
   [[nodiscard]] bool isLiteral() const override;
 private:
@@ -155,7 +162,10 @@ public:
   void print(std::ostream& stream, const std::string& indent) const override;
   [[nodiscard]] const std::string& get_name() const { return name; }
 private:
+  friend class FunctionCompiler;
   std::string name;
+  Symbol symbol;
+  mutable SlotHint hint;
 };
 
 class MemberLookup : public Expression
@@ -206,6 +216,7 @@ public:
   [[nodiscard]] Value evaluate(const std::shared_ptr<const Context>& context) const override;
   void print(std::ostream& stream, const std::string& indent) const override;
 private:
+  friend class FunctionCompiler;
   AssignmentList arguments;
   shared_ptr<Expression> expr;
 };
@@ -218,6 +229,7 @@ public:
   [[nodiscard]] Value evaluate(const std::shared_ptr<const Context>& context) const override;
   void print(std::ostream& stream, const std::string& indent) const override;
 private:
+  friend class FunctionCompiler;
   AssignmentList arguments;
   shared_ptr<Expression> expr;
 };
@@ -232,6 +244,7 @@ public:
   [[nodiscard]] Value evaluate(const std::shared_ptr<const Context>& context) const override;
   void print(std::ostream& stream, const std::string& indent) const override;
 private:
+  friend class FunctionCompiler;
   AssignmentList arguments;
   shared_ptr<Expression> expr;
 };
@@ -249,6 +262,7 @@ public:
   [[nodiscard]] Value evaluate(const std::shared_ptr<const Context>& context) const override;
   void print(std::ostream& stream, const std::string& indent) const override;
 private:
+  friend class FunctionCompiler;
   shared_ptr<Expression> cond;
   shared_ptr<Expression> ifexpr;
   shared_ptr<Expression> elseexpr;
@@ -262,6 +276,7 @@ public:
   [[nodiscard]] Value evaluate(const std::shared_ptr<const Context>& context) const override;
   void print(std::ostream& stream, const std::string& indent) const override;
 private:
+  friend class FunctionCompiler;
   AssignmentList arguments;
   shared_ptr<Expression> expr;
 };
@@ -285,8 +300,10 @@ public:
   LcEach(Expression *expr, const Location& loc);
   [[nodiscard]] Value evaluate(const std::shared_ptr<const Context>& context) const override;
   void print(std::ostream& stream, const std::string& indent) const override;
-private:
+  // Flattens the already evaluated argument of each
   Value evalRecur(Value&& v, const std::shared_ptr<const Context>& context) const;
+private:
+  friend class FunctionCompiler;
   shared_ptr<Expression> expr;
 };
 
@@ -297,6 +314,7 @@ public:
   [[nodiscard]] Value evaluate(const std::shared_ptr<const Context>& context) const override;
   void print(std::ostream& stream, const std::string& indent) const override;
 private:
+  friend class FunctionCompiler;
   AssignmentList arguments;
   shared_ptr<Expression> expr;
 };
@@ -0,0 +1,824 @@
+#include "FunctionVM.h"
+#include "Arguments.h"
+#include "compiler_specific.h"
+#include "Context.h"
+#include "Expression.h"
+#include "Feature.h"
+#include "Profiler.h"
+#include "StackCheck.h"
+#include "exceptions.h"
+#include "function.h"
+#include "printutils.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+#include <boost/optional.hpp>
+
+namespace {
+
+constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+enum class Op : uint8_t {
+  Constant,        // a = constants[b]
+  Undefined,       // a = undef
+  Copy,            // a = b
+  Variable,        // a = free variable variables[b], looked up in the scope context
+  Not,             // a = !b
+  Negate,          // a = -b
+  Binary,          // a = b <op d> c
+  ToBool,          // a = bool(b)
+  Jump,            // goto target
+  JumpIfFalse,     // if !a goto target
+  JumpIfTrue,      // if a goto target
+  JumpIfNotNumber, // if a is not a number goto target
+  Index,           // a = b[c]
+  Range,           // a = [b : c : d], c is none without step
+  Vector1,         // a = [b]
+  NewVector,       // a = [], reserving b elements
+  NewEmbedded,     // a = embedded []
+  EmptyEmbedded,   // a = empty embedded vector
+  Append,          // a.push_back(b)
+  Each,            // a = each b
+  IterStart,       // start iterator a over b, reserving the size in vector c unless none
+  IterNext,        // a = next value of iterator b, or goto target if done
+  IterEnd,         // release iterator a
+  Resolve,         // resolve callee a for b arguments; if unknown c = undef and goto d, if not callable goto target
+  Call,            // a = callee b(registers c .. c + d)
+  TailCall,        // return callee b(registers c .. c + d)
+  Fallback,        // a = interpreted fallbacks[b]
+  Return           // return a
+};
+
+struct Instruction {
+  Op op;
+  uint32_t a{none};
+  uint32_t b{none};
+  uint32_t c{none};
+  uint32_t d{none};
+  uint32_t target{none};
+  // Source node, for messages and node specific data
+  const Expression *node{nullptr};
+};
+
+struct VariableReference {
+  explicit VariableReference(Symbol symbol) : symbol(std::move(symbol)) {}
+  Symbol symbol;
+  mutable SlotHint hint;
+};
+
+enum class FallbackKind { Evaluate, AssertStep, EchoStep };
+
+// An expression evaluated by the interpreter, with the registers visible to it
+struct FallbackExpression {
+  FallbackKind kind;
+  const Expression *expression;
+  std::vector<std::pair<Symbol, uint32_t>> bindings;
+};
+
+} // namespace
+
+struct FunctionProgram {
+  const UserFunction *function{nullptr};
+  // Bound to registers 0 .. parameters.size() - 1
+  std::vector<Symbol> parameters;
+  // False if the function needs argument matching by the interpreter, e.g. for $parameters
+  bool fastcall{true};
+  std::vector<Instruction> code;
+  std::vector<Value> constants;
+  std::deque<VariableReference> variables;
+  std::vector<FallbackExpression> fallbacks;
+  uint32_t registers{0};
+  uint32_t iterators{0};
+  uint32_t callees{0};
+};
+
+/*!
+   Lowers a function body to FunctionProgram code. Subexpressions are compiled
+   into the register given by the caller; temporaries are allocated above it
+   and released in stack order.
+ */
+class FunctionCompiler
+{
+public:
+  FunctionCompiler(FunctionProgram& program) : program(program) {}
+  bool compileFunction(const UserFunction& function);
+
+private:
+  void compile(const Expression *expression, uint32_t dst, bool tail);
+  void compileLet(const AssignmentList& assignments, const Expression *body, uint32_t dst, bool tail);
+  void compileFor(const LcFor *lcfor, size_t index, uint32_t output);
+  void compileCall(const FunctionCall *call, uint32_t dst, bool tail);
+  void compileFallback(FallbackKind kind, const Expression *expression, uint32_t dst);
+
+  uint32_t allocate() {
+    program.registers = std::max(program.registers, next + 1);
+    return next++;
+  }
+  size_t emit(Op op, uint32_t a = none, uint32_t b = none, uint32_t c = none, uint32_t d = none, const Expression *node = nullptr) {
+    program.code.push_back(Instruction{op, a, b, c, d, none, node});
+    return program.code.size() - 1;
+  }
+  uint32_t here() const { return static_cast<uint32_t>(program.code.size()); }
+  void patch(size_t instruction) { program.code[instruction].target = here(); }
+  boost::optional<uint32_t> local(const Symbol& symbol) const {
+    for (auto it = scope.rbegin(); it != scope.rend(); ++it) {
+      if (it->first == symbol) return it->second;
+    }
+    return boost::none;
+  }
+  // Returns false for names that cannot live in a register
+  bool bindable(const Symbol& symbol) const { return !symbol.empty() && !symbol.name().empty() && !symbol.isConfigVariable(); }
+
+  FunctionProgram& program;
+  // Variables bound to registers, innermost last
+  std::vector<std::pair<Symbol, uint32_t>> scope;
+  uint32_t next{0};
+  uint32_t iterators{0};
+  uint32_t callees{0};
+  bool ok{true};
+};
+
+bool FunctionCompiler::compileFunction(const UserFunction& function)
+{
+  program.function = &function;
+  for (const auto& parameter : function.parameters) {
+    const Symbol& symbol = parameter->getSymbol();
+    const uint32_t reg = allocate();
+    program.parameters.push_back(symbol);
+    if (!bindable(symbol) || local(symbol)) {
+      program.fastcall = false;
+    } else {
+      scope.emplace_back(symbol, reg);
+    }
+  }
+  const uint32_t result = allocate();
+  compile(function.expr.get(), result, true);
+  emit(Op::Return, result);
+  return ok;
+}
+
+void FunctionCompiler::compile(const Expression *expression, uint32_t dst, bool tail)
+{
+  if (!expression) {
+    emit(Op::Undefined, dst);
+    return;
+  }
+  const uint32_t mark = next;
+  const auto& type = typeid(*expression);
+  if (type == typeid(Literal)) {
+    program.constants.push_back(expression->evaluate(nullptr));
+    emit(Op::Constant, dst, static_cast<uint32_t>(program.constants.size() - 1));
+  } else if (type == typeid(Lookup)) {
+    const auto *lookup = static_cast<const Lookup *>(expression);
+    if (auto reg = local(lookup->symbol)) {
+      emit(Op::Copy, dst, *reg);
+    } else {
+      program.variables.emplace_back(lookup->symbol);
+      emit(Op::Variable, dst, static_cast<uint32_t>(program.variables.size() - 1), none, none, lookup);
+    }
+  } else if (type == typeid(UnaryOp)) {
+    const auto *unary = static_cast<const UnaryOp *>(expression);
+    compile(unary->expr.get(), dst, false);
+    emit(unary->op == UnaryOp::Op::Not ? Op::Not : Op::Negate, dst, dst, none, none, unary);
+  } else if (type == typeid(BinaryOp)) {
+    const auto *binary = static_cast<const BinaryOp *>(expression);
+    compile(binary->left.get(), dst, false);
+    if (binary->op == BinaryOp::Op::LogicalAnd || binary->op == BinaryOp::Op::LogicalOr) {
+      const size_t shortcut = emit(binary->op == BinaryOp::Op::LogicalAnd ? Op::JumpIfFalse : Op::JumpIfTrue, dst);
+      compile(binary->right.get(), dst, false);
+      patch(shortcut);
+      emit(Op::ToBool, dst, dst);
+    } else {
+      const uint32_t right = allocate();
+      compile(binary->right.get(), right, false);
+      emit(Op::Binary, dst, dst, right, static_cast<uint32_t>(binary->op), binary);
+    }
+  } else if (type == typeid(TernaryOp)) {
+    const auto *ternary = static_cast<const TernaryOp *>(expression);
+    compile(ternary->cond.get(), dst, false);
+    const size_t otherwise = emit(Op::JumpIfFalse, dst);
+    compile(ternary->ifexpr.get(), dst, tail);
+    const size_t end = emit(Op::Jump);
+    patch(otherwise);
+    compile(ternary->elseexpr.get(), dst, tail);
+    patch(end);
+  } else if (type == typeid(ArrayLookup)) {
+    const auto *lookup = static_cast<const ArrayLookup *>(expression);
+    compile(lookup->array.get(), dst, false);
+    const uint32_t index = allocate();
+    compile(lookup->index.get(), index, false);
+    emit(Op::Index, dst, dst, index);
+  } else if (type == typeid(Range)) {
+    // Bounds are only evaluated while the previous ones are numbers, as in Range::evaluate()
+    const auto *range = static_cast<const Range *>(expression);
+    std::vector<size_t> undefined;
+    compile(range->getBegin(), dst, false);
+    undefined.push_back(emit(Op::JumpIfNotNumber, dst));
+    const uint32_t end = allocate();
+    compile(range->getEnd(), end, false);
+    undefined.push_back(emit(Op::JumpIfNotNumber, end));
+    uint32_t step = none;
+    if (range->getStep()) {
+      step = allocate();
+      compile(range->getStep(), step, false);
+      undefined.push_back(emit(Op::JumpIfNotNumber, step));
+    }
+    emit(Op::Range, dst, dst, step, end, range);
+    const size_t done = emit(Op::Jump);
+    for (size_t jump : undefined) patch(jump);
+    emit(Op::Undefined, dst);
+    patch(done);
+  } else if (type == typeid(Vector)) {
+    const auto& children = static_cast<const Vector *>(expression)->getChildren();
+    if (children.size() == 1) {
+      compile(children.front().get(), dst, false);
+      emit(Op::Vector1, dst, dst);
+    } else {
+      emit(Op::NewVector, dst, static_cast<uint32_t>(children.size()));
+      const uint32_t element = allocate();
+      for (const auto& child : children) {
+        compile(child.get(), element, false);
+        emit(Op::Append, dst, element);
+      }
+    }
+  } else if (type == typeid(Let)) {
+    const auto *let = static_cast<const Let *>(expression);
+    compileLet(let->arguments, let->expr.get(), dst, tail);
+  } else if (type == typeid(LcLet)) {
+    const auto *let = static_cast<const LcLet *>(expression);
+    compileLet(let->arguments, let->expr.get(), dst, false);
+  } else if (type == typeid(LcIf)) {
+    const auto *lcif = static_cast<const LcIf *>(expression);
+    compile(lcif->cond.get(), dst, false);
+    const size_t otherwise = emit(Op::JumpIfFalse, dst);
+    compile(lcif->ifexpr.get(), dst, false);
+    const size_t end = emit(Op::Jump);
+    patch(otherwise);
+    if (lcif->elseexpr) {
+      compile(lcif->elseexpr.get(), dst, false);
+    } else {
+      emit(Op::EmptyEmbedded, dst);
+    }
+    patch(end);
+  } else if (type == typeid(LcEach)) {
+    const auto *each = static_cast<const LcEach *>(expression);
+    compile(each->expr.get(), dst, false);
+    emit(Op::Each, dst, dst, none, none, each);
+  } else if (type == typeid(LcFor)) {
+    emit(Op::NewEmbedded, dst);
+    compileFor(static_cast<const LcFor *>(expression), 0, dst);
+  } else if (type == typeid(Assert)) {
+    const auto *assertion = static_cast<const Assert *>(expression);
+    compileFallback(FallbackKind::AssertStep, assertion, dst);
+    compile(assertion->expr.get(), dst, tail);
+  } else if (type == typeid(Echo)) {
+    const auto *echo = static_cast<const Echo *>(expression);
+    compileFallback(FallbackKind::EchoStep, echo, dst);
+    compile(echo->expr.get(), dst, tail);
+  } else if (type == typeid(FunctionCall)) {
+    compileCall(static_cast<const FunctionCall *>(expression), dst, tail);
+  } else {
+    compileFallback(FallbackKind::Evaluate, expression, dst);
+  }
+  next = mark;
+}
+
+void FunctionCompiler::compileLet(const AssignmentList& assignments, const Expression *body, uint32_t dst, bool tail)
+{
+  // Warnings for unnamed and duplicate assignments are left to the interpreter
+  const size_t scopesize = scope.size();
+  for (const auto& assignment : assignments) {
+    const Symbol& symbol = assignment->getSymbol();
+    if (!bindable(symbol) ||
+        std::any_of(scope.begin() + scopesize, scope.end(), [&symbol](const auto& binding) { return binding.first == symbol; })) {
+      ok = false;
+      return;
+    }
+    const uint32_t reg = allocate();
+    compile(assignment->getExpr().get(), reg, false);
+    scope.emplace_back(symbol, reg);
+  }
+  compile(body, dst, tail);
+  scope.resize(scopesize);
+}
+
+void FunctionCompiler::compileFor(const LcFor *lcfor, size_t index, uint32_t output)
+{
+  const uint32_t mark = next;
+  if (index == lcfor->arguments.size()) {
+    const uint32_t element = allocate();
+    compile(lcfor->expr.get(), element, false);
+    emit(Op::Append, output, element);
+    next = mark;
+    return;
+  }
+
+  const auto& assignment = lcfor->arguments[index];
+  if (!bindable(assignment->getSymbol())) {
+    ok = false;
+    return;
+  }
+  const uint32_t variable = allocate();
+  compile(assignment->getExpr().get(), variable, false);
+  const uint32_t iterator = iterators++;
+  program.iterators = std::max(program.iterators, iterators);
+  // Only the outermost loop reserves, like LcFor::evaluate()
+  emit(Op::IterStart, iterator, variable, index == 0 ? output : none, none, lcfor);
+  const uint32_t loop = here();
+  const size_t step = emit(Op::IterNext, variable, iterator);
+  scope.emplace_back(assignment->getSymbol(), variable);
+  compileFor(lcfor, index + 1, output);
+  scope.pop_back();
+  program.code[emit(Op::Jump)].target = loop;
+  patch(step);
+  emit(Op::IterEnd, iterator);
+  iterators--;
+  next = mark;
+}
+
+void FunctionCompiler::compileCall(const FunctionCall *call, uint32_t dst, bool tail)
+{
+  const bool named = std::any_of(call->arguments.begin(), call->arguments.end(),
+                                 [](const auto& argument) { return !argument->getName().empty(); });
+  // Function values in registers and calls on expressions are left to the interpreter
+  if (!call->isLookup || named || local(Symbol(call->name))) {
+    compileFallback(FallbackKind::Evaluate, call, dst);
+    return;
+  }
+
+  const uint32_t callee = callees++;
+  program.callees = std::max(program.callees, callees);
+  const uint32_t argc = static_cast<uint32_t>(call->arguments.size());
+  const size_t resolve = emit(Op::Resolve, callee, argc, dst, none, call);
+  const uint32_t args = next;
+  for (const auto& argument : call->arguments) {
+    compile(argument->getExpr().get(), allocate(), false);
+  }
+  emit(tail ? Op::TailCall : Op::Call, dst, callee, args, argc, call);
+  const size_t end = emit(Op::Jump);
+  patch(resolve);
+  compileFallback(FallbackKind::Evaluate, call, dst);
+  patch(end);
+  program.code[resolve].d = here();
+  callees--;
+}
+
+void FunctionCompiler::compileFallback(FallbackKind kind, const Expression *expression, uint32_t dst)
+{
+  program.fallbacks.push_back(FallbackExpression{kind, expression, scope});
+  emit(Op::Fallback, dst, static_cast<uint32_t>(program.fallbacks.size() - 1));
+}
+
+namespace {
+
+// Set while function-vm-verify evaluates the reference result
+thread_local bool interpreting = false;
+
+class Iteration
+{
+public:
+  Iteration() : source(Value::undefined.clone()) {}
+
+  void start(Value&& values, const Expression *node, const std::shared_ptr<const Context>& context, Value *output) {
+    this->source = std::move(values);
+    this->kind = Kind::None;
+    size_t size = 0;
+    switch (this->source.type()) {
+    case Value::Type::RANGE: {
+      const RangeType& range = this->source.toRange();
+      uint32_t steps = range.numValues();
+      if (steps >= 1000000) {
+        LOG(message_group::Warning, node->location(), context->documentRoot(),
+            "Bad range parameter in for statement: too many elements (%1$lu)", steps);
+        return;
+      }
+      this->range.emplace(range.begin());
+      this->rangeEnd.emplace(range.end());
+      this->kind = Kind::Range;
+      size = steps;
+      break;
+    }
+    case Value::Type::VECTOR:
+      this->vector = this->source.toVector().begin();
+      this->vectorEnd = this->source.toVector().end();
+      this->kind = Kind::Vector;
+      size = this->source.toVector().size();
+      break;
+    case Value::Type::OBJECT:
+      this->index = 0;
+      this->kind = Kind::Keys;
+      size = this->source.toObject().keys().size();
+      break;
+    case Value::Type::STRING:
+      this->string = this->source.toStrUtf8Wrapper().begin();
+      this->stringEnd = this->source.toStrUtf8Wrapper().end();
+      this->kind = Kind::String;
+      size = this->source.toStrUtf8Wrapper().size();
+      break;
+    case Value::Type::UNDEFINED:
+      return;
+    default:
+      this->kind = Kind::Single;
+      return;
+    }
+    if (output) output->toEmbeddedVectorNonConst().reserve(size);
+  }
+
+  bool next(Value& value) {
+    switch (this->kind) {
+    case Kind::Range:
+      if (*this->range == *this->rangeEnd) return false;
+      value = Value(**this->range);
+      ++*this->range;
+      return true;
+    case Kind::Vector:
+      if (this->vector == this->vectorEnd) return false;
+      value = this->vector->clone();
+      ++this->vector;
+      return true;
+    case Kind::Keys: {
+      const auto& keys = this->source.toObject().keys();
+      if (this->index == keys.size()) return false;
+      value = Value(keys[this->index++]);
+      return true;
+    }
+    case Kind::String:
+      if (this->string == this->stringEnd) return false;
+      value = Value(*this->string);
+      ++this->string;
+      return true;
+    case Kind::Single:
+      value = std::move(this->source);
+      this->kind = Kind::None;
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  void reset() {
+    this->kind = Kind::None;
+    this->range.reset();
+    this->rangeEnd.reset();
+    this->source = Value::undefined.clone();
+  }
+
+private:
+  enum class Kind { None, Range, Vector, Keys, String, Single };
+  Kind kind{Kind::None};
+  Value source;
+  boost::optional<RangeType::iterator> range, rangeEnd;
+  VectorType::iterator vector, vectorEnd;
+  str_utf8_wrapper::iterator string, stringEnd;
+  size_t index{0};
+};
+
+struct Callee {
+  const BuiltinFunction *builtin{nullptr};
+  const FunctionProgram *program{nullptr};
+  std::shared_ptr<const Context> defining_context;
+};
+
+// Register files of finished frames, reused to avoid allocating on every call
+thread_local std::vector<std::vector<Value>> registerpool;
+
+struct Frame {
+  Frame(const FunctionProgram& program, std::shared_ptr<const Context> scope) : scope(std::move(scope)) {
+    if (!registerpool.empty()) {
+      this->registers = std::move(registerpool.back());
+      registerpool.pop_back();
+    }
+    setup(program);
+  }
+  ~Frame() {
+    this->registers.clear();
+    if (registerpool.size() < 64) registerpool.push_back(std::move(this->registers));
+  }
+  Frame(const Frame&) = delete;
+  Frame& operator=(const Frame&) = delete;
+
+  void setup(const FunctionProgram& program) {
+    this->program = &program;
+    this->registers.reserve(program.registers);
+    for (auto& value : this->registers) value = Value::undefined.clone();
+    while (this->registers.size() < program.registers) this->registers.push_back(Value::undefined.clone());
+    this->iterators.resize(std::max<size_t>(this->iterators.size(), program.iterators));
+    this->callees.resize(std::max<size_t>(this->callees.size(), program.callees));
+  }
+
+  const FunctionProgram *program;
+  // The call being evaluated, for traces; nullptr for the frame entered from the interpreter
+  const FunctionCall *call{nullptr};
+  // Context for free variables and function lookups
+  std::shared_ptr<const Context> scope;
+  std::vector<Value> registers;
+  std::vector<Iteration> iterators;
+  std::vector<Callee> callees;
+};
+
+Value execute(Frame& frame);
+
+void NOINLINE print_recursion(const FunctionCall *call, const std::shared_ptr<const Context>& context)
+{
+  LOG(message_group::Error, call->location(), context->documentRoot(), "Recursion detected calling function '%1$s'", call->get_name());
+}
+
+void NOINLINE print_trace(const FunctionCall *call, const std::shared_ptr<const Context>& context)
+{
+  LOG(message_group::Trace, call->location(), context->documentRoot(), "called by '%1$s'", call->get_name());
+}
+
+// Binds arguments, and defaults for the missing ones, to the parameter registers
+void bindParameters(Frame& frame, const Callee& callee, Value *args, uint32_t argc)
+{
+  const auto& parameters = callee.program->function->parameters;
+  for (size_t i = 0; i < parameters.size(); ++i) {
+    if (i < argc) {
+      frame.registers[i] = std::move(args[i]);
+    } else if (const auto& expr = parameters[i]->getExpr()) {
+      frame.registers[i] = expr->evaluate(callee.defining_context);
+    }
+  }
+}
+
+Value callBuiltin(Frame& frame, const Callee& callee, const FunctionCall *call, uint32_t args, uint32_t argc)
+{
+  Arguments arguments(frame.scope->session());
+  arguments.reserve(argc);
+  for (uint32_t i = 0; i < argc; ++i) arguments.emplace_back(boost::none, std::move(frame.registers[args + i]));
+  return callee.builtin->evaluate_arguments(std::move(arguments), call->location());
+}
+
+Value invoke(Frame& caller, const Callee& callee, const FunctionCall *call, uint32_t args, uint32_t argc)
+{
+  if (StackCheck::inst().check()) {
+    print_recursion(call, caller.scope);
+    throw RecursionException::create("function", call->get_name(), call->location());
+  }
+  Profiler::Scope profile("function", call->get_name(), call->location(), &caller.scope->session()->accounting());
+  if (callee.builtin) return callBuiltin(caller, callee, call, args, argc);
+
+  Frame frame(*callee.program, callee.defining_context);
+  frame.call = call;
+  bindParameters(frame, callee, caller.registers.data() + args, argc);
+  try {
+    return execute(frame);
+  } catch (EvaluationException& e) {
+    if (e.traceDepth > 0) {
+      print_trace(frame.call, caller.scope);
+      e.traceDepth--;
+    }
+    throw;
+  }
+}
+
+Value interpret(Frame& frame, const FallbackExpression& fallback)
+{
+  ContextHandle<Context> context{Context::create<Context>(frame.scope)};
+  for (const auto& [symbol, reg] : fallback.bindings) {
+    context->set_variable(symbol, frame.registers[reg].clone());
+  }
+  switch (fallback.kind) {
+  case FallbackKind::AssertStep:
+    (void)static_cast<const Assert *>(fallback.expression)->evaluateStep(*context);
+    return Value::undefined.clone();
+  case FallbackKind::EchoStep:
+    (void)static_cast<const Echo *>(fallback.expression)->evaluateStep(*context);
+    return Value::undefined.clone();
+  default:
+    return fallback.expression->evaluate(*context);
+  }
+}
+
+Value binary(BinaryOp::Op op, const Value& left, const Value& right)
+{
+  switch (op) {
+  case BinaryOp::Op::Exponent:     return left ^ right;
+  case BinaryOp::Op::Multiply:     return left * right;
+  case BinaryOp::Op::Divide:       return left / right;
+  case BinaryOp::Op::Modulo:       return left % right;
+  case BinaryOp::Op::Plus:         return left + right;
+  case BinaryOp::Op::Minus:        return left - right;
+  case BinaryOp::Op::Less:         return left < right;
+  case BinaryOp::Op::LessEqual:    return left <= right;
+  case BinaryOp::Op::Greater:      return left > right;
+  case BinaryOp::Op::GreaterEqual: return left >= right;
+  case BinaryOp::Op::Equal:        return left == right;
+  case BinaryOp::Op::NotEqual:     return left != right;
+  default:
+    assert(false && "Non-existent binary operator!");
+    throw EvaluationException("Non-existent binary operator!");
+  }
+}
+
+VectorType& vectorIn(Value& value)
+{
+  if (value.type() == Value::Type::EMBEDDED_VECTOR) return value.toEmbeddedVectorNonConst();
+  return value.toVectorNonConst();
+}
+
+Value execute(Frame& frame)
+{
+  const FunctionProgram *program = frame.program;
+  auto& r = frame.registers;
+  unsigned int tailcalls = 0;
+  size_t pc = 0;
+  while (true) {
+    const Instruction& in = program->code[pc++];
+    switch (in.op) {
+    case Op::Constant:
+      r[in.a] = program->constants[in.b].clone();
+      break;
+    case Op::Undefined:
+      r[in.a] = Value::undefined.clone();
+      break;
+    case Op::Copy:
+      r[in.a] = r[in.b].clone();
+      break;
+    case Op::Variable: {
+      const auto& variable = program->variables[in.b];
+      r[in.a] = frame.scope->lookup_variable(variable.symbol, variable.hint, in.node->location()).clone();
+      break;
+    }
+    case Op::Not:
+      r[in.a] = Value(!r[in.b].toBool());
+      break;
+    case Op::Negate:
+      r[in.a] = in.node->checkUndef(-r[in.b], frame.scope);
+      break;
+    case Op::Binary:
+      r[in.a] = in.node->checkUndef(binary(static_cast<BinaryOp::Op>(in.d), r[in.b], r[in.c]), frame.scope);
+      break;
+    case Op::ToBool:
+      r[in.a] = Value(r[in.b].toBool());
+      break;
+    case Op::Jump:
+      pc = in.target;
+      break;
+    case Op::JumpIfFalse:
+      if (!r[in.a].toBool()) pc = in.target;
+      break;
+    case Op::JumpIfTrue:
+      if (r[in.a].toBool()) pc = in.target;
+      break;
+    case Op::JumpIfNotNumber:
+      if (r[in.a].type() != Value::Type::NUMBER) pc = in.target;
+      break;
+    case Op::Index:
+      r[in.a] = r[in.b][r[in.c]];
+      break;
+    case Op::Range:
+      r[in.a] = static_cast<const Range *>(in.node)->makeRange(
+        r[in.b].toDouble(), in.c == none ? 0 : r[in.c].toDouble(), r[in.d].toDouble(), frame.scope);
+      break;
+    case Op::Vector1: {
+      Value value = std::move(r[in.b]);
+      if (value.type() == Value::Type::EMBEDDED_VECTOR) {
+        r[in.a] = VectorType(std::move(value.toEmbeddedVectorNonConst()));
+      } else {
+        VectorType vec(frame.scope->session());
+        vec.emplace_back(std::move(value));
+        r[in.a] = std::move(vec);
+      }
+      break;
+    }
+    case Op::NewVector: {
+      VectorType vec(frame.scope->session());
+      vec.reserve(in.b);
+      r[in.a] = std::move(vec);
+      break;
+    }
+    case Op::NewEmbedded:
+      r[in.a] = EmbeddedVectorType(frame.scope->session());
+      break;
+    case Op::EmptyEmbedded:
+      r[in.a] = EmbeddedVectorType::Empty();
+      break;
+    case Op::Append:
+      vectorIn(r[in.a]).emplace_back(std::move(r[in.b]));
+      break;
+    case Op::Each:
+      r[in.a] = static_cast<const LcEach *>(in.node)->evalRecur(std::move(r[in.b]), frame.scope);
+      break;
+    case Op::IterStart:
+      frame.iterators[in.a].start(std::move(r[in.b]), in.node, frame.scope, in.c == none ? nullptr : &r[in.c]);
+      break;
+    case Op::IterNext:
+      if (!frame.iterators[in.b].next(r[in.a])) pc = in.target;
+      break;
+    case Op::IterEnd:
+      frame.iterators[in.a].reset();
+      break;
+    case Op::Resolve: {
+      const auto *call = static_cast<const FunctionCall *>(in.node);
+      Callee& callee = frame.callees[in.a];
+      callee = Callee();
+      auto f = frame.scope->lookup_function(call->get_name(), call->location());
+      if (!f) {
+        r[in.c] = Value::undefined.clone();
+        pc = in.d;
+      } else if (f->index() == 0) {
+        const auto *builtin = std::get<const BuiltinFunction *>(*f);
+        if (builtin->evaluate_arguments) callee.builtin = builtin;
+        else pc = in.target;
+      } else if (f->index() == 1) {
+        const auto& user = std::get<CallableUserFunction>(*f);
+        const FunctionProgram *compiled = FunctionVM::program(*user.function);
+        if (compiled && compiled->fastcall && in.b <= compiled->parameters.size()) {
+          callee.program = compiled;
+          callee.defining_context = user.defining_context;
+        } else {
+          pc = in.target;
+        }
+      } else {
+        pc = in.target;
+      }
+      break;
+    }
+    case Op::Call:
+      r[in.a] = invoke(frame, frame.callees[in.b], static_cast<const FunctionCall *>(in.node), in.c, in.d);
+      break;
+    case Op::TailCall: {
+      const auto *call = static_cast<const FunctionCall *>(in.node);
+      Callee callee = std::move(frame.callees[in.b]);
+      if (callee.builtin) {
+        r[in.a] = invoke(frame, callee, call, in.c, in.d);
+        break;
+      }
+      if (tailcalls++ == 1000000) {
+        print_recursion(call, frame.scope);
+        throw RecursionException::create("function", call->get_name(), call->location());
+      }
+      if (Profiler::instance().isEnabled()) Profiler::tailCall(call->get_name());
+      // Arguments are moved out before the registers are reset for the callee
+      std::vector<Value> args;
+      args.reserve(in.d);
+      for (uint32_t i = 0; i < in.d; ++i) args.push_back(std::move(r[in.c + i]));
+      program = callee.program;
+      frame.call = call;
+      frame.scope = callee.defining_context;
+      frame.setup(*program);
+      bindParameters(frame, callee, args.data(), in.d);
+      pc = 0;
+      break;
+    }
+    case Op::Fallback:
+      r[in.a] = interpret(frame, program->fallbacks[in.b]);
+      break;
+    case Op::Return:
+      return std::move(r[in.a]);
+    }
+  }
+}
+
+} // namespace
+
+const FunctionProgram *FunctionVM::program(const UserFunction& function)
+{
+  if (!Feature::ExperimentalFunctionVM.is_enabled() || interpreting) return nullptr;
+  std::call_once(function.compile_once, [&function]() {
+    auto program = std::make_shared<FunctionProgram>();
+    if (FunctionCompiler(*program).compileFunction(function)) function.program = std::move(program);
+  });
+  return function.program.get();
+}
+
+bool FunctionVM::verifying()
+{
+  return interpreting;
+}
+
+Value FunctionVM::run(const FunctionProgram& program, const std::shared_ptr<const Context>& body_context)
+{
+  Value result = [&]() {
+    Frame frame(program, body_context);
+    for (size_t i = 0; i < program.parameters.size(); ++i) {
+      if (auto value = body_context->lookup_local_variable(program.parameters[i])) frame.registers[i] = value->clone();
+    }
+    return execute(frame);
+  }();
+  if (!Feature::ExperimentalFunctionVMVerify.is_enabled()) return result;
+
+  interpreting = true;
+  Value reference = [&]() {
+    try {
+      return program.function->expr ? program.function->expr->evaluate(body_context) : Value::undefined.clone();
+    } catch (...) {
+      interpreting = false;
+      throw;
+    }
+  }();
+  interpreting = false;
+  const auto vm = result.toEchoStringNoThrow();
+  const auto interpreter = reference.toEchoStringNoThrow();
+  if (vm != interpreter) {
+    LOG(message_group::Warning, program.function->location(), body_context->documentRoot(),
+        "Function VM result for '%1$s' differs from interpreter: %2$s != %3$s", program.function->name, vm, interpreter);
+  }
+  return reference;
+}
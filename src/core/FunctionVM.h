@@ -0,0 +1,47 @@
+#pragma once
+
+#include <memory>
+#include "Value.h"
+
+class Context;
+class UserFunction;
+struct FunctionProgram;
+
+/*!
+   Optional bytecode compiler and virtual machine for user-defined functions.
+
+   The body of a UserFunction is lowered to register bytecode on its first call.
+   Parameters and let/for variables live in registers instead of Contexts, and
+   list comprehensions run as loops instead of recursing over per-iteration
+   contexts. Calls to builtin functions and to other compiled functions with
+   positional arguments stay inside the VM, including tail calls.
+
+   Everything else (member lookups, function literals, C-style for, echo and
+   assert arguments, calls the VM cannot make itself) is handed back to the
+   tree-walking interpreter, in a Context holding the current registers.
+   Functions binding $special variables in let or for are not compiled at all,
+   since those are dynamically scoped.
+
+   Enabled by the function-vm feature. With function-vm-verify, each function
+   entered through the VM is also evaluated by the interpreter, and differing
+   results are reported. Echo and assert only take effect on the VM run.
+ */
+class FunctionVM
+{
+public:
+  /*!
+     Returns the compiled body of function, compiling it on first use, or nullptr
+     if the VM is disabled or the body cannot be compiled.
+   */
+  static const FunctionProgram *program(const UserFunction& function);
+  /*!
+     Evaluates a compiled function. body_context must hold the parameters, as set
+     up by FunctionCall::evaluate().
+   */
+  static Value run(const FunctionProgram& program, const std::shared_ptr<const Context>& body_context);
+  /*!
+     Returns true while the calling thread evaluates the reference result for
+     function-vm-verify, whose echo and assert side effects are suppressed.
+   */
+  static bool verifying();
+};
@@ -0,0 +1,192 @@
+#include "InstantiationCache.h"
+#include "Assignment.h"
+#include "ModuleInstantiation.h"
+#include "ScopeContext.h"
+#include "SourceFile.h"
+#include "UserModule.h"
+#include "function.h"
+#include "node.h"
+#include "exceptions.h"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <unordered_set>
+
+namespace {
+
+using NameSet = std::unordered_set<std::string>;
+
+// Builtins whose result is not determined by their arguments
+const NameSet impure_builtins = {"rands", "import", "surface", "dxf_dim", "dxf_cross"};
+
+// Adds the identifiers in text to names
+void collectNames(const std::string& text, NameSet& names)
+{
+  for (size_t i = 0; i < text.size();) {
+    const unsigned char c = text[i];
+    if (std::isalpha(c) || c == '_' || c == '$') {
+      size_t end = i + 1;
+      while (end < text.size() && (std::isalnum(static_cast<unsigned char>(text[end])) || text[end] == '_')) ++end;
+      names.emplace(text, i, end - i);
+      i = end;
+    } else if (std::isdigit(c)) {
+      // skip numbers, including exponents
+      while (i < text.size() && (std::isalnum(static_cast<unsigned char>(text[i])) || text[i] == '.')) ++i;
+    } else {
+      ++i;
+    }
+  }
+}
+
+// Source lines of the root file, to compare what the printed AST does not show (e.g. number precision)
+class SourceLines
+{
+public:
+  SourceLines(const std::string& text, std::string path) : text(text), path(std::move(path)) {
+    this->starts.push_back(0);
+    for (size_t i = 0; i < text.size(); ++i) {
+      if (text[i] == '\n') this->starts.push_back(i + 1);
+    }
+  }
+
+  // The printed node, followed by the source lines it spans if it is in the root file
+  std::string key(const ASTNode& node) const {
+    std::ostringstream stream;
+    node.print(stream, "");
+    const Location& loc = node.location();
+    stream << '@' << loc.firstLine() << ':' << loc.firstColumn() << '-' << loc.lastLine() << ':' << loc.lastColumn();
+    if (!loc.isNone() && loc.fileName() == this->path && loc.firstLine() >= 1 &&
+        loc.firstLine() <= loc.lastLine() && static_cast<size_t>(loc.lastLine()) <= this->starts.size()) {
+      const size_t begin = this->starts[loc.firstLine() - 1];
+      const size_t end = static_cast<size_t>(loc.lastLine()) < this->starts.size() ? this->starts[loc.lastLine()] : this->text.size();
+      stream << '\n' << this->text.substr(begin, end - begin);
+    }
+    return stream.str();
+  }
+
+private:
+  const std::string& text;
+  std::string path;
+  std::vector<size_t> starts;
+};
+
+} // namespace
+
+std::shared_ptr<AbstractNode> InstantiationCache::instantiate(const std::shared_ptr<const SourceFile>& file, const std::string& text,
+                                                              const std::string& inputs, const std::shared_ptr<const Context>& context,
+                                                              std::shared_ptr<const FileContext> *resulting_file_context)
+{
+  const SourceLines lines(text, file->getFullpath());
+  const LocalScope& scope = file->scope;
+
+  // Definitions of this version, and the names they refer to
+  std::unordered_map<std::string, std::string> definitions;
+  std::unordered_map<std::string, NameSet> references;
+  auto addDefinition = [&](const std::string& name, const ASTNode& node) {
+      const auto key = lines.key(node);
+      definitions[name] += key;
+      collectNames(key, references[name]);
+    };
+  for (const auto& function : scope.astFunctions) addDefinition(function.first, *function.second);
+  for (const auto& module : scope.astModules) addDefinition(module.first, *module.second);
+  for (const auto& assignment : scope.assignments) addDefinition(assignment->getName(), *assignment);
+
+  // Changed names, and names referring to them
+  bool reuse = !this->instantiations.empty() && inputs == this->inputs;
+  auto isImpure = [](const NameSet& names) {
+      return std::any_of(names.begin(), names.end(), [](const std::string& name) { return impure_builtins.count(name) > 0; });
+    };
+  NameSet changed;
+  for (const auto& definition : definitions) {
+    auto previous = this->definitions.find(definition.first);
+    if (previous == this->definitions.end() || previous->second != definition.second ||
+        isImpure(references[definition.first])) {
+      changed.insert(definition.first);
+    }
+  }
+  for (const auto& definition : this->definitions) {
+    if (!definitions.count(definition.first)) changed.insert(definition.first);
+  }
+  for (bool grown = true; grown && reuse;) {
+    grown = false;
+    for (const auto& reference : references) {
+      if (changed.count(reference.first)) continue;
+      for (const auto& name : reference.second) {
+        if (changed.count(name)) {
+          changed.insert(reference.first);
+          grown = true;
+          break;
+        }
+      }
+    }
+  }
+  for (const auto& name : changed) {
+    if (name[0] == '$') reuse = false;
+  }
+
+  std::unordered_multimap<std::string, size_t> previous;
+  if (reuse) {
+    for (size_t i = 0; i < this->instantiations.size(); ++i) previous.emplace(this->instantiations[i].key, i);
+  }
+
+  this->reused = 0;
+  this->instantiated = 0;
+  std::vector<Instantiation> current;
+  auto node = std::make_shared<RootNode>();
+  try {
+    ContextHandle<FileContext> file_context{Context::create<FileContext>(context, file.get())};
+    *resulting_file_context = *file_context;
+    for (const auto& modinst : scope.moduleInstantiations) {
+      Instantiation instantiation;
+      instantiation.key = lines.key(*modinst);
+      if (modinst->isRoot()) instantiation.key += '!';
+      if (modinst->isHighlight()) instantiation.key += '#';
+      if (modinst->isBackground()) instantiation.key += '%';
+
+      auto match = previous.find(instantiation.key);
+      if (match != previous.end()) {
+        NameSet names;
+        collectNames(instantiation.key, names);
+        for (const auto& name : names) {
+          if (changed.count(name) || impure_builtins.count(name)) {
+            match = previous.end();
+            break;
+          }
+        }
+      }
+      if (match != previous.end()) {
+        const auto& cached = this->instantiations[match->second];
+        instantiation.node = cached.node;
+        instantiation.source = cached.source;
+        previous.erase(match);
+        this->reused++;
+      } else {
+        instantiation.node = modinst->evaluate(*file_context);
+        instantiation.source = file;
+        this->instantiated++;
+      }
+      if (instantiation.node) node->children.push_back(instantiation.node);
+      current.push_back(std::move(instantiation));
+    }
+  } catch (HardWarningException& e) {
+    clear();
+    throw;
+  } catch (EvaluationException& e) {
+    *resulting_file_context = nullptr;
+    clear();
+    return node;
+  }
+
+  this->inputs = inputs;
+  this->definitions = std::move(definitions);
+  this->instantiations = std::move(current);
+  return node;
+}
+
+void InstantiationCache::clear()
+{
+  this->inputs.clear();
+  this->definitions.clear();
+  this->instantiations.clear();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class AbstractNode;
+class Context;
+class FileContext;
+class SourceFile;
+
+/*!
+   Instantiates successive versions of a root file, e.g. while it is edited in
+   the GUI, and reuses the node subtrees of top-level module instantiations
+   which did not change since the previous version.
+
+   Top-level assignments, functions and modules are compared by name with the
+   previous version. A name is changed if the printed AST or the source lines
+   of its definitions differ, or if one of its definitions refers to a changed
+   name. A top-level instantiation keeps its previous nodes if its printed AST,
+   modifiers and source lines are the same and it does not refer to a changed
+   name. References are the identifier tokens of the printed AST, which may
+   include more than the names actually used, so reuse errs on the safe side.
+
+   Everything is instantiated again if the inputs given by the caller (render
+   variables, timestamps of dependencies, ...) differ or if a $special
+   variable is assigned differently. Definitions calling rands(), import(),
+   surface(), dxf_dim() or dxf_cross(), whose results depend on more than their
+   arguments, are always changed, and instantiations calling them are always
+   instantiated again. Reused instantiations do not repeat their
+   echo() output and warnings.
+
+   Reused nodes refer to the AST they were instantiated from, so the cache
+   keeps those SourceFiles alive. Node indices are not reset, so new nodes get
+   indices distinct from the reused ones.
+ */
+class InstantiationCache
+{
+public:
+  /*!
+     Instantiates file like SourceFile::instantiate(). text is the source text
+     of file, which is used to detect edits that do not change the printed AST.
+   */
+  std::shared_ptr<AbstractNode> instantiate(const std::shared_ptr<const SourceFile>& file, const std::string& text,
+                                            const std::string& inputs, const std::shared_ptr<const Context>& context,
+                                            std::shared_ptr<const FileContext> *resulting_file_context);
+  void clear();
+
+  // Number of top-level instantiations reused and instantiated by the last instantiate() call
+  size_t reusedCount() const { return this->reused; }
+  size_t instantiatedCount() const { return this->instantiated; }
+
+private:
+  struct Instantiation {
+    std::string key;
+    std::shared_ptr<AbstractNode> node;
+    std::shared_ptr<const SourceFile> source;
+  };
+
+  std::string inputs;
+  std::unordered_map<std::string, std::string> definitions;
+  std::vector<Instantiation> instantiations;
+  size_t reused{0};
+  size_t instantiated{0};
+};
@@ -4,6 +4,7 @@
 #include "Expression.h"
 #include "exceptions.h"
 #include "printutils.h"
+#include "Profiler.h"
 
 void ModuleInstantiation::print(std::ostream& stream, const std::string& indent, const bool inlined) const
 {
@@ -64,6 +65,7 @@ std::shared_ptr<AbstractNode> ModuleInstantiation::evaluate(const std::shared_pt
   if (!module) {
     return nullptr;
   }
+  Profiler::Scope profile("module", this->name(), this->loc, &context->session()->accounting());
 
   try{
     auto node = module->module->instantiate(module->defining_context, this, context);
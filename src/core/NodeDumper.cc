@@ -45,6 +45,16 @@ Response GroupNodeChecker::visit(State& state, const AbstractNode&)
 }
 
 
+std::string nodeIdString(const AbstractNode& node)
+{
+  static const boost::regex re(R"([^\s\"]+|\"(?:[^\"\\]|\\.)*\")");
+  const auto name = node.toIdString();
+  std::ostringstream stream;
+  boost::sregex_token_iterator it(name.begin(), name.end(), re, 0);
+  std::copy(it, boost::sregex_token_iterator(), std::ostream_iterator<std::string>(stream));
+  return stream.str();
+}
+
 /*!
    \class NodeDumper
 
@@ -148,10 +158,7 @@ Response NodeDumper::visit(State& state, const AbstractNode& node)
 
     if (this->idString) {
 
-      static const boost::regex re(R"([^\s\"]+|\"(?:[^\"\\]|\\.)*\")");
-      const auto name = STR(node);
-      boost::sregex_token_iterator it(name.begin(), name.end(), re, 0);
-      std::copy(it, boost::sregex_token_iterator(), std::ostream_iterator<std::string>(this->dumpstream));
+      this->dumpstream << nodeIdString(node);
 
       if (node.getChildren().size() > 0) {
         this->dumpstream << "{";
@@ -29,6 +29,10 @@ private:
   std::unordered_map<int, int> groupChildCounts;
 };
 
+// Returns the representation of node itself (without children) as used in ID strings,
+// i.e. stripped of all whitespace outside of string literals.
+std::string nodeIdString(const AbstractNode& node);
+
 class NodeDumper : public NodeVisitor
 {
 public:
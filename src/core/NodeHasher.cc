@@ -0,0 +1,181 @@
+#include "NodeHasher.h"
+#include "NodeDumper.h"
+#include "ModuleInstantiation.h"
+#include "State.h"
+#include "hash.h"
+
+namespace {
+
+void appendString(std::string& signature, const std::string& str)
+{
+  const uint64_t size = str.size();
+  signature.append(reinterpret_cast<const char *>(&size), sizeof(size));
+  signature.append(str);
+}
+
+template <typename T>
+void appendValue(std::string& signature, T value)
+{
+  signature.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+} // namespace
+
+std::string NodeDigest::key() const
+{
+  return Hash128::hex(this->hash);
+}
+
+NodeHasher::Statistics& NodeHasher::statistics()
+{
+  static Statistics stats;
+  return stats;
+}
+
+std::string NodeHasher::modifiers(const State& state, const AbstractNode& node)
+{
+  // ListNodes can pass down modifiers to children via state, so check both modinst and state
+  std::string modifiers;
+  if (node.modinst->isBackground() || state.isBackground()) modifiers += "%";
+  if (node.modinst->isHighlight() || state.isHighlight()) modifiers += "#";
+  return modifiers;
+}
+
+/*!
+   Returns true if the subtree still needs to be traversed.
+ */
+bool NodeHasher::prefix(const AbstractNode& node)
+{
+  return !this->cache.contains(node);
+}
+
+void NodeHasher::postfix(State& state, const AbstractNode& node, Kind kind,
+                         const std::string& modifiers, const std::string& own)
+{
+  auto found = this->cache.digests.find(node.index());
+  if (found == this->cache.digests.end()) {
+    std::vector<NodeDigest> children;
+    auto visited = this->visitedchildren.find(node.index());
+    if (visited != this->visitedchildren.end()) {
+      children = std::move(visited->second);
+      this->visitedchildren.erase(visited);
+    }
+
+    NodeDigest digest;
+    size_t nonempty = 0;
+    const NodeDigest *single = nullptr;
+    digest.idlength = modifiers.size();
+    for (const auto& child : children) {
+      digest.idlength += child.idlength;
+      digest.collision |= child.collision;
+      if (!child.empty) {
+        nonempty++;
+        single = &child;
+      }
+    }
+
+    if (kind == Kind::Transparent && modifiers.empty() && nonempty <= 1) {
+      // Transparent nodes with a single child have the same ID string as the child
+      if (single) {
+        digest.hash = single->hash;
+        digest.empty = false;
+      }
+    } else {
+      if (kind == Kind::Node) digest.idlength += own.size() + (children.empty() ? 1 : 2);
+
+      std::string signature;
+      signature.push_back(static_cast<char>(kind));
+      appendString(signature, modifiers);
+      appendString(signature, own);
+      appendValue<uint8_t>(signature, !children.empty());
+      appendValue<uint64_t>(signature, nonempty);
+      for (const auto& child : children) {
+        if (child.empty) continue;
+        appendValue(signature, child.hash.first);
+        appendValue(signature, child.hash.second);
+      }
+      digest.hash = Hash128().update(signature).digest();
+      digest.empty = false;
+
+      auto [entry, inserted] = this->cache.signatures.emplace(digest.hash, signature);
+      if (!inserted && entry->second != signature) {
+        digest.collision = true;
+        statistics().collisions++;
+      }
+    }
+
+    found = this->cache.digests.emplace(node.index(), digest).first;
+    statistics().nodes++;
+    statistics().keybytes += 32;
+    statistics().idstringbytes += digest.idlength;
+  }
+
+  if (state.parent()) this->visitedchildren[state.parent()->index()].push_back(found->second);
+}
+
+Response NodeHasher::visit(State& state, const AbstractNode& node)
+{
+  if (state.isPrefix()) {
+    return prefix(node) ? Response::ContinueTraversal : Response::PruneTraversal;
+  }
+  if (state.isPostfix()) {
+    postfix(state, node, Kind::Node, modifiers(state, node), nodeIdString(node));
+  }
+  return Response::ContinueTraversal;
+}
+
+/*!
+   Groups with more than one non-empty child are dumped as regular nodes,
+   otherwise they are replaced by their children.
+ */
+Response NodeHasher::visit(State& state, const GroupNode& node)
+{
+  if (state.isPrefix()) {
+    return prefix(node) ? Response::ContinueTraversal : Response::PruneTraversal;
+  }
+  if (state.isPostfix()) {
+    size_t nonempty = 0;
+    auto visited = this->visitedchildren.find(node.index());
+    if (visited != this->visitedchildren.end()) {
+      for (const auto& child : visited->second) {
+        if (!child.empty) nonempty++;
+      }
+    }
+    if (nonempty > 1) {
+      postfix(state, node, Kind::Node, modifiers(state, node), nodeIdString(node));
+    } else {
+      postfix(state, node, Kind::Transparent, modifiers(state, node), "");
+    }
+  }
+  return Response::ContinueTraversal;
+}
+
+/*!
+   List nodes only list their children, and pass their modifiers down to them.
+ */
+Response NodeHasher::visit(State& state, const ListNode& node)
+{
+  if (state.isPrefix()) {
+    if (node.modinst->isHighlight()) state.setHighlight(true);
+    if (node.modinst->isBackground()) state.setBackground(true);
+    return prefix(node) ? Response::ContinueTraversal : Response::PruneTraversal;
+  }
+  if (state.isPostfix()) {
+    postfix(state, node, Kind::Transparent, "", "");
+  }
+  return Response::ContinueTraversal;
+}
+
+/*!
+   Root nodes only list their children.
+ */
+Response NodeHasher::visit(State& state, const RootNode& node)
+{
+  if (state.isPrefix()) {
+    return prefix(node) ? Response::ContinueTraversal : Response::PruneTraversal;
+  }
+  if (state.isPostfix()) {
+    postfix(state, node, Kind::Transparent, "", "");
+  }
+  return Response::ContinueTraversal;
+}
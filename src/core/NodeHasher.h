@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "NodeVisitor.h"
+#include "node.h"
+
+/*!
+   Structural digest of a subtree, computed bottom-up from the node's own ID string
+   and the digests of its children.
+ */
+struct NodeDigest {
+  std::pair<uint64_t, uint64_t> hash{0, 0};
+  // The subtree contributes nothing to its parent's ID string (e.g. an empty group)
+  bool empty{true};
+  // A hash collision was detected in this subtree, so the full ID string must be used
+  bool collision{false};
+  // Length of the equivalent ID string, for statistics
+  size_t idlength{0};
+
+  [[nodiscard]] std::string key() const;
+};
+
+struct NodeHashKeyHash {
+  size_t operator()(const std::pair<uint64_t, uint64_t>& h) const { return h.first ^ h.second; }
+};
+
+/*!
+   Caches node digests per node index, and the hash input of every digest,
+   which allows collisions to be detected within a tree.
+ */
+struct NodeHashCache {
+  std::unordered_map<size_t, NodeDigest> digests;
+  std::unordered_map<std::pair<uint64_t, uint64_t>, std::string, NodeHashKeyHash> signatures;
+
+  [[nodiscard]] bool contains(const AbstractNode& node) const { return digests.count(node.index()) > 0; }
+  void clear() { digests.clear(); signatures.clear(); }
+};
+
+/*!
+   A visitor computing Merkle-style 128-bit digests for a node tree.
+
+   The digests follow the structure of the ID strings produced by NodeDumper:
+   Equal ID strings yield equal digests in all common cases (in particular, groups
+   with a single child are transparent), while different ID strings yield different
+   digests unless the hash collides. Collisions within a tree are detected by comparing
+   the hash input, in which case the affected subtrees fall back to full ID strings.
+ */
+class NodeHasher : public NodeVisitor
+{
+public:
+  NodeHasher(NodeHashCache& cache) : cache(cache) {}
+
+  Response visit(State& state, const AbstractNode& node) override;
+  Response visit(State& state, const GroupNode& node) override;
+  Response visit(State& state, const ListNode& node) override;
+  Response visit(State& state, const RootNode& node) override;
+
+  struct Statistics {
+    std::atomic<size_t> nodes{0};
+    std::atomic<size_t> keybytes{0};
+    std::atomic<size_t> idstringbytes{0};
+    std::atomic<size_t> collisions{0};
+    std::atomic<uint64_t> microseconds{0};
+    void reset() { nodes = 0; keybytes = 0; idstringbytes = 0; collisions = 0; microseconds = 0; }
+  };
+  static Statistics& statistics();
+
+private:
+  enum class Kind : char { Node = 'N', Transparent = 'T' };
+
+  bool prefix(const AbstractNode& node);
+  void postfix(State& state, const AbstractNode& node, Kind kind, const std::string& modifiers, const std::string& own);
+  static std::string modifiers(const State& state, const AbstractNode& node);
+
+  NodeHashCache& cache;
+  // digests of visited children, keyed by parent index
+  std::unordered_map<size_t, std::vector<NodeDigest>> visitedchildren;
+};
@@ -1,10 +1,12 @@
 #include "NodeVisitor.h"
 #include "State.h"
+#include "Profiler.h"
 
 State NodeVisitor::nullstate(nullptr);
 
 Response NodeVisitor::traverse(const AbstractNode& node, const State& state)
 {
+  Profiler::Scope scope(profileCategory(), node);
   State newstate = state;
   newstate.setNumChildren(node.getChildren().size());
 
@@ -34,6 +34,9 @@ public:
 
   Response traverse(const AbstractNode& node, const State& state = NodeVisitor::nullstate);
 
+  // Category under which traversed nodes are recorded by the Profiler, or nullptr to not record them
+  virtual const char *profileCategory() const { return nullptr; }
+
   Response visit(State& state, const AbstractNode& node) override = 0;
   Response visit(State& state, const AbstractIntersectionNode& node) override {
     return visit(state, (const AbstractNode&) node);
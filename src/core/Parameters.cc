@@ -133,7 +133,7 @@ static ContextFrame parse_without_defaults(
   const std::vector<T>& required_parameters,
   const std::vector<T>& optional_parameters,
   bool warn_for_unexpected_arguments,
-  F parameter_name
+  F parameter_symbol
   ) {
   ContextFrame output{arguments.session()};
 
@@ -143,9 +143,9 @@ static ContextFrame parse_without_defaults(
   bool warned_for_extra_arguments = false;
 
   for (auto& argument : arguments) {
-    std::string name;
+    Symbol symbol;
     if (argument.name) {
-      name = *argument.name;
+      const std::string& name = *argument.name;
       if (named_arguments.count(name)) {
         LOG(message_group::Warning, loc, arguments.documentRoot(), "argument %1$s supplied more than once", name);
       } else if (output.lookup_local_variable(name)) {
@@ -153,13 +153,13 @@ static ContextFrame parse_without_defaults(
       } else if (warn_for_unexpected_arguments && !ContextFrame::is_config_variable(name)) {
         bool found = false;
         for (const auto& parameter : required_parameters) {
-          if (parameter_name(parameter) == name) {
+          if (parameter_symbol(parameter).name() == name) {
             found = true;
             break;
           }
         }
         for (const auto& parameter : optional_parameters) {
-          if (parameter_name(parameter) == name) {
+          if (parameter_symbol(parameter).name() == name) {
             found = true;
             break;
           }
@@ -169,19 +169,20 @@ static ContextFrame parse_without_defaults(
         }
       }
       named_arguments.insert(name);
+      symbol = Symbol(name);
     } else {
       while (parameter_position < required_parameters.size() + optional_parameters.size()) {
-        std::string candidate_name = (parameter_position < required_parameters.size())
-    ? parameter_name(required_parameters[parameter_position])
-    : parameter_name(optional_parameters[parameter_position - required_parameters.size()])
+        Symbol candidate = (parameter_position < required_parameters.size())
+    ? parameter_symbol(required_parameters[parameter_position])
+    : parameter_symbol(optional_parameters[parameter_position - required_parameters.size()])
         ;
         parameter_position++;
-        if (!named_arguments.count(candidate_name)) {
-          name = candidate_name;
+        if (!named_arguments.count(candidate.name())) {
+          symbol = candidate;
           break;
         }
       }
-      if (name.empty()) {
+      if (symbol.empty()) {
         if (warn_for_unexpected_arguments && !warned_for_extra_arguments) {
           LOG(message_group::Warning, loc, arguments.documentRoot(), "Too many unnamed arguments supplied");
           warned_for_extra_arguments = true;
@@ -190,7 +191,7 @@ static ContextFrame parse_without_defaults(
       }
     }
 
-    output.set_variable(name, std::move(argument.value));
+    output.set_variable(symbol, std::move(argument.value));
   }
   return output;
 }
@@ -202,8 +203,8 @@ Parameters Parameters::parse(
   const std::vector<std::string>& optional_parameters
   ) {
   ContextFrame frame{parse_without_defaults(std::move(arguments), loc, required_parameters, optional_parameters, true,
-                                            [](const std::string& s) -> std::string {
-      return s;
+                                            [](const std::string& s) -> Symbol {
+      return Symbol(s);
     }
                                             )};
 
@@ -223,17 +224,17 @@ Parameters Parameters::parse(
   const std::shared_ptr<const Context>& defining_context
   ) {
   ContextFrame frame{parse_without_defaults(std::move(arguments), loc, required_parameters, {}, OpenSCAD::parameterCheck,
-                                            [](const std::shared_ptr<Assignment>& assignment) {
-      return assignment->getName();
+                                            [](const std::shared_ptr<Assignment>& assignment) -> const Symbol& {
+      return assignment->getSymbol();
     }
                                             )};
 
   for (const auto& parameter : required_parameters) {
-    if (!frame.lookup_local_variable(parameter->getName())) {
+    if (!frame.lookup_local_variable(parameter->getSymbol())) {
       if (parameter->getExpr()) {
-        frame.set_variable(parameter->getName(), parameter->getExpr()->evaluate(defining_context));
+        frame.set_variable(parameter->getSymbol(), parameter->getExpr()->evaluate(defining_context));
       } else {
-        frame.set_variable(parameter->getName(), Value::undefined.clone());
+        frame.set_variable(parameter->getSymbol(), Value::undefined.clone());
       }
     }
   }
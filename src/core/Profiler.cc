@@ -0,0 +1,314 @@
+#include "Profiler.h"
+#include "AST.h"
+#include "ContextMemoryManager.h"
+#include "ModuleInstantiation.h"
+#include "node.h"
+#include "printutils.h"
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <unordered_map>
+#include <json.hpp>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+struct OpenScope {
+  Profiler::Event event;
+  int64_t cpu_start;
+  int64_t memory_start;
+  int64_t children_us{0};
+  const HeapSizeAccounting *accounting{nullptr};
+  size_t allocations_start{0};
+  int64_t children_allocations{0};
+  std::string key;
+  // The node this scope was opened for, if any
+  const AbstractNode *node{nullptr};
+};
+
+// Open scopes of the current thread, innermost last
+thread_local std::vector<OpenScope> openscopes;
+// Number of open scopes of the current thread per category and name, for detecting recursion
+thread_local std::unordered_map<std::string, int> activescopes;
+
+unsigned int threadId()
+{
+  static std::atomic<unsigned int> counter{0};
+  thread_local unsigned int id = ++counter;
+  return id;
+}
+
+int64_t cpuTime()
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+    return int64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+  }
+#endif
+  return int64_t(std::clock()) * 1000000 / CLOCKS_PER_SEC;
+}
+
+// Peak resident set size of the process in KB, or 0 if unavailable
+int64_t peakMemory()
+{
+#ifndef _WIN32
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+  }
+#endif
+  return 0;
+}
+
+} // namespace
+
+Profiler& Profiler::instance()
+{
+  static Profiler profiler;
+  return profiler;
+}
+
+void Profiler::enable()
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->recorded.clear();
+  this->frames.clear();
+  this->frameindex.clear();
+  this->origin = std::chrono::steady_clock::now();
+  this->enabled = true;
+}
+
+int64_t Profiler::now() const
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - this->origin).count();
+}
+
+void Profiler::annotate(const std::string& key, const std::string& value)
+{
+  if (!openscopes.empty()) openscopes.back().event.args.emplace_back(key, value);
+}
+
+void Profiler::annotate(const AbstractNode& node, const std::string& key, const std::string& value)
+{
+  if (!openscopes.empty() && openscopes.back().node == &node) openscopes.back().event.args.emplace_back(key, value);
+}
+
+void Profiler::annotateDefault(const AbstractNode& node, const std::string& key, const std::string& value)
+{
+  if (openscopes.empty() || openscopes.back().node != &node) return;
+  auto& args = openscopes.back().event.args;
+  const auto found = std::find_if(args.begin(), args.end(), [&key](const auto& arg) { return arg.first == key; });
+  if (found == args.end()) args.emplace_back(key, value);
+}
+
+void Profiler::tailCall(const std::string& name)
+{
+  if (!openscopes.empty()) openscopes.back().event.tailcalls[name]++;
+}
+
+void Profiler::record(Event&& event)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->recorded.push_back(std::move(event));
+}
+
+/*!
+   Returns the id of the stack consisting of the stack parent (or none if -1)
+   followed by label. Stacks are interned since deep recursion would otherwise
+   make them quadratic in size.
+ */
+int Profiler::internFrame(int parent, const std::string& label)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  auto [it, inserted] = this->frameindex.emplace(std::make_pair(parent, label), int(this->frames.size()));
+  if (inserted) this->frames.emplace_back(parent, label);
+  return it->second;
+}
+
+std::string Profiler::stack(int frame) const
+{
+  std::vector<const std::string *> labels;
+  for (; frame >= 0; frame = this->frames[frame].first) labels.push_back(&this->frames[frame].second);
+  std::string result;
+  for (auto it = labels.rbegin(); it != labels.rend(); ++it) {
+    if (!result.empty()) result += ";";
+    result += **it;
+  }
+  return result;
+}
+
+std::vector<Profiler::Event> Profiler::events() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->recorded;
+}
+
+Profiler::Scope::Scope(const char *category, const std::string& name, const Location& location,
+                       const HeapSizeAccounting *accounting)
+{
+  if (category && Profiler::instance().isEnabled()) begin(category, name, location, accounting);
+}
+
+Profiler::Scope::Scope(const char *category, const AbstractNode& node)
+{
+  if (category && Profiler::instance().isEnabled()) {
+    begin(category, node.modinst->name(), node.modinst->location(), nullptr);
+    openscopes.back().node = &node;
+    Profiler::annotate("node", node.name());
+  }
+}
+
+void Profiler::Scope::begin(const char *category, const std::string& name, const Location& location,
+                            const HeapSizeAccounting *accounting)
+{
+  auto& profiler = Profiler::instance();
+  OpenScope scope;
+  auto& event = scope.event;
+  event.category = category;
+  event.name = name;
+  if (!location.isNone()) {
+    event.location = location.filePath().filename().generic_string() + ":" + std::to_string(location.firstLine());
+  }
+  const auto label = event.location.empty() ? name : name + " (" + event.location + ")";
+  event.frame = profiler.internFrame(openscopes.empty() ? -1 : openscopes.back().event.frame, label);
+  event.tid = threadId();
+  scope.key = std::string(category) + ":" + name;
+  event.recursive = activescopes[scope.key]++ > 0;
+  scope.accounting = accounting;
+  if (accounting) scope.allocations_start = accounting->allocations();
+  event.start_us = profiler.now();
+  scope.cpu_start = cpuTime();
+  scope.memory_start = peakMemory();
+  openscopes.push_back(std::move(scope));
+  this->active = true;
+}
+
+Profiler::Scope::~Scope()
+{
+  if (!this->active || openscopes.empty()) return;
+
+  auto scope = std::move(openscopes.back());
+  openscopes.pop_back();
+  if (--activescopes[scope.key] == 0) activescopes.erase(scope.key);
+
+  auto& event = scope.event;
+  event.wall_us = Profiler::instance().now() - event.start_us;
+  event.self_us = std::max<int64_t>(event.wall_us - scope.children_us, 0);
+  event.cpu_us = cpuTime() - scope.cpu_start;
+  event.peak_memory_kb = peakMemory() - scope.memory_start;
+  if (scope.accounting) {
+    event.allocations = scope.accounting->allocations() - scope.allocations_start;
+    event.self_allocations = std::max<int64_t>(event.allocations - scope.children_allocations, 0);
+  }
+  if (!openscopes.empty()) {
+    openscopes.back().children_us += event.wall_us;
+    openscopes.back().children_allocations += event.allocations;
+  }
+  Profiler::instance().record(std::move(event));
+}
+
+bool Profiler::write(const std::string& filename) const
+{
+  std::ofstream stream(filename, std::ios::out | std::ios::trunc);
+  if (!stream) return false;
+  const auto ext = filename.substr(filename.find_last_of('.') + 1);
+  const bool ok = (ext == "folded" || ext == "txt") ? writeFoldedStacks(stream) : writeChromeTrace(stream);
+  return ok && bool(stream);
+}
+
+bool Profiler::writeChromeTrace(std::ostream& stream) const
+{
+  nlohmann::json traceEvents = nlohmann::json::array();
+  for (const auto& event : events()) {
+    nlohmann::json args;
+    if (!event.location.empty()) args["location"] = event.location;
+    args["cpu_us"] = event.cpu_us;
+    args["self_us"] = event.self_us;
+    args["peak_memory_delta_kb"] = event.peak_memory_kb;
+    if (event.allocations) args["allocations"] = event.allocations;
+    if (!event.tailcalls.empty()) {
+      int64_t tailcalls = 0;
+      for (const auto& entry : event.tailcalls) tailcalls += entry.second;
+      args["tail_calls"] = tailcalls;
+    }
+    for (const auto& [key, value] : event.args) args[key] = value;
+
+    nlohmann::json json;
+    json["name"] = event.name;
+    json["cat"] = event.category;
+    json["ph"] = "X";
+    json["ts"] = event.start_us;
+    json["dur"] = event.wall_us;
+    json["pid"] = 1;
+    json["tid"] = event.tid;
+    json["args"] = args;
+    traceEvents.push_back(json);
+  }
+  nlohmann::json json;
+  json["traceEvents"] = traceEvents;
+  json["displayTimeUnit"] = "ms";
+  stream << json.dump(1) << "\n";
+  return true;
+}
+
+bool Profiler::writeFoldedStacks(std::ostream& stream) const
+{
+  std::map<int, int64_t> frametimes;
+  for (const auto& event : events()) frametimes[event.frame] += event.self_us;
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  std::vector<std::pair<std::string, int64_t>> stacks;
+  for (const auto& [frame, us] : frametimes) {
+    if (us > 0) stacks.emplace_back(stack(frame), us);
+  }
+  std::sort(stacks.begin(), stacks.end());
+  for (const auto& [stack, us] : stacks) stream << stack << " " << us << "\n";
+  return true;
+}
+
+void Profiler::printSummary(size_t maxrows) const
+{
+  struct Row {
+    std::string category;
+    std::string name;
+    size_t calls{0};
+    int64_t total_us{0};
+    int64_t self_us{0};
+    int64_t allocations{0};
+  };
+  std::map<std::pair<std::string, std::string>, Row> table;
+  for (const auto& event : events()) {
+    auto& row = table[{event.category, event.name}];
+    row.category = event.category;
+    row.name = event.name;
+    row.calls++;
+    if (!event.recursive) row.total_us += event.wall_us;
+    row.self_us += event.self_us;
+    row.allocations += event.self_allocations;
+    for (const auto& [name, count] : event.tailcalls) {
+      auto& tailrow = table[{event.category, name}];
+      tailrow.category = event.category;
+      tailrow.name = name;
+      tailrow.calls += count;
+    }
+  }
+  std::vector<Row> rows;
+  for (auto& entry : table) rows.push_back(std::move(entry.second));
+  std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.self_us > b.self_us; });
+  if (rows.size() > maxrows) rows.resize(maxrows);
+
+  LOG("Profile (sorted by self time):");
+  LOG("%1$10s %2$12s %3$12s %4$12s  %5$-10s %6$s", "calls", "total ms", "self ms", "allocations", "category", "name");
+  for (const auto& row : rows) {
+    LOG("%1$10d %2$12.2f %3$12.2f %4$12d  %5$-10s %6$s", row.calls, row.total_us / 1000.0, row.self_us / 1000.0,
+        row.allocations, row.category, row.name);
+  }
+}
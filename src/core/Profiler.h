@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+class AbstractNode;
+class HeapSizeAccounting;
+class Location;
+
+/*!
+   Opt-in profiler recording the wall time, CPU time and peak memory growth of
+   nested scopes, e.g. of each node visited by GeometryEvaluator and CSGTreeEvaluator,
+   or of each function call and module instantiation during evaluation.
+
+   Scopes are tied back to the source location of their ModuleInstantiation and can
+   be annotated with additional information, such as cache hits or the geometry backend
+   used. The results can be written as Chrome trace (chrome://tracing, Perfetto) or
+   as folded stacks for flame graph tools.
+
+   Recording is thread-safe; scopes nest per thread.
+ */
+class Profiler
+{
+public:
+  static Profiler& instance();
+
+  /*! Clears previous results and starts recording. */
+  void enable();
+  void disable() { this->enabled = false; }
+  [[nodiscard]] bool isEnabled() const { return this->enabled; }
+
+  /*! Adds key=value to the innermost open scope of the calling thread. */
+  static void annotate(const std::string& key, const std::string& value);
+  /*! Adds key=value to the innermost open scope of the calling thread, if it was opened for node. */
+  static void annotate(const AbstractNode& node, const std::string& key, const std::string& value);
+  /*! Like annotate(node, key, value), but keeps a value already added for key. */
+  static void annotateDefault(const AbstractNode& node, const std::string& key, const std::string& value);
+  /*!
+     Counts a call of name which replaced the innermost open scope of the calling
+     thread by tail call optimization, instead of opening a scope of its own.
+   */
+  static void tailCall(const std::string& name);
+
+  /*!
+     Writes the recorded scopes to filename. Files ending in .folded or .txt get
+     folded stacks, all others get Chrome trace JSON. Returns false on failure.
+   */
+  bool write(const std::string& filename) const;
+  /*!
+     Logs a table of call counts, total and self time, and allocations per category
+     and name, sorted by self time.
+   */
+  void printSummary(size_t maxrows = 40) const;
+
+  struct Event {
+    std::string category;
+    std::string name;
+    std::string location;
+    // Interned stack of labels of all enclosing scopes and this one
+    int frame{-1};
+    std::vector<std::pair<std::string, std::string>> args;
+    // Calls made by tail call optimization within this scope, by name
+    std::map<std::string, int64_t> tailcalls;
+    unsigned int tid{0};
+    // An enclosing scope has the same category and name, so this is already in its total
+    bool recursive{false};
+    int64_t start_us{0};
+    int64_t wall_us{0};
+    int64_t self_us{0};
+    int64_t cpu_us{0};
+    int64_t peak_memory_kb{0};
+    // Evaluator heap objects (contexts, variables, vector elements) created, if counted
+    int64_t allocations{0};
+    int64_t self_allocations{0};
+  };
+
+  /*!
+     RAII scope, recording an Event when destroyed. Does nothing unless the profiler
+     is enabled and category is non-null.
+   */
+  class Scope
+  {
+public:
+    Scope(const char *category, const std::string& name, const Location& location,
+          const HeapSizeAccounting *accounting = nullptr);
+    Scope(const char *category, const AbstractNode& node);
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    void begin(const char *category, const std::string& name, const Location& location,
+               const HeapSizeAccounting *accounting);
+    bool active{false};
+  };
+
+  [[nodiscard]] std::vector<Event> events() const;
+
+private:
+  Profiler() = default;
+
+  void record(Event&& event);
+  int internFrame(int parent, const std::string& label);
+  [[nodiscard]] std::string stack(int frame) const;
+  [[nodiscard]] int64_t now() const;
+  bool writeChromeTrace(std::ostream& stream) const;
+  bool writeFoldedStacks(std::ostream& stream) const;
+
+  std::atomic<bool> enabled{false};
+  std::chrono::steady_clock::time_point origin;
+  mutable std::mutex mutex;
+  std::vector<Event> recorded;
+  // Interned stack frames as (parent frame, label), and their index
+  std::vector<std::pair<int, std::string>> frames;
+  std::map<std::pair<int, std::string>, int> frameindex;
+};
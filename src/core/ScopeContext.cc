@@ -54,11 +54,11 @@ void ScopeContext::evaluateAssignments(const AssignmentList& assignments)
 void ScopeContext::init()
 {
   for (const auto& assignment : scope->assignments) {
-    if (assignment->getExpr()->isLiteral() && lookup_local_variable(assignment->getName())) {
+    if (assignment->getExpr()->isLiteral() && lookup_local_variable(assignment->getSymbol())) {
       LOG(message_group::Warning, assignment->location(), this->documentRoot(), "Parameter %1$s is overwritten with a literal", assignment->getName());
     }
     try{
-      set_variable(assignment->getName(), assignment->getExpr()->evaluate(get_shared_ptr()));
+      set_variable(assignment->getSymbol(), assignment->getExpr()->evaluate(get_shared_ptr()));
     } catch (EvaluationException& e) {
       if (e.traceDepth > 0) {
         if(assignment->locationOfOverwrite().isNone()){
@@ -99,8 +99,10 @@ UserModuleContext::UserModuleContext(const std::shared_ptr<const Context>& paren
   ScopeContext(parent, &module->body),
   children(std::move(children))
 {
-  set_variable("$children", Value(double(this->children.size())));
-  set_variable("$parent_modules", Value(double(StaticModuleNameStack::size())));
+  static const Symbol childrenSymbol("$children");
+  static const Symbol parentModulesSymbol("$parent_modules");
+  set_variable(childrenSymbol, Value(double(this->children.size())));
+  set_variable(parentModulesSymbol, Value(double(StaticModuleNameStack::size())));
   apply_variables(Parameters::parse(std::move(arguments), loc, module->parameters, parent).to_context_frame());
 }
 
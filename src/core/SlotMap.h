@@ -0,0 +1,162 @@
+#pragma once
+#include "Symbol.h"
+#include "Value.h"
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*!
+   Lexical variables of a ContextFrame, stored as numbered slots.
+
+   A variable keeps its slot for the lifetime of the frame, and slots never move
+   in memory, so references to values stay valid when variables are added. Slots
+   are allocated in chunks of 4, 8, 16, ... slots when needed, so empty frames
+   allocate nothing and small frames allocate once. Most frames only hold a few parameters or let-bindings, which are found by
+   scanning for the symbol, after a quick negative check against a 64-bit mask
+   of the symbol ids present. Larger frames (e.g. file scopes) get an index.
+ */
+class SlotMap
+{
+public:
+  struct Slot {
+    Symbol symbol;
+    Value value;
+  };
+  template <typename Map, typename SlotType>
+  class basic_iterator
+  {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Slot;
+    using difference_type = std::ptrdiff_t;
+    using reference = SlotType&;
+    using pointer = SlotType *;
+
+    basic_iterator(Map *map, size_t i) : map(map), i(i) {}
+    reference operator*() const { return map->at(i); }
+    pointer operator->() const { return &map->at(i); }
+    basic_iterator& operator++() { ++i; return *this; }
+    bool operator==(const basic_iterator& other) const { return i == other.i; }
+    bool operator!=(const basic_iterator& other) const { return i != other.i; }
+
+private:
+    Map *map;
+    size_t i;
+  };
+  using iterator = basic_iterator<SlotMap, Slot>;
+  using const_iterator = basic_iterator<const SlotMap, const Slot>;
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  // Returns the slot of symbol, or npos
+  [[nodiscard]] size_t find(const Symbol& symbol) const {
+    if (!(mask & bit(symbol))) return npos;
+    if (index) {
+      auto it = index->find(symbol.id());
+      return it == index->end() ? npos : it->second;
+    }
+    size_t i = 0;
+    for (size_t k = 0; i < count; ++k) {
+      for (const auto& s : chunks[k]) {
+        if (s.symbol == symbol) return i;
+        ++i;
+      }
+    }
+    return npos;
+  }
+  // Returns the slot of the variable called name, or npos
+  [[nodiscard]] size_t find(const std::string& name) const {
+    if (index) return find(Symbol::find(name));
+    for (size_t i = 0; i < count; ++i) {
+      if (at(i).symbol.name() == name) return i;
+    }
+    return npos;
+  }
+  // Returns the value in slot if it is bound to symbol, otherwise nullptr
+  [[nodiscard]] const Value *get(size_t slot, const Symbol& symbol) const {
+    if (slot >= count) return nullptr;
+    const Slot& s = at(slot);
+    return s.symbol == symbol ? &s.value : nullptr;
+  }
+  const Value& operator[](size_t slot) const { return at(slot).value; }
+
+  // Returns true if symbol was not bound before
+  bool insert_or_assign(const Symbol& symbol, Value&& value) {
+    const size_t slot = find(symbol);
+    if (slot != npos) {
+      at(slot).value = std::move(value);
+      return false;
+    }
+    if (chunks.empty() || chunks.back().size() == chunks.back().capacity()) {
+      chunks.emplace_back().reserve(chunkSize(chunks.size()));
+    }
+    chunks.back().push_back(Slot{symbol, std::move(value)});
+    ++count;
+    mask |= bit(symbol);
+    if (index) {
+      index->emplace(symbol.id(), count - 1);
+    } else if (count > maxUnindexed) {
+      index = std::make_unique<std::unordered_map<uint32_t, size_t>>();
+      for (size_t i = 0; i < count; ++i) index->emplace(at(i).symbol.id(), i);
+    }
+    return true;
+  }
+
+  const_iterator begin() const { return {this, 0}; }
+  const_iterator end() const { return {this, count}; }
+  iterator begin() { return {this, 0}; }
+  iterator end() { return {this, count}; }
+  [[nodiscard]] size_t size() const { return count; }
+  [[nodiscard]] bool empty() const { return count == 0; }
+  void clear() {
+    chunks.clear();
+    count = 0;
+    mask = 0;
+    index.reset();
+  }
+
+private:
+  static uint64_t bit(const Symbol& symbol) { return uint64_t(1) << (symbol.id() & 63); }
+  static constexpr size_t maxUnindexed = 8;
+  static constexpr size_t firstChunkSize = 4;
+  static size_t chunkSize(size_t k) { return firstChunkSize << k; }
+
+  // Chunk k holds slots firstChunkSize * (2^k - 1) onwards. Chunks are reserved
+  // to their full size, so pushing into one never moves its slots.
+  Slot& at(size_t i) { return const_cast<Slot&>(static_cast<const SlotMap *>(this)->at(i)); }
+  const Slot& at(size_t i) const {
+    const size_t n = i + firstChunkSize;
+    size_t k = 0;
+    while ((firstChunkSize << (k + 1)) <= n) ++k;
+    return chunks[k][n - (firstChunkSize << k)];
+  }
+
+  std::vector<std::vector<Slot>> chunks;
+  size_t count{0};
+  uint64_t mask{0};
+  std::unique_ptr<std::unordered_map<uint32_t, size_t>> index;
+};
+
+/*!
+   Where a variable lookup last found its binding: the number of parent contexts
+   walked, and the slot in that context. Lookups are revalidated against the
+   symbol, so a stale or concurrently updated hint only costs a normal lookup.
+ */
+class SlotHint
+{
+public:
+  static constexpr uint32_t none = static_cast<uint32_t>(-1);
+
+  [[nodiscard]] std::pair<uint32_t, uint32_t> load() const {
+    const uint64_t packed = this->packed.load(std::memory_order_relaxed);
+    return {static_cast<uint32_t>(packed >> 32), static_cast<uint32_t>(packed)};
+  }
+  void store(size_t depth, size_t slot) {
+    this->packed.store((uint64_t(depth) << 32) | uint32_t(slot), std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<uint64_t> packed{uint64_t(none) << 32};
+};
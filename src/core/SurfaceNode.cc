@@ -36,8 +36,12 @@
 #include "handle_dep.h"
 #include "ext/lodepng/lodepng.h"
 #include "SurfaceNode.h"
+#include "Feature.h"
+#include "parallel.h"
 
 #include <cstdint>
+#include <limits>
+#include <numeric>
 #include <sstream>
 #include <fstream>
 #include <unordered_map>
@@ -87,7 +91,7 @@ void SurfaceNode::convert_image(img_data_t& data, std::vector<uint8_t>& img, uns
 {
   data.width = width;
   data.height = height;
-  data.reserve( (size_t)width * height);
+  data.resize( (size_t)width * height);
   double min_val = 200;
   for (unsigned int y = 0; y < height; ++y) {
     for (unsigned int x = 0; x < width; ++x) {
@@ -207,6 +211,30 @@ img_data_t SurfaceNode::read_dat(std::string filename) const
   return data;
 }
 
+namespace {
+
+using index_t = IndexedPolygonList::index_t;
+
+// Flat cells covered by one polygon: cell rows line..line+lines-1, columns column..column+columns-1
+struct FlatRect {
+  int line, column, lines, columns;
+};
+
+} // namespace
+
+/*
+   Writes the heightmap as an indexed mesh straight into the PolySet: every
+   grid point is one shared vertex, and each cell adds one centre vertex and
+   four triangles meeting there. Vertex and index buffers are sized up front,
+   and the cells are generated row by row in parallel when possible, so memory
+   is bounded by the size of the resulting mesh.
+
+   With the surface-decimation feature, flat cells (all four corners at the
+   same height) are covered greedily by rectangles of equal height, and each
+   rectangle becomes a single polygon. Its outline keeps every grid point, so
+   it meets its neighbours without T-junctions, while the grid points inside
+   it are dropped.
+ */
 const Geometry *SurfaceNode::createGeometry() const
 {
   auto data = read_png_or_dat(filename);
@@ -214,100 +242,187 @@ const Geometry *SurfaceNode::createGeometry() const
   auto p = new PolySet(3);
   p->setConvexity(convexity);
 
-  int lines = data.height;
-  int columns = data.width;
-  double min_val = data.min_value() - 1; // make the bottom solid, and match old code
+  const int lines = data.height;
+  const int columns = data.width;
+  if (lines < 2 || columns < 2) return p;
+
+  const double min_val = data.min_value() - 1; // make the bottom solid, and match old code
+  const double ox = center ? -(columns - 1) / 2.0 : 0;
+  const double oy = center ? -(lines - 1) / 2.0 : 0;
+
+  const auto& heights = data.storage;
+  auto height = [&](int i, int j) { return heights[static_cast<size_t>(i) * columns + j]; };
+  // cells are numbered by their corner with the highest line and column
+  auto cell = [&](int i, int j) { return static_cast<size_t>(i - 1) * (columns - 1) + (j - 1); };
+  auto flat = [&](int i, int j) {
+    const double v = height(i, j);
+    return height(i - 1, j - 1) == v && height(i - 1, j) == v && height(i, j - 1) == v;
+  };
+
+  std::vector<bool> covered;
+  std::vector<FlatRect> rects;
+  if (Feature::ExperimentalSurfaceDecimation.is_enabled()) {
+    covered.resize(static_cast<size_t>(lines - 1) * (columns - 1));
+    auto coverable = [&](int i, int j, double v) { return !covered[cell(i, j)] && flat(i, j) && height(i, j) == v; };
+    for (int i = 1; i < lines; ++i) {
+      for (int j = 1; j < columns; ++j) {
+        if (covered[cell(i, j)] || !flat(i, j)) continue;
+        const double v = height(i, j);
+        FlatRect rect{i, j, 1, 1};
+        while (j + rect.columns < columns && coverable(i, j + rect.columns, v)) rect.columns++;
+        auto rowCoverable = [&](int line) {
+          for (int k = 0; k < rect.columns; ++k) if (!coverable(line, j + k, v)) return false;
+          return true;
+        };
+        while (i + rect.lines < lines && rowCoverable(i + rect.lines)) rect.lines++;
+        for (int k = 0; k < rect.lines; ++k) {
+          for (int l = 0; l < rect.columns; ++l) covered[cell(i + k, j + l)] = true;
+        }
+        rects.push_back(rect);
+      }
+    }
+  }
+  auto isCovered = [&](int i, int j) { return !covered.empty() && covered[cell(i, j)]; };
+
+  // Grid points are numbered row by row; when decimating, only those still in use get a vertex
+  const index_t unused = std::numeric_limits<index_t>::max();
+  std::vector<index_t> corner_index;
+  size_t num_corners = static_cast<size_t>(lines) * columns;
+  if (!rects.empty()) {
+    std::vector<bool> used(num_corners);
+    auto use = [&](int i, int j) { used[static_cast<size_t>(i) * columns + j] = true; };
+    for (int i = 1; i < lines; ++i) {
+      for (int j = 1; j < columns; ++j) {
+        if (isCovered(i, j)) continue;
+        use(i - 1, j - 1); use(i - 1, j); use(i, j - 1); use(i, j);
+      }
+    }
+    for (const auto& rect : rects) {
+      for (int k = -1; k < rect.columns; ++k) {
+        use(rect.line - 1, rect.column + k);
+        use(rect.line + rect.lines - 1, rect.column + k);
+      }
+      for (int k = 0; k < rect.lines - 1; ++k) {
+        use(rect.line + k, rect.column - 1);
+        use(rect.line + k, rect.column + rect.columns - 1);
+      }
+    }
+    corner_index.resize(num_corners, unused);
+    num_corners = 0;
+    for (size_t k = 0; k < used.size(); ++k) {
+      if (used[k]) corner_index[k] = num_corners++;
+    }
+  }
+  auto corner = [&](int i, int j) -> index_t {
+    const size_t k = static_cast<size_t>(i) * columns + j;
+    return corner_index.empty() ? static_cast<index_t>(k) : corner_index[k];
+  };
+
+  // Cells triangulated around a centre vertex, counted per row to place each row in the buffers
+  std::vector<size_t> row_start(lines + 1, 0);
+  for (int i = 1; i < lines; ++i) {
+    size_t n = columns - 1;
+    if (!covered.empty()) {
+      for (int j = 1; j < columns; ++j) n -= isCovered(i, j);
+    }
+    row_start[i + 1] = row_start[i] + n;
+  }
+  const size_t num_cells = row_start[lines];
+
+  const size_t num_walls = 2 * static_cast<size_t>(lines - 1) + 2 * static_cast<size_t>(columns - 1);
+  const size_t num_bottom = num_walls; // one bottom vertex below each wall
+  size_t num_rect_indices = 0;
+  for (const auto& rect : rects) num_rect_indices += 2 * static_cast<size_t>(rect.lines + rect.columns);
 
-  // reserve the polygon vector size so we don't have to reallocate as often
-  p->polygons.reserve( (lines - 1) * (columns - 1) * 4 + (lines - 1) * 2 + (columns - 1) * 2 + 1);
+  const size_t num_vertices = num_corners + num_cells + num_bottom;
+  if (num_vertices > std::numeric_limits<index_t>::max()) {
+    LOG(message_group::Warning, "The heightmap '%1$s' is too large for surface().", filename);
+    return p;
+  }
 
-  double ox = center ? -(columns - 1) / 2.0 : 0;
-  double oy = center ? -(lines - 1) / 2.0 : 0;
+  std::vector<Vector3d> vertices(num_vertices);
+  std::vector<index_t> indices(12 * num_cells + num_rect_indices + 4 * num_walls + num_bottom);
+  std::vector<size_t> ends(4 * num_cells + rects.size() + num_walls + 1);
+
+  // the bulk of the heightmap, one row of grid points and the cells below it per task
+  std::vector<int> rows(lines);
+  std::iota(rows.begin(), rows.end(), 0);
+  std::vector<size_t> row_cells(lines);
+  parallelizable_transform(rows.begin(), rows.end(), row_cells.begin(), [&](int i) {
+    for (int j = 0; j < columns; ++j) {
+      const index_t index = corner(i, j);
+      if (index != unused) vertices[index] = Vector3d(ox + j, oy + i, height(i, j));
+    }
+    if (i == 0) return size_t{0};
 
-  // the bulk of the heightmap
-  for (int i = 1; i < lines; ++i)
+    size_t n = row_start[i];
     for (int j = 1; j < columns; ++j) {
-      double v1 = data[ (j - 1) + (i - 1) * columns ];
-      double v2 = data[ (j) + (i - 1) * columns ];
-      double v3 = data[ (j - 1) + (i) * columns ];
-      double v4 = data[ (j) + (i) * columns ];
-
-      double vx = (v1 + v2 + v3 + v4) / 4;
-
-      p->append_poly(3);
-      p->append_vertex(ox + j - 1, oy + i - 1, v1);
-      p->append_vertex(ox + j, oy + i - 1, v2);
-      p->append_vertex(ox + j - 0.5, oy + i - 0.5, vx);
-
-      p->append_poly(3);
-      p->append_vertex(ox + j, oy + i - 1, v2);
-      p->append_vertex(ox + j, oy + i, v4);
-      p->append_vertex(ox + j - 0.5, oy + i - 0.5, vx);
-
-      p->append_poly(3);
-      p->append_vertex(ox + j, oy + i, v4);
-      p->append_vertex(ox + j - 1, oy + i, v3);
-      p->append_vertex(ox + j - 0.5, oy + i - 0.5, vx);
-
-      p->append_poly(3);
-      p->append_vertex(ox + j - 1, oy + i, v3);
-      p->append_vertex(ox + j - 1, oy + i - 1, v1);
-      p->append_vertex(ox + j - 0.5, oy + i - 0.5, vx);
+      if (isCovered(i, j)) continue;
+      const double vx = (height(i - 1, j - 1) + height(i - 1, j) + height(i, j - 1) + height(i, j)) / 4;
+      const auto centre = static_cast<index_t>(num_corners + n);
+      vertices[centre] = Vector3d(ox + j - 0.5, oy + i - 0.5, vx);
+
+      const index_t v1 = corner(i - 1, j - 1), v2 = corner(i - 1, j), v3 = corner(i, j - 1), v4 = corner(i, j);
+      index_t *out = &indices[12 * n];
+      for (index_t v : {v1, v2, centre, v2, v4, centre, v4, v3, centre, v3, v1, centre}) *out++ = v;
+      for (size_t k = 0; k < 4; ++k) ends[4 * n + k] = 12 * n + 3 * (k + 1);
+      n++;
     }
+    return n - row_start[i];
+  });
+
+  size_t next_index = 12 * num_cells;
+  size_t next_polygon = 4 * num_cells;
+  auto append = [&](index_t index) { indices[next_index++] = index; };
+  auto endPolygon = [&]() { ends[next_polygon++] = next_index; };
+
+  // flat rectangles, counterclockwise along their outline
+  for (const auto& rect : rects) {
+    const int first = rect.line - 1, last = rect.line + rect.lines - 1;
+    const int left = rect.column - 1, right = rect.column + rect.columns - 1;
+    for (int j = left; j <= right; ++j) append(corner(first, j));
+    for (int i = first + 1; i <= last; ++i) append(corner(i, right));
+    for (int j = right - 1; j >= left; --j) append(corner(last, j));
+    for (int i = last - 1; i > first; --i) append(corner(i, left));
+    endPolygon();
+  }
+
+  // the bottom ring of vertices (one less than the real minimum value), going around the edges
+  const size_t bottom_start = num_corners + num_cells;
+  auto bottom = [&](int i, int j) -> index_t {
+    size_t k;
+    if (i == 0 && j < columns - 1) k = j;
+    else if (j == columns - 1 && i < lines - 1) k = (columns - 1) + i;
+    else if (i == lines - 1 && j > 0) k = (columns - 1) + (lines - 1) + (columns - 1 - j);
+    else k = 2 * (columns - 1) + (lines - 1) + (lines - 1 - i);
+    return static_cast<index_t>(bottom_start + k);
+  };
+  for (int j = 0; j < columns - 1; ++j) vertices[bottom(0, j)] = Vector3d(ox + j, oy + 0, min_val);
+  for (int i = 0; i < lines - 1; ++i) vertices[bottom(i, columns - 1)] = Vector3d(ox + columns - 1, oy + i, min_val);
+  for (int j = columns - 1; j > 0; --j) vertices[bottom(lines - 1, j)] = Vector3d(ox + j, oy + lines - 1, min_val);
+  for (int i = lines - 1; i > 0; --i) vertices[bottom(i, 0)] = Vector3d(ox + 0, oy + i, min_val);
 
   // edges along Y
   for (int i = 1; i < lines; ++i) {
-    double v1 = data[ (0) + (i - 1) * columns ];
-    double v2 = data[ (0) + (i) * columns ];
-    double v3 = data[ (columns - 1) + (i - 1) * columns ];
-    double v4 = data[ (columns - 1) + (i) * columns ];
-
-    p->append_poly(4);
-    p->append_vertex(ox + 0, oy + i - 1, min_val);
-    p->append_vertex(ox + 0, oy + i - 1, v1);
-    p->append_vertex(ox + 0, oy + i, v2);
-    p->append_vertex(ox + 0, oy + i, min_val);
-
-    p->append_poly(4);
-    p->insert_vertex(ox + columns - 1, oy + i - 1, min_val);
-    p->insert_vertex(ox + columns - 1, oy + i - 1, v3);
-    p->insert_vertex(ox + columns - 1, oy + i, v4);
-    p->insert_vertex(ox + columns - 1, oy + i, min_val);
+    for (index_t v : {bottom(i - 1, 0), corner(i - 1, 0), corner(i, 0), bottom(i, 0)}) append(v);
+    endPolygon();
+    for (index_t v : {bottom(i, columns - 1), corner(i, columns - 1), corner(i - 1, columns - 1), bottom(i - 1, columns - 1)}) append(v);
+    endPolygon();
   }
 
   // edges along X
-  for (int i = 1; i < columns; ++i) {
-    double v1 = data[ (i - 1) + (0) * columns ];
-    double v2 = data[ (i) + (0) * columns ];
-    double v3 = data[ (i - 1) + (lines - 1) * columns ];
-    double v4 = data[ (i) + (lines - 1) * columns ];
-
-    p->append_poly(4);
-    p->insert_vertex(ox + i - 1, oy + 0, min_val);
-    p->insert_vertex(ox + i - 1, oy + 0, v1);
-    p->insert_vertex(ox + i, oy + 0, v2);
-    p->insert_vertex(ox + i, oy + 0, min_val);
-
-    p->append_poly(4);
-    p->append_vertex(ox + i - 1, oy + lines - 1, min_val);
-    p->append_vertex(ox + i - 1, oy + lines - 1, v3);
-    p->append_vertex(ox + i, oy + lines - 1, v4);
-    p->append_vertex(ox + i, oy + lines - 1, min_val);
+  for (int j = 1; j < columns; ++j) {
+    for (index_t v : {bottom(0, j), corner(0, j), corner(0, j - 1), bottom(0, j - 1)}) append(v);
+    endPolygon();
+    for (index_t v : {bottom(lines - 1, j - 1), corner(lines - 1, j - 1), corner(lines - 1, j), bottom(lines - 1, j)}) append(v);
+    endPolygon();
   }
 
-  // the bottom of the shape (one less than the real minimum value), making it a solid volume
-  if (columns > 1 && lines > 1) {
-    p->append_poly(2 * (columns - 1) + 2 * (lines - 1) );
-    for (int i = 0; i < columns - 1; ++i)
-      p->insert_vertex(ox + i, oy + 0, min_val);
-    for (int i = 0; i < lines - 1; ++i)
-      p->insert_vertex(ox + columns - 1, oy + i, min_val);
-    for (int i = columns - 1; i > 0; i--)
-      p->insert_vertex(ox + i, oy + lines - 1, min_val);
-    for (int i = lines - 1; i > 0; i--)
-      p->insert_vertex(ox + 0, oy + i, min_val);
-  }
+  // the bottom of the shape, making it a solid volume
+  for (size_t k = num_bottom; k > 0; --k) append(static_cast<index_t>(bottom_start + k - 1));
+  endPolygon();
 
+  p->polygons.assign(std::move(vertices), std::move(indices), std::move(ends));
   return p;
 }
 
@@ -0,0 +1,75 @@
+#include "Symbol.h"
+#include "ContextFrame.h"
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+struct SymbolTable {
+  std::mutex mutex;
+  // Node-based, so entries and names stay in place
+  std::unordered_map<std::string, Symbol::Entry> entries;
+  // Number of entries, readable without the mutex
+  std::atomic<size_t> size{0};
+};
+
+/*
+   Results of Symbol::find() on the current thread, so looking up names (e.g. by
+   SlotMap::find() for every function call) doesn't take the mutex. Entries are
+   never freed, but a name not found before may have been interned since, so the
+   results are dropped whenever the table grows.
+ */
+struct FindCache {
+  size_t size{0};
+  std::unordered_map<std::string, const Symbol::Entry *> results;
+};
+
+SymbolTable& table()
+{
+  static SymbolTable table;
+  return table;
+}
+
+const std::string emptyName;
+
+} // namespace
+
+Symbol::Symbol(const std::string& name)
+{
+  auto& symbols = table();
+  std::lock_guard<std::mutex> lock(symbols.mutex);
+  auto [it, inserted] = symbols.entries.try_emplace(name, Entry{nullptr, 0, false});
+  if (inserted) {
+    it->second.name = &it->first;
+    it->second.id = static_cast<uint32_t>(symbols.entries.size());
+    it->second.config = !name.empty() && ContextFrame::is_config_variable(name);
+    symbols.size.store(symbols.entries.size(), std::memory_order_release);
+  }
+  this->entry = &it->second;
+}
+
+Symbol Symbol::find(const std::string& name)
+{
+  auto& symbols = table();
+  thread_local FindCache cache;
+  const size_t size = symbols.size.load(std::memory_order_acquire);
+  if (size != cache.size) {
+    cache.results.clear();
+    cache.size = size;
+  }
+  const auto cached = cache.results.find(name);
+  if (cached != cache.results.end()) return cached->second ? Symbol(cached->second) : Symbol();
+
+  std::lock_guard<std::mutex> lock(symbols.mutex);
+  auto it = symbols.entries.find(name);
+  const Entry *entry = it == symbols.entries.end() ? nullptr : &it->second;
+  if (symbols.entries.size() == cache.size) cache.results.emplace(name, entry);
+  return entry ? Symbol(entry) : Symbol();
+}
+
+const std::string& Symbol::name() const
+{
+  return this->entry ? *this->entry->name : emptyName;
+}
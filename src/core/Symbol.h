@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/*!
+   An interned identifier. All symbols with the same name share one table entry,
+   so they compare by pointer and carry a small integer id, instead of comparing
+   or hashing the name on every variable lookup.
+
+   Identifiers in the AST (variable lookups, assignments, parameters) are interned
+   when the parser creates them. Entries are never freed.
+ */
+class Symbol
+{
+public:
+  Symbol() = default;
+  explicit Symbol(const std::string& name);
+
+  /*! Returns the symbol for name if it was interned before, otherwise an empty symbol. */
+  static Symbol find(const std::string& name);
+
+  [[nodiscard]] bool empty() const { return !entry; }
+  [[nodiscard]] const std::string& name() const;
+  // Non-zero for non-empty symbols
+  [[nodiscard]] uint32_t id() const { return entry ? entry->id : 0; }
+  // $special variables are dynamically scoped, see ContextFrame::is_config_variable()
+  [[nodiscard]] bool isConfigVariable() const { return entry && entry->config; }
+
+  bool operator==(const Symbol& other) const { return entry == other.entry; }
+  bool operator!=(const Symbol& other) const { return entry != other.entry; }
+
+  struct Entry {
+    const std::string *name;
+    uint32_t id;
+    bool config;
+  };
+
+private:
+  explicit Symbol(const Entry *entry) : entry(entry) {}
+
+  const Entry *entry{nullptr};
+};
@@ -91,19 +91,19 @@ std::shared_ptr<AbstractNode> builtin_rotate(const ModuleInstantiation *inst, Ar
       ok &= false;
       [[fallthrough]];
     case 3:
-      ok &= vec_a[2].getDouble(a);
+      ok &= vec_a.at(2).getDouble(a);
       ok &= !std::isinf(a) && !std::isnan(a);
       sz = sin_degrees(a);
       cz = cos_degrees(a);
       [[fallthrough]];
     case 2:
-      ok &= vec_a[1].getDouble(a);
+      ok &= vec_a.at(1).getDouble(a);
       ok &= !std::isinf(a) && !std::isnan(a);
       sy = sin_degrees(a);
       cy = cos_degrees(a);
       [[fallthrough]];
     case 1:
-      ok &= vec_a[0].getDouble(a);
+      ok &= vec_a.at(0).getDouble(a);
       ok &= !std::isinf(a) && !std::isnan(a);
       sx = sin_degrees(a);
       cx = cos_degrees(a);
@@ -210,9 +210,10 @@ std::shared_ptr<AbstractNode> builtin_multmatrix(const ModuleInstantiation *inst
     Matrix4d rawmatrix{Matrix4d::Identity()};
     const auto& mat = parameters["m"].toVector();
     for (size_t row_i = 0; row_i < std::min(mat.size(), size_t(4)); ++row_i) {
-      const auto& row = mat[row_i].toVector();
+      const Value row_value = mat.at(row_i);
+      const auto& row = row_value.toVector();
       for (size_t col_i = 0; col_i < std::min(row.size(), size_t(4)); ++col_i) {
-        row[col_i].getDouble(rawmatrix(row_i, col_i));
+        row.at(col_i).getDouble(rawmatrix(row_i, col_i));
       }
     }
     double w = rawmatrix(3, 3);
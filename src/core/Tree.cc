@@ -1,8 +1,10 @@
 #include "Tree.h"
 #include "NodeDumper.h"
+#include "NodeHasher.h"
 
 #include <cassert>
 #include <algorithm>
+#include <chrono>
 #include <sstream>
 #include <tuple>
 
@@ -19,6 +21,7 @@ const std::string Tree::getString(const AbstractNode& node, const std::string& i
 {
   assert(this->root_node);
   bool idString = false;
+  std::lock_guard<std::shared_mutex> lock(this->nodecachemutex);
 
   // Retrieve a nodecache given a tuple of NodeDumper constructor options
   NodeCache& nodecache = this->nodecachemap[std::make_tuple(indent, idString)];
@@ -41,6 +44,17 @@ const std::string Tree::getString(const AbstractNode& node, const std::string& i
    strip to enable cache hits for equivalent nodes from different scopes.
  */
 const std::string Tree::getIdString(const AbstractNode& node) const
+{
+  {
+    std::shared_lock<std::shared_mutex> lock(this->nodecachemutex);
+    const auto nodecache = this->nodecachemap.find(std::make_tuple(std::string(), true));
+    if (nodecache != this->nodecachemap.end() && nodecache->second.contains(node)) return nodecache->second[node];
+  }
+  std::lock_guard<std::shared_mutex> lock(this->nodecachemutex);
+  return idString(node);
+}
+
+const std::string Tree::idString(const AbstractNode& node) const
 {
   assert(this->root_node);
   const std::string indent = "";
@@ -59,13 +73,48 @@ const std::string Tree::getIdString(const AbstractNode& node) const
   return nodecache[node];
 }
 
+/*!
+   Returns a compact key identifying the subtree rooted by \a node, suitable for
+   geometry caching. Subtrees with equal ID strings get equal keys.
+
+   The key is a structural 128-bit hash computed bottom-up, so unlike getIdString()
+   it does not need to materialize the ID string of every subtree. If a hash
+   collision is detected, the full ID string is used instead.
+ */
+const std::string Tree::getNodeKey(const AbstractNode& node) const
+{
+  assert(this->root_node);
+  {
+    // The first lookup hashes the whole tree, later ones only read
+    std::shared_lock<std::shared_mutex> lock(this->nodecachemutex);
+    const auto digest = this->nodehashcache.digests.find(node.index());
+    if (digest != this->nodehashcache.digests.end() && !digest->second.collision) return digest->second.key();
+  }
+  std::lock_guard<std::shared_mutex> lock(this->nodecachemutex);
+
+  if (!this->nodehashcache.contains(node)) {
+    const auto start = std::chrono::steady_clock::now();
+    NodeHasher hasher(this->nodehashcache);
+    hasher.traverse(*this->root_node);
+    // Nodes outside of the root subtree (e.g. with root modifier '!')
+    if (!this->nodehashcache.contains(node)) hasher.traverse(node);
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    NodeHasher::statistics().microseconds += us.count();
+  }
+  const auto& digest = this->nodehashcache.digests.at(node.index());
+  if (digest.collision) return idString(node);
+  return digest.key();
+}
+
 /*!
    Sets a new root. Will clear the existing cache.
  */
 void Tree::setRoot(const std::shared_ptr<const AbstractNode> &root)
 {
+  std::lock_guard<std::shared_mutex> lock(this->nodecachemutex);
   this->root_node = root;
   this->nodecachemap.clear();
+  this->nodehashcache.clear();
 }
 
 void Tree::setDocumentPath(const std::string& path){
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "NodeCache.h"
+#include "NodeHasher.h"
 #include <map>
+#include <mutex>
+#include <shared_mutex>
 #include <utility>
 
 /*!
@@ -22,11 +25,18 @@ public:
 
   const std::string getString(const AbstractNode& node, const std::string& indent) const;
   const std::string getIdString(const AbstractNode& node) const;
+  const std::string getNodeKey(const AbstractNode& node) const;
   const std::string getDocumentPath() const;
 
 private:
+  const std::string idString(const AbstractNode& node) const;
+
   std::shared_ptr<const AbstractNode> root_node;
   // keep a separate nodecache per tuple of NodeDumper constructor parameters
   mutable std::map<std::tuple<std::string, bool>, NodeCache> nodecachemap;
+  mutable NodeHashCache nodehashcache;
+  // Guards nodecachemap and nodehashcache, as the tree may be queried by concurrent GeometryEvaluators.
+  // Lookups of cached strings and keys only take a shared lock, so they do not serialize the evaluators.
+  mutable std::shared_mutex nodecachemutex;
   std::string document_path;
 };
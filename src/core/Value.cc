@@ -25,12 +25,14 @@
  */
 
 #include <cassert>
+#include <functional>
 #include <memory>
 #include <numeric>
 #include <sstream>
 #include <boost/lexical_cast.hpp>
 
 #include "Value.h"
+#include "linalg.h"
 #include "EvaluationSession.h"
 #include "printutils.h"
 #include "StackCheck.h"
@@ -533,21 +535,135 @@ VectorType::VectorType(class EvaluationSession *session, double x, double y, dou
   emplace_back(z);
 }
 
+namespace {
+
+// Width of the packed form val could be an element of, or 0
+size_t packableWidth(const Value& val)
+{
+  if (val.type() == Value::Type::NUMBER) return 1;
+  if (val.type() != Value::Type::VECTOR) return 0;
+  const size_t size = val.toVector().size();
+  return size >= 2 && size <= VectorType::PACKED_MAX_WIDTH ? size : 0;
+}
+
+// Appends the numbers of val to a packed vector of width numbers per element, if it matches
+bool appendPacked(const Value& val, size_t width, std::vector<double>& numbers)
+{
+  if (width == 1) {
+    if (val.type() != Value::Type::NUMBER) return false;
+    numbers.push_back(val.toDouble());
+    return true;
+  }
+  if (val.type() != Value::Type::VECTOR || val.toVector().size() != width) return false;
+  const auto& vec = val.toVector();
+  double row[VectorType::PACKED_MAX_WIDTH];
+  size_t i = 0;
+  for (const auto& element : vec) {
+    if (element.type() != Value::Type::NUMBER) return false;
+    row[i++] = element.toDouble();
+  }
+  numbers.insert(numbers.end(), row, row + width);
+  return true;
+}
+
+} // namespace
+
+VectorType VectorType::Packed(class EvaluationSession *session, size_t width, std::vector<double>&& numbers)
+{
+  assert(width >= 1 && width <= PACKED_MAX_WIDTH && numbers.size() % width == 0);
+  VectorType vec(session);
+  vec.ptr->packed = std::make_unique<std::vector<double>>(std::move(numbers));
+  vec.ptr->packed_width = width;
+  if (session) {
+    session->accounting().addVectorElement(vec.size());
+  }
+  return vec;
+}
+
+Value VectorType::VectorObject::packedElement(size_type idx) const
+{
+  const size_t width = packed_width;
+  const double *numbers = packed->data() + idx * width;
+  if (width == 1) return numbers[0];
+  VectorType row(evaluation_session);
+  row.reserve(width);
+  for (size_t i = 0; i < width; ++i) row.emplace_back(numbers[i]);
+  return std::move(row);
+}
+
+void VectorType::pack()
+{
+  const size_t width = packableWidth(ptr->vec.front());
+  if (!width) return;
+  auto numbers = std::make_unique<std::vector<double>>();
+  numbers->reserve(ptr->vec.capacity() * width);
+  for (const auto& val : ptr->vec) {
+    if (!appendPacked(val, width, *numbers)) return;
+  }
+  // The number of elements stays the same, so does the heap size bookkeeping of this vector
+  ptr->packed = std::move(numbers);
+  ptr->packed_width = width;
+  vec_t().swap(ptr->vec);
+}
+
+void VectorType::unpack()
+{
+  const size_t size = this->size();
+  vec_t ret;
+  ret.reserve(size);
+  for (size_t i = 0; i < size; ++i) ret.emplace_back(packedElement(i));
+  ptr->packed.reset();
+  ptr->packed_width = 0;
+  ptr->vec = std::move(ret);
+}
+
 void VectorType::emplace_back(Value&& val)
 {
   if (val.type() == Value::Type::EMBEDDED_VECTOR) {
     emplace_back(std::move(val.toEmbeddedVectorNonConst()));
   } else {
-    ptr->vec.push_back(std::move(val));
+    if (ptr->packed && !appendPacked(val, ptr->packed_width, *ptr->packed)) unpack();
+    if (!ptr->packed) ptr->vec.push_back(std::move(val));
     if (ptr->evaluation_session) {
       ptr->evaluation_session->accounting().addVectorElement(1);
     }
+    if (ptr->vec.size() == PACKED_MIN_SIZE && ptr->embed_excess == 0) pack();
   }
 }
 
 // Specialized handler for EmbeddedVectorTypes
 void VectorType::emplace_back(EmbeddedVectorType&& mbed)
 {
+  if (mbed.ptr->packed) {
+    const size_t size = mbed.size();
+    if (ptr->embed_excess == 0 &&
+        (ptr->packed ? ptr->packed_width == mbed.ptr->packed_width : ptr->vec.empty())) {
+      // Append the numbers if this vector is packed the same way or still empty,
+      // taking them over from a temporary packed vector
+      if (ptr->packed) {
+        ptr->packed->insert(ptr->packed->end(), mbed.ptr->packed->begin(), mbed.ptr->packed->end());
+      } else if (mbed.ptr.use_count() == 1) {
+        ptr->packed = std::move(mbed.ptr->packed);
+        ptr->packed_width = mbed.ptr->packed_width;
+        mbed.ptr->packed_width = 0;
+        if (mbed.ptr->evaluation_session) {
+          mbed.ptr->evaluation_session->accounting().removeVectorElement(size);
+        }
+      } else {
+        ptr->packed = std::make_unique<std::vector<double>>(*mbed.ptr->packed);
+        ptr->packed_width = mbed.ptr->packed_width;
+      }
+      if (ptr->evaluation_session) {
+        ptr->evaluation_session->accounting().addVectorElement(size);
+      }
+    } else {
+      // Embedded vectors are iterated through their vec, so copy the elements instead,
+      // leaving mbed packed for anything else sharing it
+      for (size_t i = 0; i < size; ++i) emplace_back(mbed.packedElement(i));
+    }
+    return;
+  }
+  if (ptr->packed) unpack();
   if (mbed.size() > 1) {
     // embed_excess represents how many to add to vec.size() to get the total elements after flattening,
     // the embedded vector itself already counts towards an element in the parent's size, so subtract 1 from its size.
@@ -584,7 +700,7 @@ void VectorType::flatten() const
 void VectorType::VectorObjectDeleter::operator()(VectorObject *v)
 {
   if (v->evaluation_session) {
-    v->evaluation_session->accounting().removeVectorElement(v->vec.size());
+    v->evaluation_session->accounting().removeVectorElement(v->packed ? v->size() : v->vec.size());
   }
 
   VectorObject *orig = v;
@@ -859,6 +975,63 @@ bool Value::cmp_less(const Value& v1, const Value& v2) {
   return v1.operator<(v2).toBool();
 }
 
+// Kernels for packed vectors. Element-wise operations run on Eigen arrays, which use SIMD
+// instructions where available. Sums of products keep the order of the generic code, so results
+// do not depend on whether a vector is packed.
+using PackedArray = Eigen::Map<const Eigen::ArrayXd>;
+
+// Applies op to the numbers of two packed vectors of the same width, truncating to the shorter one
+template <typename Operation>
+Value packed_elementwise(const VectorType& op1, const VectorType& op2, const Operation& op)
+{
+  const auto& numbers1 = op1.packedNumbers();
+  const auto& numbers2 = op2.packedNumbers();
+  const auto size = static_cast<Eigen::Index>(std::min(numbers1.size(), numbers2.size()));
+  std::vector<double> result(size);
+  Eigen::Map<Eigen::ArrayXd>(result.data(), size) = op(PackedArray(numbers1.data(), size), PackedArray(numbers2.data(), size));
+  return VectorType::Packed(op1.evaluation_session(), op1.packedWidth(), std::move(result));
+}
+
+// Applies op to the numbers of a packed vector
+template <typename Operation>
+Value packed_map(const VectorType& vec, const Operation& op)
+{
+  const auto& numbers = vec.packedNumbers();
+  const auto size = static_cast<Eigen::Index>(numbers.size());
+  std::vector<double> result(size);
+  Eigen::Map<Eigen::ArrayXd>(result.data(), size) = op(PackedArray(numbers.data(), size));
+  return VectorType::Packed(vec.evaluation_session(), vec.packedWidth(), std::move(result));
+}
+
+using PackedMatrix = double[VectorType::PACKED_MAX_WIDTH][VectorType::PACKED_MAX_WIDTH];
+
+// Multiplies each row of Rows numbers with a Rows x Columns matrix
+template <size_t Rows, size_t Columns>
+void packed_transform(const std::vector<double>& numbers, const PackedMatrix& matrix, std::vector<double>& product)
+{
+  product.resize(numbers.size() / Rows * Columns);
+  const double *row = numbers.data();
+  double *out = product.data();
+  for (const double *end = row + numbers.size(); row != end; row += Rows, out += Columns) {
+    for (size_t i = 0; i < Columns; ++i) {
+      double r_e = 0.0;
+      for (size_t j = 0; j < Rows; ++j) r_e += row[j] * matrix[j][i];
+      out[i] = r_e;
+    }
+  }
+}
+
+template <size_t Rows>
+void packed_transform(const std::vector<double>& numbers, const PackedMatrix& matrix, size_t columns, std::vector<double>& product)
+{
+  switch (columns) {
+  case 1: packed_transform<Rows, 1>(numbers, matrix, product); break;
+  case 2: packed_transform<Rows, 2>(numbers, matrix, product); break;
+  case 3: packed_transform<Rows, 3>(numbers, matrix, product); break;
+  case 4: packed_transform<Rows, 4>(numbers, matrix, product); break;
+  }
+}
+
 class plus_visitor
 {
 public:
@@ -871,6 +1044,7 @@ public:
   }
 
   Value operator()(const VectorType& op1, const VectorType& op2) const {
+    if (op1.packedWidth() && op1.packedWidth() == op2.packedWidth()) return packed_elementwise(op1, op2, std::plus<>());
     VectorType sum(op1.evaluation_session());
     sum.reserve(op1.size());
     // FIXME: should we really truncate to shortest vector here?
@@ -902,10 +1076,11 @@ public:
   }
 
   Value operator()(const VectorType& op1, const VectorType& op2) const {
+    if (op1.packedWidth() && op1.packedWidth() == op2.packedWidth()) return packed_elementwise(op1, op2, std::minus<>());
     VectorType sum(op1.evaluation_session());
     sum.reserve(op1.size());
     for (size_t i = 0; i < op1.size() && i < op2.size(); ++i) {
-      sum.emplace_back(op1[i] - op2[i]);
+      sum.emplace_back(op1.at(i) - op2.at(i));
     }
     return std::move(sum);
   }
@@ -919,6 +1094,10 @@ Value Value::operator-(const Value& v) const
 Value multvecnum(const VectorType& vecval, const Value& numval)
 {
   // Vector * Number
+  if (vecval.packedWidth()) {
+    const double num = numval.toDouble();
+    return packed_map(vecval, [num](const auto& x) { return x * num; });
+  }
   VectorType dstv(vecval.evaluation_session());
   dstv.reserve(vecval.size());
   for (const auto& val : vecval) {
@@ -933,19 +1112,23 @@ Value multmatvec(const VectorType& matrixvec, const VectorType& vectorvec)
   VectorType dstv(matrixvec.evaluation_session());
   dstv.reserve(matrixvec.size());
   for (size_t i = 0; i < matrixvec.size(); ++i) {
-    if (matrixvec[i].type() != Value::Type::VECTOR ||
-        matrixvec[i].toVector().size() != vectorvec.size()) {
+    const Value row = matrixvec.at(i);
+    if (row.type() != Value::Type::VECTOR ||
+        row.toVector().size() != vectorvec.size()) {
       return Value::undef(STR("Matrix must be rectangular. Problem at row ", i));
     }
+    const auto& rowvec = row.toVector();
     double r_e = 0.0;
-    for (size_t j = 0; j < matrixvec[i].toVector().size(); ++j) {
-      if (matrixvec[i].toVector()[j].type() != Value::Type::NUMBER) {
+    for (size_t j = 0; j < rowvec.size(); ++j) {
+      const Value element = rowvec.at(j);
+      if (element.type() != Value::Type::NUMBER) {
         return Value::undef(STR("Matrix must contain only numbers. Problem at row ", i, ", col ", j));
       }
-      if (vectorvec[j].type() != Value::Type::NUMBER) {
+      const Value factor = vectorvec.at(j);
+      if (factor.type() != Value::Type::NUMBER) {
         return Value::undef(STR("Vector must contain only numbers. Problem at index ", j));
       }
-      r_e += matrixvec[i].toVector()[j].toDouble() * vectorvec[j].toDouble();
+      r_e += element.toDouble() * factor.toDouble();
     }
     dstv.emplace_back(Value(r_e));
   }
@@ -956,40 +1139,82 @@ Value multvecmat(const VectorType& vectorvec, const VectorType& matrixvec)
 {
   assert(vectorvec.size() == matrixvec.size());
   // Vector * Matrix
-  VectorType dstv(matrixvec[0].toVector().evaluation_session());
-  size_t firstRowSize = matrixvec[0].toVector().size();
+  const Value firstRow = matrixvec.at(0);
+  VectorType dstv(firstRow.toVector().evaluation_session());
+  size_t firstRowSize = firstRow.toVector().size();
   dstv.reserve(firstRowSize);
   for (size_t i = 0; i < firstRowSize; ++i) {
     double r_e = 0.0;
     for (size_t j = 0; j < vectorvec.size(); ++j) {
-      if (matrixvec[j].type() != Value::Type::VECTOR ||
-          matrixvec[j].toVector().size() != firstRowSize) {
+      const Value row = matrixvec.at(j);
+      if (row.type() != Value::Type::VECTOR ||
+          row.toVector().size() != firstRowSize) {
         LOG(message_group::Warning, "Matrix must be rectangular. Problem at row %1$lu", j);
         return Value::undef(STR("Matrix must be rectangular. Problem at row ", j));
       }
-      if (vectorvec[j].type() != Value::Type::NUMBER) {
+      const Value factor = vectorvec.at(j);
+      if (factor.type() != Value::Type::NUMBER) {
         LOG(message_group::Warning, "Vector must contain only numbers. Problem at index %1$lu", j);
         return Value::undef(STR("Vector must contain only numbers. Problem at index ", j));
       }
-      if (matrixvec[j].toVector()[i].type() != Value::Type::NUMBER) {
+      const Value element = row.toVector().at(i);
+      if (element.type() != Value::Type::NUMBER) {
         LOG(message_group::Warning, "Matrix must contain only numbers. Problem at row %1$lu, col %2$lu", j, i);
         return Value::undef(STR("Matrix must contain only numbers. Problem at row ", j, ", col ", i));
       }
-      r_e += vectorvec[j].toDouble() * matrixvec[j].toVector()[i].toDouble();
+      r_e += factor.toDouble() * element.toDouble();
     }
     dstv.emplace_back(r_e);
   }
   return {std::move(dstv)};
 }
 
+// Packed list of vectors * Matrix or Vector, if the matrix or vector has numbers only.
+// A matrix gives a packed list of vectors, a vector a packed list of numbers.
+static bool multpackedmat(const VectorType& vectors, const VectorType& matrixvec, Value& result)
+{
+  const size_t rows = vectors.packedWidth();
+  PackedMatrix matrix;
+  size_t columns = 0;
+  if (matrixvec.packedWidth() || matrixvec.size() != rows) return false;
+  const Value& firstRow = matrixvec[0];
+  if (firstRow.type() == Value::Type::NUMBER) {
+    for (size_t j = 0; j < rows; ++j) {
+      if (!matrixvec[j].getDouble(matrix[j][0])) return false;
+    }
+  } else if (firstRow.type() == Value::Type::VECTOR) {
+    columns = firstRow.toVector().size();
+    if (columns < 2 || columns > VectorType::PACKED_MAX_WIDTH) return false;
+    for (size_t j = 0; j < rows; ++j) {
+      const Value& row = matrixvec[j];
+      if (row.type() != Value::Type::VECTOR || row.toVector().size() != columns) return false;
+      for (size_t i = 0; i < columns; ++i) {
+        if (!row.toVector()[i].getDouble(matrix[j][i])) return false;
+      }
+    }
+  } else {
+    return false;
+  }
+
+  std::vector<double> product;
+  switch (rows) {
+  case 2: packed_transform<2>(vectors.packedNumbers(), matrix, std::max<size_t>(columns, 1), product); break;
+  case 3: packed_transform<3>(vectors.packedNumbers(), matrix, std::max<size_t>(columns, 1), product); break;
+  case 4: packed_transform<4>(vectors.packedNumbers(), matrix, std::max<size_t>(columns, 1), product); break;
+  }
+  result = VectorType::Packed(vectors.evaluation_session(), std::max<size_t>(columns, 1), std::move(product));
+  return true;
+}
+
 Value multvecvec(const VectorType& vec1, const VectorType& vec2) {
   // Vector dot product.
   auto r = 0.0;
   for (size_t i = 0; i < vec1.size(); i++) {
-    if (vec1[i].type() != Value::Type::NUMBER || vec2[i].type() != Value::Type::NUMBER) {
-      return Value::undef(STR("undefined operation (", vec1[i].typeName(), " * ", vec2[i].typeName(), ")"));
+    const Value element1 = vec1.at(i), element2 = vec2.at(i);
+    if (element1.type() != Value::Type::NUMBER || element2.type() != Value::Type::NUMBER) {
+      return Value::undef(STR("undefined operation (", element1.typeName(), " * ", element2.typeName(), ")"));
     }
-    r += vec1[i].toDouble() * vec2[i].toDouble();
+    r += element1.toDouble() * element2.toDouble();
   }
   return {r};
 }
@@ -1006,6 +1231,15 @@ public:
 
   Value operator()(const VectorType& op1, const VectorType& op2) const {
     if (op1.empty() || op2.empty()) return Value::undef("Multiplication is undefined on empty vectors");
+    if (op1.packedWidth() == 1 && op2.packedWidth() == 1) {
+      if (op1.size() != op2.size()) return Value::undef(STR("vector*vector requires matching lengths (", op1.size(), " != ", op2.size(), ')'));
+      const auto& numbers1 = op1.packedNumbers();
+      return std::inner_product(numbers1.begin(), numbers1.end(), op2.packedNumbers().begin(), 0.0);
+    }
+    if (op1.packedWidth() > 1) {
+      Value product = Value::undefined.clone();
+      if (multpackedmat(op1, op2, product)) return product;
+    }
     auto first1 = op1.begin(), first2 = op2.begin();
     auto eltype1 = (*first1).type(), eltype2 = (*first2).type();
     if (eltype1 == Value::Type::NUMBER) {
@@ -1058,6 +1292,10 @@ Value Value::operator/(const Value& v) const
   if (this->type() == Type::NUMBER && v.type() == Type::NUMBER) {
     return this->toDouble() / v.toDouble();
   } else if (this->type() == Type::VECTOR && v.type() == Type::NUMBER) {
+    if (this->toVector().packedWidth()) {
+      const double num = v.toDouble();
+      return packed_map(this->toVector(), [num](const auto& x) { return x / num; });
+    }
     VectorType dstv(this->toVector().evaluation_session());
     dstv.reserve(this->toVector().size());
     for (const auto& vecval : this->toVector()) {
@@ -1088,6 +1326,7 @@ Value Value::operator-() const
   if (this->type() == Type::NUMBER) {
     return {-this->toDouble()};
   } else if (this->type() == Type::VECTOR) {
+    if (this->toVector().packedWidth()) return packed_map(this->toVector(), std::negate<>());
     VectorType dstv(this->toVector().evaluation_session());
     dstv.reserve(this->toVector().size());
     for (const auto& vecval : this->toVector()) {
@@ -1125,7 +1364,7 @@ public:
 
   Value operator()(const VectorType& vec, const double& idx) const {
     const auto i = convert_to_uint32(idx);
-    if (i < vec.size()) return vec[i].clone();
+    if (i < vec.size()) return vec.at(i);
     return Value::undef(STR("index ", i, " out of bounds for vector of size ", vec.size()));
   }
 
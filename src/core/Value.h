@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <cassert>
 #include <cstdint>
 #include <limits>
 #include <ostream>
@@ -99,8 +100,8 @@ public:
    * by treating their elements as elements of their parent, traversable via VectorType's custom iterator.
    * -- An embedded vector should never exist "in the wild", only as a pseudo-element of a parent vector.
    *    Eg "Lc*" Expressions return Embedded Vectors but they are necessarily child expressions of a Vector expression.
-   * -- Any VectorType containing embedded elements will be forced to "flatten" upon usage of operator[],
-   *    which is the only case of random-access.
+   * -- Any VectorType containing embedded elements will be forced to "flatten" upon usage of operator[] or at(),
+   *    which are the only cases of random-access.
    * -- Any loops through VectorTypes should prefer automatic range-based for loops eg: for(const auto& value : vec) { ... }
    *    which make use of begin() and end() iterators of VectorType.  https://en.cppreference.com/w/cpp/language/range-for
    * -- Moving a temporary Value of type VectorType or EmbeddedVectorType is always safe,
@@ -112,6 +113,14 @@ public:
    *    AND recursively any EmbeddedVectorTypes which led to that element.
    *    Therefore elements are currently cloned rather than making any attempt to move.
    *    Performing such use_count checks may be an area for further optimization.
+   *
+   * Long homogeneous vectors are stored packed: once a vector of numbers, or of vectors of 2 to 4 numbers,
+   * reaches PACKED_MIN_SIZE elements, its numbers move into one contiguous array of doubles.
+   * -- Appending a matching element keeps the vector packed, any other element unpacks it (see unpack()).
+   * -- Packed vectors are never unpacked by reading them, as they may be shared. The iterator and at()
+   *    build the elements on demand, so a reference from the iterator is only valid until it is incremented.
+   *    operator[] returns a reference into vec and must not be used on packed vectors.
+   *    Code which only needs the numbers should check packedWidth() and read packedNumbers() instead.
    */
   class EmbeddedVectorType;
   class VectorType
@@ -125,8 +134,11 @@ protected:
       vec_t vec;
       size_type embed_excess = 0; // Keep count of the number of embedded elements *excess of* vec.size()
       class EvaluationSession *evaluation_session = nullptr; // Used for heap size bookkeeping. May be null for vectors of known small maximum size.
-      [[nodiscard]] size_type size() const { return vec.size() + embed_excess;  }
-      [[nodiscard]] bool empty() const { return vec.empty() && embed_excess == 0;  }
+      std::unique_ptr<std::vector<double>> packed; // Numbers of a packed vector, row by row. vec is empty while packed.
+      uint8_t packed_width = 0; // 1 for a vector of numbers, 2 to 4 for a vector of vectors, 0 unless packed
+      [[nodiscard]] Value packedElement(size_type idx) const; // builds element idx of a packed vector
+      [[nodiscard]] size_type size() const { return packed ? packed->size() / packed_width : vec.size() + embed_excess;  }
+      [[nodiscard]] bool empty() const { return packed ? packed->empty() : vec.empty() && embed_excess == 0;  }
     };
     using vec_t = VectorObject::vec_t;
 public:
@@ -143,13 +155,18 @@ protected:
     void flatten() const; // flatten replaces VectorObject::vec with a new vector
                           // where any embedded elements are copied directly into the top level vec,
                           // leaving only true elements for straightforward indexing by operator[].
+    void pack(); // moves the numbers of a homogeneous vec into VectorObject::packed, if possible
+    void unpack(); // replaces VectorObject::packed with the equivalent elements in vec
     explicit VectorType(const shared_ptr<VectorObject>& copy) : ptr(copy) { } // called by clone()
 public:
     using size_type = VectorObject::size_type;
+    static constexpr size_type PACKED_MIN_SIZE = 64;
+    static constexpr size_t PACKED_MAX_WIDTH = 4;
     static const VectorType EMPTY;
     // EmbeddedVectorType-aware iterator, manages its own stack of begin/end vec_t::const_iterators
     // such that calling code will only receive references to "true" elements (i.e. NOT EmbeddedVectorTypes).
     // Also tracks the overall element index. In case flattening occurs during iteration, it can continue based on that index. (Issue #3541)
+    // Elements of packed vectors are built one at a time into element, which copies of the iterator share.
     class iterator
     {
 private:
@@ -157,6 +174,14 @@ private:
       std::vector<std::pair<vec_t::const_iterator, vec_t::const_iterator>> it_stack;
       vec_t::const_iterator it, end;
       size_t index;
+      std::shared_ptr<Value> element;
+
+      void build_element()
+      {
+        if (index >= vo->size()) element.reset();
+        else if (element.use_count() == 1) *element = vo->packedElement(index);
+        else element = std::make_shared<Value>(vo->packedElement(index));
+      }
 
       // Recursively push stack while current (pseudo)element is an EmbeddedVector
       //  - Depends on the fact that VectorType::emplace_back(EmbeddedVectorType&& mbed)
@@ -182,12 +207,15 @@ public:
 
       iterator() : vo(EMPTY.ptr.get()), it_stack(), it(EMPTY.ptr->vec.begin()), end(EMPTY.ptr->vec.end()), index(0) {}
       iterator(const VectorObject *v) : vo(v), it(v->vec.begin()), end(v->vec.end()), index(0) {
-        if (vo->embed_excess) check_and_push();
+        if (vo->packed) build_element();
+        else if (vo->embed_excess) check_and_push();
       }
       iterator(const VectorObject *v, bool /*end*/) : vo(v), index(v->size()) { }
       iterator& operator++() {
         ++index;
-        if (vo->embed_excess) {
+        if (vo->packed) {
+          build_element();
+        } else if (vo->embed_excess) {
           // recursively increment and pop stack while at the end of EmbeddedVector(s)
           while (++it == end && !it_stack.empty()) {
             const auto& up = it_stack.back();
@@ -201,8 +229,8 @@ public:
         }
         return *this;
       }
-      reference operator*() const { return *it; }
-      pointer operator->() const { return &*it; }
+      reference operator*() const { return vo->packed ? *element : *it; }
+      pointer operator->() const { return &**this; }
       bool operator==(const iterator& other) const { return this->vo == other.vo && this->index == other.index; }
       bool operator!=(const iterator& other) const { return this->vo != other.vo || this->index != other.index; }
     };
@@ -217,16 +245,22 @@ public:
     [[nodiscard]] VectorType clone() const { return VectorType(this->ptr); } // Copy explicitly only when necessary
     static Value Empty() { return VectorType(nullptr); }
 
+    // Creates a packed vector of numbers (width 1), or of vectors of width numbers (width 2 to 4)
+    static VectorType Packed(class EvaluationSession *session, size_t width, std::vector<double>&& numbers);
+
     void reserve(size_t size) {
-      ptr->vec.reserve(size);
+      if (ptr->packed) ptr->packed->reserve(size * ptr->packed_width);
+      else ptr->vec.reserve(size);
     }
 
     [[nodiscard]] const_iterator begin() const { return iterator(ptr.get()); }
     [[nodiscard]] const_iterator   end() const { return iterator(ptr.get(), true); }
     [[nodiscard]] size_type size() const { return ptr->size(); }
     [[nodiscard]] bool empty() const { return ptr->empty(); }
-    // const accesses to VectorObject require .clone to be move-able
+    // Element idx of a vector which is not packed, e.g. one shorter than PACKED_MIN_SIZE.
+    // Use at() if the vector may be packed.
     const Value& operator[](size_t idx) const {
+      assert(!ptr->packed && "operator[] on a packed vector, use at()");
       if (idx < this->size()) {
         if (ptr->embed_excess) flatten();
         return ptr->vec[idx];
@@ -234,6 +268,12 @@ public:
         return Value::undefined;
       }
     }
+    // Returns a copy of element idx, built on demand if the vector is packed
+    [[nodiscard]] Value at(size_t idx) const {
+      if (idx >= this->size()) return Value::undefined.clone();
+      if (ptr->packed) return ptr->packedElement(idx);
+      return (*this)[idx].clone();
+    }
     Value operator==(const VectorType& v) const;
     Value operator<(const VectorType& v) const;
     Value operator>(const VectorType& v) const;
@@ -242,6 +282,11 @@ public:
     Value operator>=(const VectorType& v) const;
     [[nodiscard]] class EvaluationSession *evaluation_session() const { return ptr->evaluation_session; }
 
+    // Access to packed vectors without unpacking them
+    [[nodiscard]] size_t packedWidth() const { return ptr->packed ? ptr->packed_width : 0; }
+    [[nodiscard]] const std::vector<double>& packedNumbers() const { return *ptr->packed; }
+    [[nodiscard]] Value packedElement(size_t idx) const { return ptr->packedElement(idx); }
+
     void emplace_back(Value&& val);
     void emplace_back(EmbeddedVectorType&& mbed);
     template <typename ... Args> void emplace_back(Args&&... args) { emplace_back(Value(std::forward<Args>(args)...)); }
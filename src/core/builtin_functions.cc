@@ -189,8 +189,9 @@ static std::vector<double> min_max_arguments(const Arguments& arguments, const L
       print_argCnt_warning(function_name, elements.size(), "at least 1 vector element", loc, arguments.documentRoot());
       return {};
     }
-    for (size_t i = 0; i < elements.size(); i++) {
-      const auto& element = elements[i];
+    if (elements.packedWidth() == 1) return elements.packedNumbers();
+    size_t i = 0;
+    for (const auto& element : elements) {
       // 4/20/14 semantic change per discussion:
       // break on any non-number
       if (element.type() != Value::Type::NUMBER) {
@@ -198,6 +199,7 @@ static std::vector<double> min_max_arguments(const Arguments& arguments, const L
         return {};
       }
       output.push_back(element.toDouble());
+      ++i;
     }
   } else {
     for (size_t i = 0; i < arguments.size(); i++) {
@@ -570,12 +572,13 @@ static VectorType search(
     VectorType resultvec(session);
     const auto ft = find[i];
     for (size_t j = 0; j < searchTableSize; ++j) {
-      const auto& entryVec = table[j].toVector();
+      const Value entry = table.at(j);
+      const auto& entryVec = entry.toVector();
       if (entryVec.size() <= index_col_num) {
-        LOG(message_group::Warning, loc, session->documentRoot(), "Invalid entry in search vector at index %1$d, required number of values in the entry: %2$d. Invalid entry: %3$s", j, (index_col_num + 1), table[j].toEchoStringNoThrow());
+        LOG(message_group::Warning, loc, session->documentRoot(), "Invalid entry in search vector at index %1$d, required number of values in the entry: %2$d. Invalid entry: %3$s", j, (index_col_num + 1), entry.toEchoStringNoThrow());
         return {session};
       }
-      if (!ft.empty() && ft.get_utf8_char() == entryVec[index_col_num].toStrUtf8Wrapper().get_utf8_char()) {
+      if (!ft.empty() && ft.get_utf8_char() == entryVec.at(index_col_num).toStrUtf8Wrapper().get_utf8_char()) {
         matchCount++;
         if (num_returns_per_match == 1) {
           returnvec.emplace_back(double(j));
@@ -615,7 +618,7 @@ Value builtin_search(Arguments arguments, const Location& loc)
     for (const auto& search_element : searchTable.toVector()) {
       if ((index_col_num == 0 && (findThis == search_element).toBool()) ||
           (index_col_num < search_element.toVector().size() &&
-           (findThis == search_element.toVector()[index_col_num]).toBool())) {
+           (findThis == search_element.toVector().at(index_col_num)).toBool())) {
         returnvec.emplace_back(double(j));
         matchCount++;
         if (num_returns_per_match != 0 && matchCount >= num_returns_per_match) break;
@@ -638,7 +641,7 @@ Value builtin_search(Arguments arguments, const Location& loc)
       for (const auto& search_element : searchTable.toVector()) {
         if ((index_col_num == 0 && (find_value == search_element).toBool()) ||
             (index_col_num < search_element.toVector().size() &&
-             (find_value == search_element.toVector()[index_col_num]).toBool())) {
+             (find_value == search_element.toVector().at(index_col_num)).toBool())) {
           matchCount++;
           if (num_returns_per_match == 1) {
             returnvec.emplace_back(double(j));
@@ -716,7 +719,12 @@ Value builtin_norm(Arguments arguments, const Location& loc)
     return Value::undefined.clone();
   }
   double sum = 0;
-  for (const auto& v : arguments[0]->toVector()) {
+  const auto& vec = arguments[0]->toVector();
+  if (vec.packedWidth() == 1) {
+    for (double x : vec.packedNumbers()) sum += x * x;
+    return {sqrt(sum)};
+  }
+  for (const auto& v : vec) {
     if (v.type() == Value::Type::NUMBER) {
       double x = v.toDouble();
       sum += x * x;
@@ -36,6 +36,7 @@ BuiltinFunction::BuiltinFunction(Value(*f)(const std::shared_ptr<const Context>&
 {}
 
 BuiltinFunction::BuiltinFunction(Value(*f)(Arguments, const Location&), const Feature *feature) :
+  evaluate_arguments(f),
   feature(feature)
 {
   evaluate = [f] (const std::shared_ptr<const Context>& context, const FunctionCall *call) {
@@ -6,17 +6,21 @@
 #include "Value.h"
 
 #include <functional>
+#include <mutex>
 #include <string>
 #include <variant>
 #include <vector>
 
 class Arguments;
 class FunctionCall;
+struct FunctionProgram;
 
 class BuiltinFunction
 {
 public:
   std::function<Value(const std::shared_ptr<const Context>&, const FunctionCall *)> evaluate;
+  // Set for builtins that only need their evaluated arguments, so they can be called without a FunctionCall
+  Value (*evaluate_arguments)(Arguments, const Location&) = nullptr;
 
 private:
   const Feature *feature;
@@ -39,6 +43,10 @@ public:
   UserFunction(const char *name, AssignmentList& parameters, shared_ptr<Expression> expr, const Location& loc);
 
   void print(std::ostream& stream, const std::string& indent) const override;
+
+  // Bytecode for expr, see FunctionVM
+  mutable std::once_flag compile_once;
+  mutable std::shared_ptr<const FunctionProgram> program;
 };
 
 
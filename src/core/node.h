@@ -34,6 +34,10 @@ public:
   VISITABLE();
   AbstractNode(const ModuleInstantiation *mi);
   virtual std::string toString() const;
+  /*! The text identifying this node in ID strings and geometry cache keys, defaults
+      to toString(). Nodes with large content may return a compact digest instead,
+      which must differ whenever toString() does. */
+  virtual std::string toIdString() const { return this->toString(); }
   /*! The 'OpenSCAD name' of this node, defaults to classname, but can be
       overloaded to provide specialization for e.g. CSG nodes, primitive nodes etc.
       Used for human-readable output. */
@@ -34,6 +34,7 @@
 #include "printutils.h"
 #include "calc.h"
 #include "degree_trig.h"
+#include "hash.h"
 #include <sstream>
 #include <cassert>
 #include <cmath>
@@ -44,6 +45,46 @@ using namespace boost::assign; // bring 'operator+=()' into scope
 
 #define F_MINIMUM 0.01
 
+// Leaves with more coordinates and indices than this are identified by a digest of their content
+#define ID_DIGEST_MIN_VALUES 1024
+
+/*!
+   Returns "name(digest = "...", <count name> = n, <index name> = m, convexity = c)",
+   where the digest covers the exact coordinates and indices. Used as ID string of
+   large leaves, which would otherwise print all their content. ID strings key the
+   disk cache, so the digest is a cryptographic one.
+ */
+template <typename Point>
+static std::string content_digest(const std::string& name, const std::vector<Point>& points,
+                                  const std::vector<std::vector<size_t>>& indices, const std::string& indices_name, int convexity)
+{
+  Sha256 hash;
+  hash.update(name);
+  const uint64_t num_points = points.size();
+  hash.update(&num_points, sizeof(num_points));
+  hash.update(points.data(), points.size() * sizeof(Point));
+  for (const auto& list : indices) {
+    const uint64_t size = list.size();
+    hash.update(&size, sizeof(size));
+    for (const auto& index : list) {
+      const uint64_t value = index;
+      hash.update(&value, sizeof(value));
+    }
+  }
+  std::ostringstream stream;
+  stream << name << "(digest = \"" << hash.hexdigest() << "\", points = " << points.size()
+         << ", " << indices_name << " = " << indices.size() << ", convexity = " << convexity << ")";
+  return stream.str();
+}
+
+template <typename Point>
+static bool use_content_digest(const std::vector<Point>& points, const std::vector<std::vector<size_t>>& indices)
+{
+  size_t values = points.size() * sizeof(Point) / sizeof(double);
+  for (const auto& list : indices) values += list.size();
+  return values > ID_DIGEST_MIN_VALUES;
+}
+
 static void generate_circle(point2d *circle, double r, int fragments)
 {
   for (int i = 0; i < fragments; ++i) {
@@ -473,6 +514,12 @@ std::string PolyhedronNode::toString() const
   return stream.str();
 }
 
+std::string PolyhedronNode::toIdString() const
+{
+  if (!use_content_digest(this->points, this->faces)) return toString();
+  return content_digest("polyhedron", this->points, this->faces, "faces", this->convexity);
+}
+
 const Geometry *PolyhedronNode::createGeometry() const
 {
   auto p = new PolySet(3);
@@ -504,16 +551,32 @@ static std::shared_ptr<AbstractNode> builtin_polyhedron(const ModuleInstantiatio
     LOG(message_group::Error, inst->location(), parameters.documentRoot(), "Unable to convert points = %1$s to a vector of coordinates", parameters["points"].toEchoStringNoThrow());
     return node;
   }
-  node->points.reserve(parameters["points"].toVector().size());
-  for (const Value& pointValue : parameters["points"].toVector()) {
-    point3d point;
-    if (!pointValue.getVec3(point.x, point.y, point.z, 0.0) ||
-        !std::isfinite(point.x) || !std::isfinite(point.y) || !std::isfinite(point.z)
-        ) {
-      LOG(message_group::Error, inst->location(), parameters.documentRoot(), "Unable to convert points[%1$d] = %2$s to a vec3 of numbers", node->points.size(), pointValue.toEchoStringNoThrow());
-      node->points.push_back({0, 0, 0});
-    } else {
-      node->points.push_back(point);
+  const auto& points = parameters["points"].toVector();
+  node->points.reserve(points.size());
+  if (points.packedWidth() == 2 || points.packedWidth() == 3) {
+    // Packed vectors of numbers only need checking
+    const size_t width = points.packedWidth();
+    const auto& numbers = points.packedNumbers();
+    for (size_t i = 0; i < numbers.size(); i += width) {
+      const point3d point{numbers[i], numbers[i + 1], width == 3 ? numbers[i + 2] : 0.0};
+      if (!std::isfinite(point.x) || !std::isfinite(point.y) || !std::isfinite(point.z)) {
+        LOG(message_group::Error, inst->location(), parameters.documentRoot(), "Unable to convert points[%1$d] = %2$s to a vec3 of numbers", node->points.size(), points.packedElement(i / width).toEchoStringNoThrow());
+        node->points.push_back({0, 0, 0});
+      } else {
+        node->points.push_back(point);
+      }
+    }
+  } else {
+    for (const Value& pointValue : points) {
+      point3d point;
+      if (!pointValue.getVec3(point.x, point.y, point.z, 0.0) ||
+          !std::isfinite(point.x) || !std::isfinite(point.y) || !std::isfinite(point.z)
+          ) {
+        LOG(message_group::Error, inst->location(), parameters.documentRoot(), "Unable to convert points[%1$d] = %2$s to a vec3 of numbers", node->points.size(), pointValue.toEchoStringNoThrow());
+        node->points.push_back({0, 0, 0});
+      } else {
+        node->points.push_back(point);
+      }
     }
   }
 
@@ -530,31 +593,50 @@ static std::shared_ptr<AbstractNode> builtin_polyhedron(const ModuleInstantiatio
     return node;
   }
   size_t faceIndex = 0;
-  node->faces.reserve(faces->toVector().size());
-  for (const Value& faceValue : faces->toVector()) {
-    if (faceValue.type() != Value::Type::VECTOR) {
-      LOG(message_group::Error, inst->location(), parameters.documentRoot(), "Unable to convert faces[%1$d] = %2$s to a vector of numbers", faceIndex, faceValue.toEchoStringNoThrow());
-    } else {
-      size_t pointIndexIndex = 0;
+  const auto& faceValues = faces->toVector();
+  node->faces.reserve(faceValues.size());
+  auto appendPointIndex = [&](std::vector<size_t>& face, double value, size_t pointIndexIndex) {
+      auto pointIndex = (size_t)value;
+      if (pointIndex < node->points.size()) {
+        face.push_back(pointIndex);
+      } else {
+        LOG(message_group::Warning, inst->location(), parameters.documentRoot(), "Point index %1$d is out of bounds (from faces[%2$d][%3$d])", pointIndex, faceIndex, pointIndexIndex);
+      }
+    };
+  if (faceValues.packedWidth() > 1) {
+    // Faces with the same number of points, packed as numbers
+    const size_t width = faceValues.packedWidth();
+    const auto& numbers = faceValues.packedNumbers();
+    for (; faceIndex < faceValues.size(); ++faceIndex) {
       std::vector<size_t> face;
-      for (const Value& pointIndexValue : faceValue.toVector()) {
-        if (pointIndexValue.type() != Value::Type::NUMBER) {
-          LOG(message_group::Error, inst->location(), parameters.documentRoot(), "Unable to convert faces[%1$d][%2$d] = %3$s to a number", faceIndex, pointIndexIndex, pointIndexValue.toEchoStringNoThrow());
-        } else {
-          auto pointIndex = (size_t)pointIndexValue.toDouble();
-          if (pointIndex < node->points.size()) {
-            face.push_back(pointIndex);
-          } else {
-            LOG(message_group::Warning, inst->location(), parameters.documentRoot(), "Point index %1$d is out of bounds (from faces[%2$d][%3$d])", pointIndex, faceIndex, pointIndexIndex);
-          }
-        }
-        pointIndexIndex++;
+      for (size_t pointIndexIndex = 0; pointIndexIndex < width; ++pointIndexIndex) {
+        appendPointIndex(face, numbers[width * faceIndex + pointIndexIndex], pointIndexIndex);
       }
       if (face.size() >= 3) {
         node->faces.push_back(std::move(face));
       }
     }
-    faceIndex++;
+  } else {
+    for (const Value& faceValue : faceValues) {
+      if (faceValue.type() != Value::Type::VECTOR) {
+        LOG(message_group::Error, inst->location(), parameters.documentRoot(), "Unable to convert faces[%1$d] = %2$s to a vector of numbers", faceIndex, faceValue.toEchoStringNoThrow());
+      } else {
+        size_t pointIndexIndex = 0;
+        std::vector<size_t> face;
+        for (const Value& pointIndexValue : faceValue.toVector()) {
+          if (pointIndexValue.type() != Value::Type::NUMBER) {
+            LOG(message_group::Error, inst->location(), parameters.documentRoot(), "Unable to convert faces[%1$d][%2$d] = %3$s to a number", faceIndex, pointIndexIndex, pointIndexValue.toEchoStringNoThrow());
+          } else {
+            appendPointIndex(face, pointIndexValue.toDouble(), pointIndexIndex);
+          }
+          pointIndexIndex++;
+        }
+        if (face.size() >= 3) {
+          node->faces.push_back(std::move(face));
+        }
+      }
+      faceIndex++;
+    }
   }
 
   node->convexity = (int)parameters["convexity"].toDouble();
@@ -711,6 +793,12 @@ std::string PolygonNode::toString() const
   return stream.str();
 }
 
+std::string PolygonNode::toIdString() const
+{
+  if (!use_content_digest(this->points, this->paths)) return toString();
+  return content_digest("polygon", this->points, this->paths, "paths", this->convexity);
+}
+
 const Geometry *PolygonNode::createGeometry() const
 {
   auto p = new Polygon2d();
@@ -752,15 +840,31 @@ static std::shared_ptr<AbstractNode> builtin_polygon(const ModuleInstantiation *
     LOG(message_group::Error, inst->location(), parameters.documentRoot(), "Unable to convert points = %1$s to a vector of coordinates", parameters["points"].toEchoStringNoThrow());
     return node;
   }
-  for (const Value& pointValue : parameters["points"].toVector()) {
-    point2d point;
-    if (!pointValue.getVec2(point.x, point.y) ||
-        !std::isfinite(point.x) || !std::isfinite(point.y)
-        ) {
-      LOG(message_group::Error, inst->location(), parameters.documentRoot(), "Unable to convert points[%1$d] = %2$s to a vec2 of numbers", node->points.size(), pointValue.toEchoStringNoThrow());
-      node->points.push_back({0, 0});
-    } else {
-      node->points.push_back(point);
+  const auto& points = parameters["points"].toVector();
+  if (points.packedWidth() == 2) {
+    // Packed vectors of numbers only need checking
+    const auto& numbers = points.packedNumbers();
+    node->points.reserve(points.size());
+    for (size_t i = 0; i < numbers.size(); i += 2) {
+      const point2d point{numbers[i], numbers[i + 1]};
+      if (!std::isfinite(point.x) || !std::isfinite(point.y)) {
+        LOG(message_group::Error, inst->location(), parameters.documentRoot(), "Unable to convert points[%1$d] = %2$s to a vec2 of numbers", node->points.size(), points.packedElement(i / 2).toEchoStringNoThrow());
+        node->points.push_back({0, 0});
+      } else {
+        node->points.push_back(point);
+      }
+    }
+  } else {
+    for (const Value& pointValue : points) {
+      point2d point;
+      if (!pointValue.getVec2(point.x, point.y) ||
+          !std::isfinite(point.x) || !std::isfinite(point.y)
+          ) {
+        LOG(message_group::Error, inst->location(), parameters.documentRoot(), "Unable to convert points[%1$d] = %2$s to a vec2 of numbers", node->points.size(), pointValue.toEchoStringNoThrow());
+        node->points.push_back({0, 0});
+      } else {
+        node->points.push_back(point);
+      }
     }
   }
 
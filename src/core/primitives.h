@@ -113,6 +113,7 @@ class PolyhedronNode : public LeafNode
 public:
   PolyhedronNode (const ModuleInstantiation *mi) : LeafNode(mi) {}
   std::string toString() const override;
+  std::string toIdString() const override;
   std::string name() const override { return "polyhedron"; }
   const Geometry *createGeometry() const override;
 
@@ -171,6 +172,7 @@ class PolygonNode : public LeafNode
 public:
   PolygonNode (const ModuleInstantiation *mi) : LeafNode(mi) {}
   std::string toString() const override;
+  std::string toIdString() const override;
   std::string name() const override { return "polygon"; }
   const Geometry *createGeometry() const override;
 
@@ -1,16 +1,35 @@
 #include "progress.h"
 #include "node.h"
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 int progress_report_count;
 int progress_mark_;
 void (*progress_report_f)(const std::shared_ptr<const AbstractNode> &, void *, int);
 void *progress_report_userdata;
 
+namespace {
+// Report callbacks may interact with the GUI, so they are only invoked from the
+// thread which prepared the progress report. Other threads (e.g. from parallel
+// geometry evaluation) just record the furthest mark they reached.
+std::thread::id progress_thread_id;
+std::atomic<int> progress_pending_mark{0};
+
+bool is_progress_thread()
+{
+  return std::this_thread::get_id() == progress_thread_id;
+}
+}
+
 void progress_report_prep(const std::shared_ptr<AbstractNode> &root, void (*f)(const std::shared_ptr<const AbstractNode> &node, void *userdata, int mark), void *userdata)
 {
   progress_report_count = 0;
   progress_report_f = f;
   progress_report_userdata = userdata;
+  progress_thread_id = std::this_thread::get_id();
+  progress_pending_mark = 0;
   root->progress_prepare();
 }
 
@@ -19,17 +38,23 @@ void progress_report_fin()
   progress_report_count = 0;
   progress_report_f = nullptr;
   progress_report_userdata = nullptr;
+  progress_pending_mark = 0;
 }
 
 void progress_update(const std::shared_ptr<const AbstractNode> &node, int mark)
 {
   if (progress_report_f) {
-    progress_mark_ = mark;
+    if (!is_progress_thread()) {
+      int pending = progress_pending_mark.load();
+      while (pending < mark && !progress_pending_mark.compare_exchange_weak(pending, mark)) {}
+      return;
+    }
+    progress_mark_ = std::max(mark, progress_pending_mark.load());
     progress_report_f(node, progress_report_userdata, progress_mark_);
   }
 }
 
 void progress_tick()
 {
-  if (progress_report_f) progress_report_f(std::shared_ptr<const AbstractNode>(), progress_report_userdata, ++progress_mark_);
+  if (progress_report_f && is_progress_thread()) progress_report_f(std::shared_ptr<const AbstractNode>(), progress_report_userdata, ++progress_mark_);
 }
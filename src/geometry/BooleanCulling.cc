@@ -0,0 +1,159 @@
+#include "BooleanCulling.h"
+#include "PolySet.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace BooleanCulling {
+
+namespace {
+
+bool hasVolume(const Geometry::GeometryItem& item)
+{
+  return item.second && !item.second->isEmpty();
+}
+
+} // namespace
+
+Statistics& statistics()
+{
+  static Statistics statistics;
+  return statistics;
+}
+
+double tolerance(const BoundingBox& total)
+{
+  return total.isEmpty() ? 0.0 : 1e-9 * std::max(1.0, total.diagonal().norm());
+}
+
+bool isApart(const BoundingBox& a, const BoundingBox& b, double eps)
+{
+  for (int i = 0; i < 3; ++i) {
+    if (b.min()[i] > a.max()[i] + eps || a.min()[i] > b.max()[i] + eps) return true;
+  }
+  return false;
+}
+
+void forEachOverlap(const std::vector<BoundingBox>& boxes, double eps,
+                    const std::function<bool(size_t, size_t)>& overlap)
+{
+  std::vector<size_t> order;
+  order.reserve(boxes.size());
+  for (size_t i = 0; i < boxes.size(); ++i) {
+    if (!boxes[i].isEmpty()) order.push_back(i);
+  }
+  std::sort(order.begin(), order.end(), [&boxes](size_t a, size_t b) {
+    return boxes[a].min().x() < boxes[b].min().x();
+  });
+  for (size_t i = 0; i < order.size(); ++i) {
+    const auto& a = boxes[order[i]];
+    for (size_t j = i + 1; j < order.size(); ++j) {
+      const auto& b = boxes[order[j]];
+      if (b.min().x() > a.max().x() + eps) break;
+      if (!isApart(a, b, eps) && !overlap(std::min(order[i], order[j]), std::max(order[i], order[j]))) return;
+    }
+  }
+}
+
+Geometry::Geometries composeDisjoint(const Geometry::Geometries& children, const Converter& convert)
+{
+  // Only 3D PolySets are grouped, the others keep an empty box
+  std::vector<BoundingBox> boxes;
+  BoundingBox total;
+  for (const auto& item : children) {
+    const auto ps = dynamic_pointer_cast<const PolySet>(item.second);
+    boxes.push_back(ps && ps->getDimension() == 3 && hasVolume(item) ? ps->getBoundingBox() : BoundingBox());
+    total.extend(boxes.back());
+  }
+  std::vector<std::vector<size_t>> overlapping(children.size());
+  forEachOverlap(boxes, tolerance(total), [&overlapping](size_t i, size_t j) {
+    overlapping[j].push_back(i);
+    return true;
+  });
+
+  // Each child goes into the first group holding none of the children it overlaps
+  Geometry::Geometries result;
+  std::vector<std::vector<const Geometry::GeometryItem *>> groups;
+  std::vector<size_t> groupOf(children.size());
+  std::vector<bool> taken;
+  size_t next = 0;
+  for (const auto& item : children) {
+    const size_t i = next++;
+    if (boxes[i].isEmpty()) {
+      result.push_back(item);
+      continue;
+    }
+    taken.assign(groups.size(), false);
+    for (const size_t j : overlapping[i]) taken[groupOf[j]] = true;
+    groupOf[i] = std::find(taken.begin(), taken.end(), false) - taken.begin();
+    if (groupOf[i] == groups.size()) groups.emplace_back();
+    groups[groupOf[i]].push_back(&item);
+  }
+
+  for (const auto& group : groups) {
+    if (group.size() == 1) {
+      result.push_back(*group.front());
+      continue;
+    }
+    auto ps = std::make_shared<PolySet>(3);
+    size_t numPolygons = 0;
+    unsigned int convexity = 1;
+    for (const auto *item : group) {
+      numPolygons += item->second->numFacets();
+      convexity = std::max(convexity, item->second->getConvexity());
+    }
+    ps->reserve(numPolygons);
+    ps->setConvexity(convexity);
+    for (const auto *item : group) {
+      ps->append(static_cast<const PolySet&>(*item->second));
+    }
+    auto converted = convert(ps);
+    if (!converted || converted->isEmpty()) {
+      // A child the backend can't convert must not take the rest of its group with it
+      for (const auto *item : group) result.push_back(*item);
+      continue;
+    }
+    result.emplace_back(group.front()->first, converted);
+    statistics().unions += group.size() - 1;
+  }
+  return result;
+}
+
+Geometry::Geometries dropDisjointSubtrahends(const Geometry::Geometries& children)
+{
+  if (children.empty() || !hasVolume(children.front())) return children;
+  const auto minuend = children.front().second->getBoundingBox();
+  const double eps = tolerance(minuend);
+
+  Geometry::Geometries result;
+  for (const auto& item : children) {
+    if (!result.empty() && hasVolume(item) && isApart(minuend, item.second->getBoundingBox(), eps)) {
+      statistics().differences++;
+      continue;
+    }
+    result.push_back(item);
+  }
+  return result;
+}
+
+bool isIntersectionEmpty(const Geometry::Geometries& children)
+{
+  // Empty children are left to the boolean operation itself
+  if (children.size() < 2 || !std::all_of(children.begin(), children.end(), hasVolume)) return false;
+  BoundingBox total;
+  for (const auto& item : children) total.extend(item.second->getBoundingBox());
+  const double eps = tolerance(total);
+
+  auto common = total;
+  for (const auto& item : children) {
+    const auto bbox = item.second->getBoundingBox();
+    if (isApart(common, bbox, eps)) {
+      statistics().intersections++;
+      return true;
+    }
+    common = common.intersection(bbox);
+  }
+  return false;
+}
+
+} // namespace BooleanCulling
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Geometry.h"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+/*!
+   Bounding box tests which the GeometryEvaluator runs before 3D boolean
+   operations, to avoid operations whose result is known without computing it.
+   They work on any Geometry, so they apply to all CSG backends alike. Children
+   are only considered apart if their bounding boxes are apart by more than a
+   small tolerance, so touching children still go through the boolean
+   operation.
+ */
+namespace BooleanCulling {
+
+struct Statistics {
+  std::atomic<size_t> unions{0}; // union operands composed without a boolean operation
+  std::atomic<size_t> differences{0}; // subtrahends dropped for being apart from the minuend
+  std::atomic<size_t> intersections{0}; // intersections found empty
+  void reset() { unions = 0; differences = 0; intersections = 0; }
+};
+Statistics& statistics();
+
+/*!
+   Returns how far apart bounding boxes within total must be to count as apart,
+   allowing for rounding of transformed vertices and of later conversions.
+ */
+double tolerance(const BoundingBox& total);
+bool isApart(const BoundingBox& a, const BoundingBox& b, double eps);
+/*!
+   Calls overlap(i, j), with i < j, for each pair of non-empty boxes which are
+   not apart. Boxes are swept along x, so only those overlapping in x are
+   compared. Stops when overlap returns false.
+ */
+void forEachOverlap(const std::vector<BoundingBox>& boxes, double eps,
+                    const std::function<bool(size_t, size_t)>& overlap);
+
+using Converter = std::function<shared_ptr<const Geometry>(const shared_ptr<const Geometry>&)>;
+/*!
+   Partitions the PolySet children into groups with pairwise disjoint bounding
+   boxes, appends each group into a single PolySet and converts that with the
+   backend's convert. If the converted group is empty, e.g. because one child
+   is not a closed mesh, its children are returned separately instead. Other
+   children are kept as they are. The union of the result equals the union of
+   the children.
+ */
+Geometry::Geometries composeDisjoint(const Geometry::Geometries& children, const Converter& convert);
+
+/*!
+   Returns the children of a difference without the subtrahends whose bounding
+   boxes are apart from the one of the minuend (the first child).
+ */
+Geometry::Geometries dropDisjointSubtrahends(const Geometry::Geometries& children);
+
+/*!
+   Returns true if the bounding boxes of the children have no common point, so
+   their intersection is empty.
+ */
+bool isIntersectionEmpty(const Geometry::Geometries& children);
+
+} // namespace BooleanCulling
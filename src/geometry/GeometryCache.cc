@@ -11,18 +11,40 @@
 
 GeometryCache *GeometryCache::inst = nullptr;
 
+bool GeometryCache::contains(const std::string& id) const
+{
+  return this->cache.contains(id);
+}
+
 shared_ptr<const Geometry> GeometryCache::get(const std::string& id) const
 {
-  const auto& geom = this->cache[id]->geom;
+  shared_ptr<const Geometry> geom;
+  lookup(id, geom);
+  return geom;
+}
+
+bool GeometryCache::lookup(const std::string& id, shared_ptr<const Geometry>& geom) const
+{
+  const auto entry = this->cache.get(id);
+  if (!entry) return false;
+  geom = entry->geom;
 #ifdef DEBUG
   PRINTDB("Geometry Cache hit: %s (%d bytes)", id.substr(0, 40) % (geom ? geom->memsize() : 0));
 #endif
-  return geom;
+  return true;
+}
+
+bool GeometryCache::peek(const std::string& id, shared_ptr<const Geometry>& geom) const
+{
+  const auto entry = this->cache.peek(id);
+  if (!entry) return false;
+  geom = entry->geom;
+  return true;
 }
 
 bool GeometryCache::insert(const std::string& id, const shared_ptr<const Geometry>& geom)
 {
-  auto inserted = this->cache.insert(id, new cache_entry(geom), geom ? geom->memsize() : 0);
+  auto inserted = this->cache.insert(id, std::make_shared<const cache_entry>(geom), geom ? geom->memsize() : 0);
 #ifdef DEBUG
   assert(!dynamic_cast<const CGAL_Nef_polyhedron *>(geom.get()));
   if (inserted) PRINTDB("Geometry Cache insert: %s (%d bytes)",
@@ -53,10 +75,16 @@ void GeometryCache::setMaxSizeMB(size_t limit)
   this->cache.setMaxCost(limit * 1024ul * 1024ul);
 }
 
+void GeometryCache::clear()
+{
+  this->cache.clear();
+}
+
 void GeometryCache::print()
 {
   LOG("Geometries in cache: %1$d", this->cache.size());
   LOG("Geometry cache size in bytes: %1$d", this->cache.totalCost());
+  LOG("Geometry cache hits: %1$d, misses: %2$d, evictions: %3$d", this->cache.hits(), this->cache.misses(), this->cache.evictions());
 }
 
 GeometryCache::cache_entry::cache_entry(const shared_ptr<const Geometry>& geom)
@@ -11,14 +11,21 @@ public:
 
   static GeometryCache *instance() { if (!inst) inst = new GeometryCache; return inst; }
 
-  bool contains(const std::string& id) const { return this->cache.contains(id); }
+  bool contains(const std::string& id) const;
   shared_ptr<const class Geometry> get(const std::string& id) const;
+  // Checks for id and gets its geometry in one step, so a concurrent eviction cannot come in between
+  bool lookup(const std::string& id, shared_ptr<const Geometry>& geom) const;
+  // Like lookup(), but does not count a hit or miss
+  bool peek(const std::string& id, shared_ptr<const Geometry>& geom) const;
   bool insert(const std::string& id, const shared_ptr<const Geometry>& geom);
   size_t size() const;
   size_t totalCost() const;
   size_t maxSizeMB() const;
   void setMaxSizeMB(size_t limit);
-  void clear() { cache.clear(); }
+  void clear();
+  size_t hits() const { return cache.hits(); }
+  size_t misses() const { return cache.misses(); }
+  size_t evictions() const { return cache.evictions(); }
   void print();
 
 private:
@@ -30,5 +37,6 @@ private:
     cache_entry(const shared_ptr<const Geometry>& geom);
   };
 
-  Cache<std::string, cache_entry> cache;
+  // get() updates the LRU order
+  mutable Cache<std::string, const cache_entry> cache;
 };
@@ -0,0 +1,434 @@
+#include "GeometryDiskCache.h"
+#include "Feature.h"
+#include "Geometry.h"
+#include "InstancedGeometry.h"
+#include "Polygon2d.h"
+#include "PolySet.h"
+#include "hash.h"
+#include "printutils.h"
+#include "version.h"
+#ifdef ENABLE_CGAL
+#include "CGAL_Nef_polyhedron.h"
+#include "cgalutils.h"
+#include <CGAL/IO/Nef_polyhedron_iostream_3.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <tuple>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+GeometryDiskCache *GeometryDiskCache::inst = nullptr;
+
+namespace {
+
+const char magic[] = "OSCGEOM2";
+const char *const extension = ".geom";
+
+enum class GeometryType : uint8_t { Empty = 0, PolySet = 1, Polygon2d = 2, Nef = 3 };
+
+template <typename T>
+void write(std::ostream& out, T value)
+{
+  out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+bool read(std::istream& in, T& value)
+{
+  return bool(in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+void writeString(std::ostream& out, const std::string& str)
+{
+  write<uint64_t>(out, str.size());
+  out.write(str.data(), str.size());
+}
+
+// Sizes and counts read from a damaged file must not allocate more than the file holds
+uint64_t remaining(std::istream& in)
+{
+  const auto pos = in.tellg();
+  if (pos < 0) return 0;
+  in.seekg(0, std::ios::end);
+  const auto end = in.tellg();
+  in.seekg(pos);
+  return end > pos ? static_cast<uint64_t>(end - pos) : 0;
+}
+
+bool readString(std::istream& in, std::string& str)
+{
+  uint64_t size;
+  if (!read(in, size) || size > remaining(in)) return false;
+  str.resize(size);
+  return bool(in.read(&str[0], size));
+}
+
+void writeTribool(std::ostream& out, boost::tribool value)
+{
+  write<uint8_t>(out, value ? 1 : !value ? 0 : 2);
+}
+
+boost::tribool readTribool(std::istream& in)
+{
+  uint8_t value = 2;
+  read(in, value);
+  if (value == 2) return boost::indeterminate;
+  return value == 1;
+}
+
+void writePolygon2d(std::ostream& out, const Polygon2d& poly)
+{
+  write<int32_t>(out, poly.getConvexity());
+  write<uint8_t>(out, poly.isSanitized());
+  write<uint64_t>(out, poly.outlines().size());
+  for (const auto& outline : poly.outlines()) {
+    write<uint8_t>(out, outline.positive);
+    write<uint64_t>(out, outline.vertices.size());
+    for (const auto& v : outline.vertices) {
+      write(out, v[0]);
+      write(out, v[1]);
+    }
+  }
+}
+
+bool readPolygon2d(std::istream& in, Polygon2d& poly)
+{
+  int32_t convexity;
+  uint8_t sanitized;
+  uint64_t numoutlines;
+  if (!read(in, convexity) || !read(in, sanitized) || !read(in, numoutlines)) return false;
+  poly.setConvexity(convexity);
+  poly.setSanitized(sanitized);
+  for (uint64_t i = 0; i < numoutlines; ++i) {
+    Outline2d outline;
+    uint8_t positive;
+    uint64_t numvertices;
+    if (!read(in, positive) || !read(in, numvertices)) return false;
+    outline.positive = positive;
+    outline.vertices.reserve(std::min<uint64_t>(numvertices, remaining(in) / (2 * sizeof(double))));
+    for (uint64_t j = 0; j < numvertices; ++j) {
+      double x, y;
+      if (!read(in, x) || !read(in, y)) return false;
+      outline.vertices.emplace_back(x, y);
+    }
+    poly.addOutline(std::move(outline));
+  }
+  return true;
+}
+
+void writePolySet(std::ostream& out, const PolySet& ps)
+{
+  write<uint32_t>(out, ps.getDimension());
+  write<int32_t>(out, ps.getConvexity());
+  writeTribool(out, ps.convexValue());
+  writePolygon2d(out, ps.getPolygon());
+  const auto& vertices = ps.polygons.getVertices();
+  write<uint64_t>(out, vertices.size());
+  for (const auto& v : vertices) {
+    write(out, v[0]);
+    write(out, v[1]);
+    write(out, v[2]);
+  }
+  write<uint64_t>(out, ps.polygons.size());
+  for (const auto& polygon : ps.polygons) {
+    write<uint64_t>(out, polygon.size());
+    for (size_t i = 0; i < polygon.size(); ++i) write<uint32_t>(out, polygon.index(i));
+  }
+}
+
+shared_ptr<PolySet> readPolySet(std::istream& in)
+{
+  uint32_t dim;
+  int32_t convexity;
+  if (!read(in, dim) || !read(in, convexity)) return nullptr;
+  const auto convex = readTribool(in);
+  Polygon2d polygon;
+  if (!readPolygon2d(in, polygon)) return nullptr;
+  auto ps = polygon.isEmpty() ? make_shared<PolySet>(dim, convex) : make_shared<PolySet>(polygon);
+  ps->setConvexity(convexity);
+  uint64_t numvertices;
+  if (!read(in, numvertices)) return nullptr;
+  ps->reserve_vertices(std::min<uint64_t>(numvertices, remaining(in) / (3 * sizeof(double))));
+  for (uint64_t i = 0; i < numvertices; ++i) {
+    double x, y, z;
+    if (!read(in, x) || !read(in, y) || !read(in, z)) return nullptr;
+    ps->add_vertex(Vector3d(x, y, z));
+  }
+  uint64_t numpolygons;
+  if (!read(in, numpolygons)) return nullptr;
+  ps->reserve(std::min<uint64_t>(numpolygons, remaining(in) / sizeof(uint64_t)));
+  for (uint64_t i = 0; i < numpolygons; ++i) {
+    uint64_t numindices;
+    if (!read(in, numindices)) return nullptr;
+    ps->append_poly(numindices);
+    for (uint64_t j = 0; j < numindices; ++j) {
+      uint32_t index;
+      if (!read(in, index) || index >= numvertices) return nullptr;
+      ps->append_index(index);
+    }
+  }
+  return ps;
+}
+
+/*!
+   Serializes geom. Geometry types without a native representation are stored as PolySet.
+   Returns false if the geometry cannot be stored.
+ */
+bool writeGeometry(std::ostream& out, const shared_ptr<const Geometry>& geom)
+{
+  if (!geom) {
+    write(out, GeometryType::Empty);
+  } else if (dynamic_pointer_cast<const InstancedGeometry>(geom)) {
+    // Cheap to recreate from the cached instanced geometry
+    return false;
+  } else if (const auto poly = dynamic_pointer_cast<const Polygon2d>(geom)) {
+    write(out, GeometryType::Polygon2d);
+    writePolygon2d(out, *poly);
+  } else if (const auto ps = dynamic_pointer_cast<const PolySet>(geom)) {
+    write(out, GeometryType::PolySet);
+    writePolySet(out, *ps);
+  }
+#ifdef ENABLE_CGAL
+  else if (const auto N = dynamic_pointer_cast<const CGAL_Nef_polyhedron>(geom)) {
+    write(out, GeometryType::Nef);
+    write<int32_t>(out, N->getConvexity());
+    std::ostringstream nefstream;
+    if (N->p3) nefstream << *N->p3;
+    writeString(out, nefstream.str());
+  } else if (const auto ps = CGALUtils::getGeometryAsPolySet(geom)) {
+    write(out, GeometryType::PolySet);
+    writePolySet(out, *ps);
+  }
+#endif
+  else {
+    return false;
+  }
+  return bool(out);
+}
+
+bool readGeometry(std::istream& in, shared_ptr<const Geometry>& geom)
+{
+  GeometryType type;
+  if (!read(in, type)) return false;
+  switch (type) {
+  case GeometryType::Empty:
+    geom.reset();
+    return true;
+  case GeometryType::Polygon2d: {
+    auto poly = make_shared<Polygon2d>();
+    if (!readPolygon2d(in, *poly)) return false;
+    geom = poly;
+    return true;
+  }
+  case GeometryType::PolySet:
+    geom = readPolySet(in);
+    return bool(geom);
+#ifdef ENABLE_CGAL
+  case GeometryType::Nef: {
+    int32_t convexity;
+    std::string nefdata;
+    if (!read(in, convexity) || !readString(in, nefdata)) return false;
+    shared_ptr<CGAL_Nef_polyhedron> N;
+    if (nefdata.empty()) {
+      N = make_shared<CGAL_Nef_polyhedron>();
+    } else {
+      auto p3 = make_shared<CGAL_Nef_polyhedron3>();
+      std::istringstream nefstream(nefdata);
+      try {
+        nefstream >> *p3;
+      } catch (const CGAL::Failure_exception&) {
+        return false;
+      }
+      if (!nefstream) return false;
+      N = make_shared<CGAL_Nef_polyhedron>(p3);
+    }
+    N->setConvexity(convexity);
+    geom = N;
+    return true;
+  }
+#endif
+  default:
+    return false;
+  }
+}
+
+/*!
+   Describes everything besides the node itself which influences the geometry
+   produced for a node.
+ */
+std::string engineConfiguration()
+{
+  std::string config = openscad_versionnumber;
+  for (auto it = Feature::begin(); it != Feature::end(); ++it) {
+    if ((*it)->is_enabled()) config += " " + (*it)->get_name();
+  }
+  return config;
+}
+
+} // namespace
+
+void GeometryDiskCache::setDirectory(const std::string& dir)
+{
+  this->dir.clear();
+  this->totalsize = 0;
+  if (dir.empty()) return;
+
+  boost::system::error_code ec;
+  fs::create_directories(dir, ec);
+  if (!fs::is_directory(dir, ec)) {
+    LOG(message_group::Warning, "Cannot use geometry cache directory %1$s, disk cache disabled", dir);
+    return;
+  }
+  this->dir = dir;
+  this->totalsize = scanSize();
+  std::lock_guard<std::mutex> lock(this->missingmutex);
+  this->missing.clear();
+}
+
+void GeometryDiskCache::setMaxSizeMB(size_t limit)
+{
+  this->maxsize = limit * 1024ul * 1024ul;
+  if (isEnabled() && this->totalsize > this->maxsize) trim(this->maxsize);
+}
+
+std::string GeometryDiskCache::cacheKey(const std::string& id) const
+{
+  return id + "\n" + engineConfiguration();
+}
+
+std::string GeometryDiskCache::cachePath(const std::string& digest) const
+{
+  return (fs::path(this->dir) / (digest + extension)).string();
+}
+
+bool GeometryDiskCache::lookup(const std::string& id, shared_ptr<const Geometry>& geom)
+{
+  if (!isEnabled()) return false;
+
+  const auto key = cacheKey(id);
+  const auto digest = Hash128().update(key).hexdigest();
+  {
+    std::lock_guard<std::mutex> lock(this->missingmutex);
+    if (this->missing.count(digest)) return false;
+  }
+  const auto path = cachePath(digest);
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    this->nummisses++;
+    std::lock_guard<std::mutex> lock(this->missingmutex);
+    this->missing.insert(digest);
+    return false;
+  }
+
+  char filemagic[sizeof(magic) - 1];
+  std::string filekey;
+  if (!in.read(filemagic, sizeof(filemagic)) || !std::equal(filemagic, filemagic + sizeof(filemagic), magic) ||
+      !readString(in, filekey) || filekey != key || !readGeometry(in, geom)) {
+    // Hash collision, stale format or a partially written file from an older version
+    this->nummisses++;
+    std::lock_guard<std::mutex> lock(this->missingmutex);
+    this->missing.insert(digest);
+    return false;
+  }
+  in.close();
+
+  // Keep track of the last use for the LRU eviction
+  boost::system::error_code ec;
+  fs::last_write_time(path, std::time(nullptr), ec);
+  this->numhits++;
+  return true;
+}
+
+bool GeometryDiskCache::insert(const std::string& id, const shared_ptr<const Geometry>& geom)
+{
+  if (!isEnabled()) return false;
+
+  const auto key = cacheKey(id);
+  const auto digest = Hash128().update(key).hexdigest();
+  const auto path = cachePath(digest);
+  boost::system::error_code ec;
+  if (fs::exists(path, ec)) return false;
+
+  std::ostringstream out(std::ios::binary);
+  out.write(magic, sizeof(magic) - 1);
+  writeString(out, key);
+  if (!writeGeometry(out, geom)) return false;
+  const auto data = out.str();
+  if (data.size() > this->maxsize) return false;
+
+  // Write to a unique temporary file and rename, so concurrent readers and writers
+  // never see partial files.
+  const auto tmppath = fs::path(this->dir) / fs::unique_path("%%%%-%%%%-%%%%-%%%%.tmp");
+  {
+    std::ofstream file(tmppath.string(), std::ios::binary);
+    file.write(data.data(), data.size());
+    if (!file) {
+      file.close();
+      fs::remove(tmppath, ec);
+      return false;
+    }
+  }
+  fs::rename(tmppath, path, ec);
+  if (ec) {
+    fs::remove(tmppath, ec);
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->missingmutex);
+    this->missing.erase(digest);
+  }
+  this->numwrites++;
+  this->totalsize += data.size();
+  if (this->totalsize > this->maxsize) trim(this->maxsize * 9 / 10);
+  return true;
+}
+
+size_t GeometryDiskCache::scanSize() const
+{
+  size_t size = 0;
+  boost::system::error_code ec;
+  for (fs::directory_iterator it(this->dir, ec), end; !ec && it != end; it.increment(ec)) {
+    if (it->path().extension() == extension) size += fs::file_size(it->path(), ec);
+  }
+  return size;
+}
+
+/*!
+   Removes the least recently used files until the cache is at most limit bytes.
+   The directory is rescanned, since other processes may share it.
+ */
+void GeometryDiskCache::trim(size_t limit)
+{
+  std::lock_guard<std::mutex> lock(this->trimmutex);
+  std::vector<std::tuple<std::time_t, size_t, fs::path>> files;
+  size_t size = 0;
+  boost::system::error_code ec;
+  for (fs::directory_iterator it(this->dir, ec), end; !ec && it != end; it.increment(ec)) {
+    if (it->path().extension() != extension) continue;
+    const auto filesize = fs::file_size(it->path(), ec);
+    if (ec) continue;
+    files.emplace_back(fs::last_write_time(it->path(), ec), filesize, it->path());
+    size += filesize;
+  }
+  std::sort(files.begin(), files.end());
+  for (const auto& [time, filesize, path] : files) {
+    if (size <= limit) break;
+    if (fs::remove(path, ec)) size -= filesize;
+  }
+  this->totalsize = size;
+}
+
+void GeometryDiskCache::print()
+{
+  if (!isEnabled()) return;
+  LOG("Geometry disk cache: %1$d hits, %2$d misses, %3$d writes", hits(), misses(), writes());
+  LOG("Geometry disk cache size in bytes: %1$d", totalSize());
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include "memory.h"
+
+class Geometry;
+
+/*!
+   Persistent, content-addressed geometry cache shared between OpenSCAD runs.
+
+   Geometries are stored as one file per node in the cache directory, named by a
+   hash of the node ID string and the engine configuration (version and enabled
+   features). Each file also contains the full key, so hash collisions are detected
+   and treated as misses. The ID string is used rather than the in-memory node key,
+   as the latter is only checked for collisions within one tree. Keys found
+   missing are remembered, so repeated lookups do not probe the disk again. Files are written to a temporary name and atomically
+   renamed, so multiple processes may use the same directory concurrently.
+   When the directory grows beyond its size limit, the least recently used files
+   are removed.
+
+   The cache is disabled until a directory is set.
+ */
+class GeometryDiskCache
+{
+public:
+  GeometryDiskCache(size_t limit = 1024ul * 1024ul * 1024ul) : maxsize(limit) {}
+
+  static GeometryDiskCache *instance() { if (!inst) inst = new GeometryDiskCache; return inst; }
+
+  void setDirectory(const std::string& dir);
+  [[nodiscard]] const std::string& directory() const { return this->dir; }
+  [[nodiscard]] bool isEnabled() const { return !this->dir.empty(); }
+
+  /*! Looks up the node ID string id. Returns true on a hit, where geom may be nullptr for empty geometry. */
+  bool lookup(const std::string& id, shared_ptr<const Geometry>& geom);
+  /*! Stores geom under id, unless it is already stored or cannot be serialized. */
+  bool insert(const std::string& id, const shared_ptr<const Geometry>& geom);
+
+  [[nodiscard]] size_t maxSizeMB() const { return this->maxsize / (1024ul * 1024ul); }
+  void setMaxSizeMB(size_t limit);
+  [[nodiscard]] size_t totalSize() const { return this->totalsize; }
+  [[nodiscard]] size_t hits() const { return this->numhits; }
+  [[nodiscard]] size_t misses() const { return this->nummisses; }
+  [[nodiscard]] size_t writes() const { return this->numwrites; }
+  void print();
+
+private:
+  static GeometryDiskCache *inst;
+
+  [[nodiscard]] std::string cacheKey(const std::string& id) const;
+  [[nodiscard]] std::string cachePath(const std::string& digest) const;
+  size_t scanSize() const;
+  void trim(size_t limit);
+
+  std::string dir;
+  size_t maxsize;
+  std::atomic<size_t> totalsize{0};
+  std::atomic<size_t> numhits{0};
+  std::atomic<size_t> nummisses{0};
+  std::atomic<size_t> numwrites{0};
+  std::mutex trimmutex;
+  // Digests of keys without a file
+  std::unordered_set<std::string> missing;
+  std::mutex missingmutex;
+};
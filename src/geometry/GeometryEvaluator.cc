@@ -1,6 +1,7 @@
 #include "GeometryEvaluator.h"
 #include "Tree.h"
 #include "GeometryCache.h"
+#include "GeometryDiskCache.h"
 #include "CGALCache.h"
 #include "Polygon2d.h"
 #include "ModuleInstantiation.h"
@@ -14,6 +15,7 @@
 #include "RotateExtrudeNode.h"
 #include "CgalAdvNode.h"
 #include "ProjectionNode.h"
+#include "ImportNode.h"
 #include "CsgOpNode.h"
 #include "TextNode.h"
 #include "CGALHybridPolyhedron.h"
@@ -22,11 +24,16 @@
 #include "ClipperUtils.h"
 #include "PolySetUtils.h"
 #include "PolySet.h"
+#include "InstancedGeometry.h"
+#include "BooleanCulling.h"
 #include "calc.h"
 #include "printutils.h"
 #include "calc.h"
 #include "DxfData.h"
 #include "degree_trig.h"
+#include "Feature.h"
+#include "parallel.h"
+#include "Profiler.h"
 #include <ciso646> // C alternative tokens (xor)
 #include <algorithm>
 #include "boost-utils.h"
@@ -44,25 +51,43 @@ class Tree;
 
 GeometryEvaluator::GeometryEvaluator(const Tree& tree) : tree(tree) { }
 
+/*!
+   Names the geometry kernel which produced geom, for profiling.
+ */
+static const char *geometryBackend(const shared_ptr<const Geometry>& geom)
+{
+  if (!geom) return "none";
+  if (dynamic_pointer_cast<const InstancedGeometry>(geom)) return "instanced";
+  if (dynamic_pointer_cast<const CGAL_Nef_polyhedron>(geom)) return "Nef";
+  if (dynamic_pointer_cast<const CGALHybridPolyhedron>(geom)) return "hybrid";
+#ifdef ENABLE_MANIFOLD
+  if (dynamic_pointer_cast<const ManifoldGeometry>(geom)) return "Manifold";
+#endif
+  if (dynamic_pointer_cast<const Polygon2d>(geom)) return "Clipper";
+  return "PolySet";
+}
+
 /*!
    Set allownef to false to force the result to _not_ be a Nef polyhedron
  */
 shared_ptr<const Geometry> GeometryEvaluator::evaluateGeometry(const AbstractNode& node,
                                                                bool allownef)
 {
-  const std::string& key = this->tree.getIdString(node);
-  if (!GeometryCache::instance()->contains(key)) {
-    shared_ptr<const Geometry> N;
-    if (CGALCache::instance()->contains(key)) {
-      N = CGALCache::instance()->get(key);
-    }
-
+  const std::string& key = this->tree.getNodeKey(node);
+  shared_ptr<const Geometry> cached;
+  bool hasgeom = GeometryCache::instance()->lookup(key, cached);
+  if (!hasgeom && !CGALCache::instance()->lookup(key, cached) && loadFromDiskCache(node, cached)) {
+    hasgeom = !CGALCache::acceptsGeometry(cached);
+  }
+  if (!hasgeom) {
     // If not found in any caches, we need to evaluate the geometry
-    if (N) {
-      this->root = N;
+    if (cached) {
+      this->root = cached;
     } else {
       this->traverse(node);
+      this->smartcached.clear();
     }
+    this->root = InstancedGeometry::materialize(this->root);
 
     if (dynamic_pointer_cast<const CGALHybridPolyhedron>(this->root)) {
       this->root = CGALUtils::getGeometryAsPolySet(this->root);
@@ -92,7 +117,7 @@ shared_ptr<const Geometry> GeometryEvaluator::evaluateGeometry(const AbstractNod
     smartCacheInsert(node, this->root);
     return this->root;
   }
-  return GeometryCache::instance()->get(key);
+  return InstancedGeometry::materialize(cached);
 }
 
 bool GeometryEvaluator::isValidDim(const Geometry::GeometryItem& item, unsigned int& dim) const {
@@ -128,6 +153,7 @@ GeometryEvaluator::ResultObject GeometryEvaluator::applyToChildren3D(const Abstr
   if (children.size() == 0) return {};
 
   if (op == OpenSCADOperator::HULL) {
+    for (auto& item : children) item.second = InstancedGeometry::materialize(item.second);
     auto *ps = new PolySet(3, /* convex */ true);
 
     if (CGALUtils::applyHull(children, *ps)) {
@@ -145,6 +171,12 @@ GeometryEvaluator::ResultObject GeometryEvaluator::applyToChildren3D(const Abstr
   // Only one child -> this is a noop
   if (children.size() == 1) return {children.front().second};
 
+  if (op == OpenSCADOperator::UNION && Feature::ExperimentalLazyTransforms.is_enabled()) {
+    if (auto instanced = InstancedGeometry::unionDisjoint(children)) return {instanced};
+  }
+  // Instances which could not be kept lazy take part in CSG as regular geometry
+  for (auto& item : children) item.second = InstancedGeometry::materialize(item.second);
+
   switch (op) {
   case OpenSCADOperator::MINKOWSKI:
   {
@@ -165,16 +197,33 @@ GeometryEvaluator::ResultObject GeometryEvaluator::applyToChildren3D(const Abstr
     }
     if (actualchildren.empty()) return {};
     if (actualchildren.size() == 1) return {actualchildren.front().second};
+    // Children apart from each other are composed without union, but still
+    // converted by the backend so the result type stays the same
 #ifdef ENABLE_MANIFOLD
     if (Feature::ExperimentalManifold.is_enabled()) {
+      actualchildren = BooleanCulling::composeDisjoint(actualchildren, [](const shared_ptr<const Geometry>& geom) {
+        return ManifoldUtils::createMutableManifoldFromGeometry(geom);
+      });
       return {ManifoldUtils::applyOperator3DManifold(actualchildren, op)};
     }
 #endif
+    if (Feature::ExperimentalFastCsg.is_enabled()) {
+      actualchildren = BooleanCulling::composeDisjoint(actualchildren, [](const shared_ptr<const Geometry>& geom) {
+        return CGALUtils::createMutableHybridPolyhedronFromGeometry(geom);
+      });
+    } else {
+      actualchildren = BooleanCulling::composeDisjoint(actualchildren, CGALUtils::getNefPolyhedronFromGeometry);
+    }
     return {CGALUtils::applyUnion3D(actualchildren.begin(), actualchildren.end())};
     break;
   }
   default:
   {
+    if (op == OpenSCADOperator::DIFFERENCE) {
+      children = BooleanCulling::dropDisjointSubtrahends(children);
+    } else if (op == OpenSCADOperator::INTERSECTION && BooleanCulling::isIntersectionEmpty(children)) {
+      return {};
+    }
 #ifdef ENABLE_MANIFOLD
     if (Feature::ExperimentalManifold.is_enabled()) {
       return {ManifoldUtils::applyOperator3DManifold(children, op)};
@@ -252,6 +301,7 @@ Polygon2d *GeometryEvaluator::applyFill2D(const AbstractNode& node)
 Geometry *GeometryEvaluator::applyHull3D(const AbstractNode& node)
 {
   Geometry::Geometries children = collectChildren3D(node);
+  for (auto& item : children) item.second = InstancedGeometry::materialize(item.second);
 
   auto *P = new PolySet(3);
   if (CGALUtils::applyHull(children, *P)) {
@@ -316,34 +366,93 @@ std::vector<const Polygon2d *> GeometryEvaluator::collectChildren2D(const Abstra
 void GeometryEvaluator::smartCacheInsert(const AbstractNode& node,
                                          const shared_ptr<const Geometry>& geom)
 {
-  const std::string& key = this->tree.getIdString(node);
+  // The parent consumes the geometry now, so an entry held by isSmartCached() is not needed anymore
+  this->smartcached.erase(node.index());
+  const std::string& key = this->tree.getNodeKey(node);
 
   if (CGALCache::acceptsGeometry(geom)) {
-    if (!CGALCache::instance()->contains(key)) CGALCache::instance()->insert(key, geom);
+    if (!CGALCache::instance()->contains(key)) {
+      CGALCache::instance()->insert(key, geom);
+      storeInDiskCache(node, geom);
+    }
   } else {
     if (!GeometryCache::instance()->contains(key)) {
       if (!GeometryCache::instance()->insert(key, geom)) {
         LOG(message_group::Warning, "GeometryEvaluator: Node didn't fit into cache.");
       }
+      storeInDiskCache(node, geom);
     }
   }
 }
 
 bool GeometryEvaluator::isSmartCached(const AbstractNode& node)
 {
-  const std::string& key = this->tree.getIdString(node);
-  return (GeometryCache::instance()->contains(key) ||
-          CGALCache::instance()->contains(key));
+  if (this->smartcached.count(node.index())) return true;
+
+  const std::string& key = this->tree.getNodeKey(node);
+  CachedGeometry cached;
+  // Probing is not a use of the geometry, smartCacheGet() counts the hit
+  const bool hasgeom = GeometryCache::instance()->peek(key, cached.geom);
+  const bool hascgal = CGALCache::instance()->peek(key, cached.cgal);
+  if (!hasgeom && !hascgal) {
+    shared_ptr<const Geometry> geom;
+    if (!loadFromDiskCache(node, geom)) return false;
+    if (CGALCache::acceptsGeometry(geom)) cached.cgal = geom;
+    else cached.geom = geom;
+  }
+  this->smartcached.emplace(node.index(), cached);
+  return true;
+}
+
+/*!
+   Moves a geometry stored by an earlier run from the disk cache into the
+   in-memory caches. Returns true if geom was loaded.
+
+   The disk cache outlives the tree, so it is keyed by the full ID string of the
+   node rather than the node key, which is only checked for collisions within
+   the tree.
+ */
+bool GeometryEvaluator::loadFromDiskCache(const AbstractNode& node, shared_ptr<const Geometry>& geom)
+{
+  auto diskcache = GeometryDiskCache::instance();
+  if (!diskcache->isEnabled()) return false;
+
+  shared_ptr<const Geometry> loaded;
+  if (!diskcache->lookup(this->tree.getIdString(node), loaded)) return false;
+  const std::string& key = this->tree.getNodeKey(node);
+  if (CGALCache::acceptsGeometry(loaded)) {
+    // Concurrent subtrees must not share exact geometry, they evaluate it themselves
+    if (this->concurrent) return false;
+    CGALCache::instance()->insert(key, loaded);
+  } else {
+    GeometryCache::instance()->insert(key, loaded);
+  }
+  geom = loaded;
+  return true;
+}
+
+void GeometryEvaluator::storeInDiskCache(const AbstractNode& node, const shared_ptr<const Geometry>& geom)
+{
+  auto diskcache = GeometryDiskCache::instance();
+  if (diskcache->isEnabled()) diskcache->insert(this->tree.getIdString(node), geom);
 }
 
 shared_ptr<const Geometry> GeometryEvaluator::smartCacheGet(const AbstractNode& node, bool preferNef)
 {
-  const std::string& key = this->tree.getIdString(node);
   shared_ptr<const Geometry> geom;
-  bool hasgeom = GeometryCache::instance()->contains(key);
-  bool hascgal = CGALCache::instance()->contains(key);
-  if (hascgal && (preferNef || !hasgeom)) geom = CGALCache::instance()->get(key);
-  else if (hasgeom) geom = GeometryCache::instance()->get(key);
+  if (!isSmartCached(node)) return geom;
+  const auto cached = this->smartcached.extract(node.index()).mapped();
+  // Also marks the entry as recently used. If it was evicted meanwhile, the held geometry is used.
+  const std::string& key = this->tree.getNodeKey(node);
+  if (cached.cgal && (preferNef || !cached.geom)) {
+    if (!CGALCache::instance()->lookup(key, geom)) geom = cached.cgal;
+  } else {
+    if (!GeometryCache::instance()->lookup(key, geom)) geom = cached.geom;
+  }
+  if (Profiler::instance().isEnabled()) {
+    Profiler::annotate(node, "cache", "hit");
+    Profiler::annotate(node, "backend", geometryBackend(geom));
+  }
   return geom;
 }
 
@@ -436,6 +545,11 @@ void GeometryEvaluator::addToParent(const State& state,
                                     const AbstractNode& node,
                                     const shared_ptr<const Geometry>& geom)
 {
+  // Called in the scope of node, so geometry which wasn't taken from a cache is annotated here
+  if (Profiler::instance().isEnabled()) {
+    Profiler::annotateDefault(node, "cache", "miss");
+    Profiler::annotateDefault(node, "backend", geometryBackend(geom));
+  }
   this->visitedchildren.erase(node.index());
   if (state.parent()) {
     this->visitedchildren[state.parent()->index()].push_back(std::make_pair(node.shared_from_this(), geom));
@@ -446,6 +560,161 @@ void GeometryEvaluator::addToParent(const State& state,
   }
 }
 
+/*!
+   Appends the nodes which a serial traversal would evaluate as children of the
+   given node, i.e. the children with any ListNode unpacked.
+ */
+static void collectEffectiveChildren(const AbstractNode& node, std::vector<std::shared_ptr<const AbstractNode>>& children)
+{
+  for (const auto& chnode : node.getChildren()) {
+    if (dynamic_cast<const ListNode *>(chnode.get())) {
+      // Background ListNodes are pruned and never reach their parent
+      if (!chnode->modinst->isBackground()) collectEffectiveChildren(*chnode, children);
+    } else {
+      children.push_back(chnode);
+    }
+  }
+}
+
+/*!
+   Returns true if the node itself must not be evaluated concurrently with other
+   nodes. That is the case if it renders text, as FreeType faces must not be used
+   concurrently, or if it may create exact CGAL geometry from its children with
+   the enabled features, e.g. by a boolean operation.
+ */
+static bool isSerialNode(const AbstractNode& node)
+{
+  if (dynamic_cast<const TextNode *>(&node)) return true;
+  if (const auto *import = dynamic_cast<const ImportNode *>(&node)) return import->type == ImportType::NEF3;
+  if (const auto *projection = dynamic_cast<const ProjectionNode *>(&node)) return projection->cut_mode;
+  if (const auto *cgaladv = dynamic_cast<const CgalAdvNode *>(&node)) {
+    // Minkowski sums decompose their children with Nef polyhedra, hulls only use their points
+    if (cgaladv->type == CgalAdvType::MINKOWSKI) return true;
+    if (cgaladv->type != CgalAdvType::RESIZE) return false;
+  }
+#ifdef ENABLE_MANIFOLD
+  if (Feature::ExperimentalManifold.is_enabled()) return false;
+#endif
+  // Nodes with 2D children, and nodes passing on their children
+  if (dynamic_cast<const LinearExtrudeNode *>(&node) || dynamic_cast<const RotateExtrudeNode *>(&node) ||
+      dynamic_cast<const RoofNode *>(&node) || dynamic_cast<const OffsetNode *>(&node) ||
+      dynamic_cast<const ListNode *>(&node)) {
+    return false;
+  }
+  // Boolean operations, including the implicit union of several children
+  std::vector<std::shared_ptr<const AbstractNode>> children;
+  collectEffectiveChildren(node, children);
+  return children.size() > 1;
+}
+
+/*!
+   Returns true if the subtree rooted at node must be evaluated on the calling
+   thread, i.e. it has a serial node or may read exact CGAL geometry (Nef or
+   hybrid polyhedra) from the cache. The lazy exact numbers of CGAL are not
+   thread-safe, not even for reading a shared object.
+
+   The result is stored for all nodes of the subtree, so evaluators of concurrent
+   subtrees only read the stored results.
+ */
+bool GeometryEvaluator::isSerialSubtree(const AbstractNode& node)
+{
+  const auto found = this->serialsubtrees->find(node.index());
+  if (found != this->serialsubtrees->end()) return found->second;
+  assert(!this->concurrent);
+
+  bool serial = isSerialNode(node) || CGALCache::instance()->contains(this->tree.getNodeKey(node));
+  for (const auto& chnode : node.getChildren()) {
+    if (isSerialSubtree(*chnode)) serial = true;
+  }
+  this->serialsubtrees->emplace(node.index(), serial);
+  return serial;
+}
+
+/*!
+   Evaluates the children of the given node concurrently, each subtree with its own
+   GeometryEvaluator, and stores the results in child order as if the children had
+   been traversed serially. Nested nodes do the same, so the work is balanced by the
+   work-stealing scheduler of the parallel backend. Children with serial subtrees
+   are evaluated afterwards on this thread.
+
+   Returns false if the children should be traversed serially instead.
+ */
+bool GeometryEvaluator::evaluateChildrenInParallel(const State& state, const AbstractNode& node)
+{
+  if (!Feature::ExperimentalParallelEvaluation.is_enabled()) return false;
+
+  std::vector<std::shared_ptr<const AbstractNode>> children;
+  collectEffectiveChildren(node, children);
+  if (children.size() < 2) return false;
+
+  if (!this->serialsubtrees) this->serialsubtrees = std::make_shared<std::map<int, bool>>();
+  std::vector<size_t> concurrentchildren, serialchildren;
+  for (size_t i = 0; i < children.size(); ++i) {
+    if (isSerialSubtree(*children[i])) serialchildren.push_back(i);
+    else concurrentchildren.push_back(i);
+  }
+  if (concurrentchildren.size() < 2) return false;
+
+  std::vector<shared_ptr<const Geometry>> results(children.size());
+  std::vector<shared_ptr<const Geometry>> concurrentresults(concurrentchildren.size());
+  parallelizable_transform(concurrentchildren.begin(), concurrentchildren.end(), concurrentresults.begin(),
+                           [this, &state, &children](size_t i) {
+    GeometryEvaluator evaluator(this->tree);
+    evaluator.serialsubtrees = this->serialsubtrees;
+    evaluator.concurrent = true;
+    return evaluator.evaluateSubtree(*children[i], state);
+  });
+  for (size_t i = 0; i < concurrentchildren.size(); ++i) {
+    results[concurrentchildren[i]] = std::move(concurrentresults[i]);
+  }
+  for (const auto i : serialchildren) {
+    GeometryEvaluator evaluator(this->tree);
+    evaluator.serialsubtrees = this->serialsubtrees;
+    results[i] = evaluator.evaluateSubtree(*children[i], state);
+  }
+
+  auto result = results.cbegin();
+  addEvaluatedChildren(node, result, this->visitedchildren[node.index()]);
+  return true;
+}
+
+/*!
+   Appends the evaluated children of the given node to visited like a serial
+   traversal does, i.e. passing on the children of a ListNode up to the first one
+   of a different dimension. result is advanced past the children's results, which
+   are in the order of collectEffectiveChildren().
+ */
+void GeometryEvaluator::addEvaluatedChildren(const AbstractNode& node, std::vector<shared_ptr<const Geometry>>::const_iterator& result,
+                                             Geometry::Geometries& visited) const
+{
+  for (const auto& chnode : node.getChildren()) {
+    if (dynamic_cast<const ListNode *>(chnode.get())) {
+      if (chnode->modinst->isBackground()) continue;
+      Geometry::Geometries items;
+      addEvaluatedChildren(*chnode, result, items);
+      unsigned int dim = 0;
+      for (const auto& item : items) {
+        if (!isValidDim(item, dim)) break;
+        visited.push_back(item);
+      }
+    } else {
+      visited.emplace_back(chnode, *result++);
+    }
+  }
+}
+
+/*!
+   Evaluates the subtree rooted at node as a child of a node with the given state,
+   and returns its geometry without inserting it into any cache.
+ */
+shared_ptr<const Geometry> GeometryEvaluator::evaluateSubtree(const AbstractNode& node, const State& parentstate)
+{
+  State state(nullptr);
+  state.setPreferNef(parentstate.preferNef());
+  this->traverse(node, state);
+  return this->root;
+}
+
 /*!
    Custom nodes are handled here => implicit union
  */
@@ -454,6 +723,8 @@ Response GeometryEvaluator::visit(State& state, const AbstractNode& node)
   if (state.isPrefix()) {
     if (isSmartCached(node)) return Response::PruneTraversal;
     state.setPreferNef(true); // Improve quality of CSG by avoiding conversion loss
+    // Children were evaluated already, continue directly with postfix
+    if (evaluateChildrenInParallel(state, node)) return Response::PruneTraversal;
   }
   if (state.isPostfix()) {
     shared_ptr<const Geometry> geom;
@@ -647,7 +918,7 @@ Response GeometryEvaluator::visit(State& state, const TextNode& node)
         polygonlist.push_back(polygon);
       }
       geom.reset(ClipperUtils::apply(polygonlist, ClipperLib::ctUnion));
-    } else geom = GeometryCache::instance()->get(this->tree.getIdString(node));
+    } else geom = smartCacheGet(node, false);
     addToParent(state, node, geom);
     node.progress_report();
   }
@@ -666,6 +937,8 @@ Response GeometryEvaluator::visit(State& state, const CsgOpNode& node)
   if (state.isPrefix()) {
     if (isSmartCached(node)) return Response::PruneTraversal;
     state.setPreferNef(true); // Improve quality of CSG by avoiding conversion loss
+    // Children were evaluated already, continue directly with postfix
+    if (evaluateChildrenInParallel(state, node)) return Response::PruneTraversal;
   }
   if (state.isPostfix()) {
     shared_ptr<const Geometry> geom;
@@ -721,6 +994,9 @@ Response GeometryEvaluator::visit(State& state, const TransformNode& node)
             if (newpoly->isSanitized() && mat2.matrix().determinant() <= 0) {
               geom.reset(ClipperUtils::sanitize(*newpoly));
             }
+          } else if (geom->getDimension() == 3 && res.isConst() && Feature::ExperimentalLazyTransforms.is_enabled()) {
+            // Shared geometry, e.g. from a cache: refer to it instead of transforming a copy
+            geom = std::make_shared<InstancedGeometry>(geom, node.matrix);
           } else if (geom->getDimension() == 3) {
             auto mutableGeom = res.asMutableGeometry();
             if (mutableGeom) mutableGeom->transform(node.matrix);
@@ -737,15 +1013,6 @@ Response GeometryEvaluator::visit(State& state, const TransformNode& node)
   return Response::ContinueTraversal;
 }
 
-static void translate_PolySet(PolySet& ps, const Vector3d& translation)
-{
-  for (auto& p : ps.polygons) {
-    for (auto& v : p) {
-      v += translation;
-    }
-  }
-}
-
 /*
    Compare Euclidean length of vectors
    Return:
@@ -1141,10 +1408,8 @@ static Geometry *extrudePolygon(const LinearExtrudeNode& node, const Polygon2d&
   // Create bottom face.
   PolySet *ps_bottom = polyref.tessellate(); // bottom
   // Flip vertex ordering for bottom polygon
-  for (auto& p : ps_bottom->polygons) {
-    std::reverse(p.begin(), p.end());
-  }
-  translate_PolySet(*ps_bottom, Vector3d(0, 0, h1));
+  ps_bottom->flip_faces();
+  ps_bottom->translate(Vector3d(0, 0, h1));
   ps->append(*ps_bottom);
   delete ps_bottom;
 
@@ -1168,7 +1433,7 @@ static Geometry *extrudePolygon(const LinearExtrudeNode& node, const Polygon2d&
     Eigen::Affine2d trans(Eigen::Scaling(node.scale_x, node.scale_y) * Eigen::Affine2d(rotate_degrees(-node.twist)));
     top_poly.transform(trans);
     PolySet *ps_top = top_poly.tessellate();
-    translate_PolySet(*ps_top, Vector3d(0, 0, h2));
+    ps_top->translate(Vector3d(0, 0, h2));
     ps->append(*ps_top);
     delete ps_top;
   }
@@ -1284,9 +1549,7 @@ static Geometry *rotatePolygon(const RotateExtrudeNode& node, const Polygon2d& p
     ps_start->transform(rot);
     // Flip vertex ordering
     if (!flip_faces) {
-      for (auto& p : ps_start->polygons) {
-        std::reverse(p.begin(), p.end());
-      }
+      ps_start->flip_faces();
     }
     ps->append(*ps_start);
     delete ps_start;
@@ -1295,9 +1558,7 @@ static Geometry *rotatePolygon(const RotateExtrudeNode& node, const Polygon2d& p
     Transform3d rot2(angle_axis_degrees(node.angle, Vector3d::UnitZ()) * angle_axis_degrees(90, Vector3d::UnitX()));
     ps_end->transform(rot2);
     if (flip_faces) {
-      for (auto& p : ps_end->polygons) {
-        std::reverse(p.begin(), p.end());
-      }
+      ps_end->flip_faces();
     }
     ps->append(*ps_end);
     delete ps_end;
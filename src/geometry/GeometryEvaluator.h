@@ -40,6 +40,7 @@ public:
   Response visit(State& state, const OffsetNode& node) override;
 
   [[nodiscard]] const Tree& getTree() const { return this->tree; }
+  const char *profileCategory() const override { return "geometry"; }
 
 private:
   class ResultObject
@@ -70,6 +71,8 @@ private:
   void smartCacheInsert(const AbstractNode& node, const shared_ptr<const Geometry>& geom);
   shared_ptr<const Geometry> smartCacheGet(const AbstractNode& node, bool preferNef);
   bool isSmartCached(const AbstractNode& node);
+  bool loadFromDiskCache(const AbstractNode& node, shared_ptr<const Geometry>& geom);
+  void storeInDiskCache(const AbstractNode& node, const shared_ptr<const Geometry>& geom);
   bool isValidDim(const Geometry::GeometryItem& item, unsigned int& dim) const;
   std::vector<const Polygon2d *> collectChildren2D(const AbstractNode& node);
   Geometry::Geometries collectChildren3D(const AbstractNode& node);
@@ -84,6 +87,12 @@ private:
   shared_ptr<const Geometry> projectionCut(const ProjectionNode& node);
   shared_ptr<const Geometry> projectionNoCut(const ProjectionNode& node);
 
+  bool evaluateChildrenInParallel(const State& state, const AbstractNode& node);
+  shared_ptr<const Geometry> evaluateSubtree(const AbstractNode& node, const State& parentstate);
+  void addEvaluatedChildren(const AbstractNode& node, std::vector<shared_ptr<const Geometry>>::const_iterator& result,
+                            Geometry::Geometries& visited) const;
+  bool isSerialSubtree(const AbstractNode& node);
+
   void addToParent(const State& state, const AbstractNode& node, const shared_ptr<const Geometry>& geom);
   Response lazyEvaluateRootNode(State& state, const AbstractNode& node);
 
@@ -91,5 +100,17 @@ private:
   const Tree& tree;
   shared_ptr<const Geometry> root;
 
+  // Geometries found by isSmartCached(), held until smartCacheGet() so that
+  // a concurrent eviction from the caches cannot come in between
+  struct CachedGeometry {
+    shared_ptr<const Geometry> geom;
+    shared_ptr<const Geometry> cgal;
+  };
+  std::map<int, CachedGeometry> smartcached;
+  // Results of isSerialSubtree(), shared with the evaluators of subtrees
+  shared_ptr<std::map<int, bool>> serialsubtrees;
+  // True if this evaluates a subtree concurrently with other evaluators
+  bool concurrent{false};
+
 public:
 };
@@ -0,0 +1,209 @@
+#pragma once
+
+#include "GeometryUtils.h"
+#include "linalg.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+/*!
+   Polygon storage of a PolySet: a shared vertex buffer, and the vertex indices
+   of all polygons in one flat array. Polygon i consists of the indices from
+   ends[i - 1] (or 0) up to ends[i].
+
+   Builders may append a new vertex per polygon corner, or add shared vertices
+   once and refer to them by index. Read access mimics the former
+   std::vector<std::vector<Vector3d>>: the list and each polygon can be indexed
+   and iterated, yielding vertex positions.
+ */
+class IndexedPolygonList
+{
+public:
+  using index_t = uint32_t;
+
+  // A polygon as a read-only sequence of vertex positions
+  class PolygonRef
+  {
+public:
+    class const_iterator
+    {
+public:
+      using iterator_category = std::random_access_iterator_tag;
+      using value_type = Vector3d;
+      using difference_type = std::ptrdiff_t;
+      using reference = const Vector3d&;
+      using pointer = const Vector3d *;
+
+      const_iterator() = default;
+      const_iterator(const Vector3d *vertices, const index_t *index) : vertices(vertices), index(index) {}
+
+      reference operator*() const { return vertices[*index]; }
+      pointer operator->() const { return &vertices[*index]; }
+      reference operator[](difference_type n) const { return vertices[index[n]]; }
+      const_iterator& operator++() { ++index; return *this; }
+      const_iterator operator++(int) { return {vertices, index++}; }
+      const_iterator& operator--() { --index; return *this; }
+      const_iterator operator--(int) { return {vertices, index--}; }
+      const_iterator& operator+=(difference_type n) { index += n; return *this; }
+      const_iterator& operator-=(difference_type n) { index -= n; return *this; }
+      const_iterator operator+(difference_type n) const { return {vertices, index + n}; }
+      const_iterator operator-(difference_type n) const { return {vertices, index - n}; }
+      difference_type operator-(const const_iterator& other) const { return index - other.index; }
+      bool operator==(const const_iterator& other) const { return index == other.index; }
+      bool operator!=(const const_iterator& other) const { return index != other.index; }
+      bool operator<(const const_iterator& other) const { return index < other.index; }
+
+private:
+      const Vector3d *vertices{nullptr};
+      const index_t *index{nullptr};
+    };
+    using iterator = const_iterator;
+    using value_type = Vector3d;
+    using size_type = size_t;
+
+    PolygonRef(const Vector3d *vertices, const index_t *first, const index_t *last)
+      : vertices(vertices), first(first), last(last) {}
+
+    [[nodiscard]] size_t size() const { return last - first; }
+    [[nodiscard]] bool empty() const { return first == last; }
+    const Vector3d& operator[](size_t i) const { return vertices[first[i]]; }
+    [[nodiscard]] const Vector3d& at(size_t i) const {
+      if (i >= size()) throw std::out_of_range("PolygonRef::at");
+      return (*this)[i];
+    }
+    [[nodiscard]] const Vector3d& front() const { return vertices[*first]; }
+    [[nodiscard]] const Vector3d& back() const { return vertices[*(last - 1)]; }
+    [[nodiscard]] const_iterator begin() const { return {vertices, first}; }
+    [[nodiscard]] const_iterator end() const { return {vertices, last}; }
+
+    // Index of corner i in the shared vertex buffer
+    [[nodiscard]] index_t index(size_t i) const { return first[i]; }
+    [[nodiscard]] Polygon toPolygon() const { return {begin(), end()}; }
+
+private:
+    const Vector3d *vertices;
+    const index_t *first;
+    const index_t *last;
+  };
+
+  class const_iterator
+  {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = PolygonRef;
+    using difference_type = std::ptrdiff_t;
+    using reference = PolygonRef;
+    using pointer = void;
+
+    const_iterator(const IndexedPolygonList *list, size_t i) : list(list), i(i) {}
+
+    PolygonRef operator*() const { return (*list)[i]; }
+    PolygonRef operator[](difference_type n) const { return (*list)[i + n]; }
+    const_iterator& operator++() { ++i; return *this; }
+    const_iterator operator++(int) { return {list, i++}; }
+    const_iterator& operator--() { --i; return *this; }
+    const_iterator operator--(int) { return {list, i--}; }
+    const_iterator& operator+=(difference_type n) { i += n; return *this; }
+    const_iterator operator+(difference_type n) const { return {list, i + n}; }
+    difference_type operator-(const const_iterator& other) const { return difference_type(i) - difference_type(other.i); }
+    bool operator==(const const_iterator& other) const { return i == other.i; }
+    bool operator!=(const const_iterator& other) const { return i != other.i; }
+    bool operator<(const const_iterator& other) const { return i < other.i; }
+
+private:
+    const IndexedPolygonList *list;
+    size_t i;
+  };
+  using iterator = const_iterator;
+  using value_type = PolygonRef;
+  using size_type = size_t;
+
+  [[nodiscard]] size_t size() const { return ends.size(); }
+  [[nodiscard]] bool empty() const { return ends.empty(); }
+  PolygonRef operator[](size_t i) const {
+    return {vertices.data(), indices.data() + start(i), indices.data() + ends[i]};
+  }
+  [[nodiscard]] PolygonRef front() const { return (*this)[0]; }
+  [[nodiscard]] PolygonRef back() const { return (*this)[size() - 1]; }
+  [[nodiscard]] const_iterator begin() const { return {this, 0}; }
+  [[nodiscard]] const_iterator end() const { return {this, size()}; }
+
+  // The shared vertex buffer. Vertices may be moved in place, which moves them in every polygon using them.
+  [[nodiscard]] const std::vector<Vector3d>& getVertices() const { return vertices; }
+  [[nodiscard]] std::vector<Vector3d>& getVertices() { return vertices; }
+  [[nodiscard]] const std::vector<index_t>& getIndices() const { return indices; }
+  [[nodiscard]] size_t start(size_t i) const { return i == 0 ? 0 : ends[i - 1]; }
+
+  void reserve(size_t numPolygons, size_t verticesPerPolygon = 3) {
+    ends.reserve(numPolygons);
+    indices.reserve(numPolygons * verticesPerPolygon);
+  }
+  void reserveVertices(size_t numVertices) { vertices.reserve(numVertices); }
+
+  // Adds a vertex to the shared buffer, returning its index
+  index_t addVertex(const Vector3d& v) {
+    vertices.push_back(v);
+    return static_cast<index_t>(vertices.size() - 1);
+  }
+  // Starts a new, empty polygon
+  void beginPolygon() { ends.push_back(indices.size()); }
+  // Appends a shared vertex to the last polygon
+  void appendIndex(index_t index) {
+    assert(!ends.empty() && index < vertices.size());
+    indices.push_back(index);
+    ends.back() = indices.size();
+  }
+  // Inserts a shared vertex at the start of the last polygon
+  void insertIndex(index_t index) {
+    assert(!ends.empty() && index < vertices.size());
+    indices.insert(indices.begin() + static_cast<std::ptrdiff_t>(start(size() - 1)), index);
+    ends.back() = indices.size();
+  }
+  void appendPolygon(const Polygon& polygon) {
+    beginPolygon();
+    for (const auto& v : polygon) appendIndex(addVertex(v));
+  }
+  void append(const IndexedPolygonList& other) {
+    const auto base = static_cast<index_t>(vertices.size());
+    const auto offset = indices.size();
+    vertices.insert(vertices.end(), other.vertices.begin(), other.vertices.end());
+    indices.reserve(indices.size() + other.indices.size());
+    for (index_t index : other.indices) indices.push_back(base + index);
+    ends.reserve(ends.size() + other.ends.size());
+    for (size_t end : other.ends) ends.push_back(offset + end);
+  }
+
+  // Reverses the vertex order of all polygons, flipping their orientation
+  void reverseAll() {
+    for (size_t i = 0; i < size(); ++i) {
+      std::reverse(indices.begin() + static_cast<std::ptrdiff_t>(start(i)), indices.begin() + static_cast<std::ptrdiff_t>(ends[i]));
+    }
+  }
+
+  // Replaces the polygons and vertex buffer; polygonEnds as in ends
+  void assign(std::vector<Vector3d>&& vertices, std::vector<index_t>&& indices, std::vector<size_t>&& polygonEnds) {
+    this->vertices = std::move(vertices);
+    this->indices = std::move(indices);
+    this->ends = std::move(polygonEnds);
+  }
+
+  void clear() {
+    vertices.clear();
+    indices.clear();
+    ends.clear();
+  }
+
+  [[nodiscard]] size_t memsize() const {
+    return vertices.size() * sizeof(Vector3d) + indices.size() * sizeof(index_t) + ends.size() * sizeof(size_t);
+  }
+
+private:
+  std::vector<Vector3d> vertices;
+  std::vector<index_t> indices;
+  std::vector<size_t> ends;
+};
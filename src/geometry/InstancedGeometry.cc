@@ -0,0 +1,168 @@
+#include "InstancedGeometry.h"
+#include "BooleanCulling.h"
+#include "PolySet.h"
+
+#include <algorithm>
+#include <sstream>
+#include <utility>
+
+InstancedGeometry::InstancedGeometry(const shared_ptr<const Geometry>& geometry, const Transform3d& matrix)
+{
+  addInstance(geometry, matrix);
+  if (geometry) setConvexity(geometry->getConvexity());
+}
+
+InstancedGeometry::InstancedGeometry(Instances instances)
+{
+  for (const auto& instance : instances) {
+    addInstance(instance.geometry, instance.matrix);
+    if (instance.geometry) {
+      setConvexity(std::max(getConvexity(), instance.geometry->getConvexity()));
+    }
+  }
+}
+
+// Nested instances are flattened, so materializing never recurses
+void InstancedGeometry::addInstance(const shared_ptr<const Geometry>& geometry, const Transform3d& matrix)
+{
+  if (!geometry) return;
+  if (const auto instanced = dynamic_pointer_cast<const InstancedGeometry>(geometry)) {
+    for (const auto& instance : instanced->instances) {
+      this->instances.push_back({instance.geometry, matrix * instance.matrix});
+    }
+  } else {
+    this->instances.push_back({geometry, matrix});
+  }
+}
+
+shared_ptr<const Geometry> InstancedGeometry::materialize(const shared_ptr<const Geometry>& geom)
+{
+  if (const auto instanced = dynamic_pointer_cast<const InstancedGeometry>(geom)) {
+    return instanced->materialized();
+  }
+  if (const auto list = dynamic_pointer_cast<const GeometryList>(geom)) {
+    Geometry::Geometries children;
+    bool changed = false;
+    for (const auto& item : list->getChildren()) {
+      children.emplace_back(item.first, materialize(item.second));
+      if (children.back().second != item.second) changed = true;
+    }
+    if (!changed) return geom;
+    auto materialized = std::make_shared<GeometryList>(std::move(children));
+    materialized->setConvexity(list->getConvexity());
+    return materialized;
+  }
+  return geom;
+}
+
+shared_ptr<const InstancedGeometry> InstancedGeometry::unionDisjoint(const Geometry::Geometries& children)
+{
+  Instances instances;
+  for (const auto& item : children) {
+    if (!item.second) continue;
+    if (const auto instanced = dynamic_pointer_cast<const InstancedGeometry>(item.second)) {
+      for (const auto& instance : instanced->instances) {
+        if (!dynamic_pointer_cast<const PolySet>(instance.geometry)) return nullptr;
+        instances.push_back(instance);
+      }
+    } else if (dynamic_pointer_cast<const PolySet>(item.second)) {
+      instances.push_back({item.second, Transform3d::Identity()});
+    } else {
+      return nullptr;
+    }
+  }
+  if (instances.size() < 2) return nullptr;
+
+  std::vector<BoundingBox> boxes;
+  boxes.reserve(instances.size());
+  BoundingBox total;
+  for (const auto& instance : instances) {
+    boxes.push_back(instance.matrix * instance.geometry->getBoundingBox());
+    total.extend(boxes.back());
+  }
+  bool disjoint = true;
+  BooleanCulling::forEachOverlap(boxes, BooleanCulling::tolerance(total), [&disjoint](size_t, size_t) {
+    disjoint = false;
+    return false;
+  });
+  if (!disjoint) return nullptr;
+  return std::make_shared<InstancedGeometry>(std::move(instances));
+}
+
+shared_ptr<const Geometry> InstancedGeometry::materialized() const
+{
+  return shared_ptr<const Geometry>(build());
+}
+
+/*!
+   A single instance keeps the type of its geometry. Several instances are only
+   created by unionDisjoint() and are all PolySets, which are appended into one.
+ */
+Geometry *InstancedGeometry::build() const
+{
+  if (this->instances.size() == 1) {
+    Geometry *geom = this->instances.front().geometry->copy();
+    geom->transform(this->instances.front().matrix);
+    geom->setConvexity(getConvexity());
+    return geom;
+  }
+
+  auto *ps = new PolySet(3);
+  ps->setConvexity(getConvexity());
+  size_t numPolygons = 0;
+  for (const auto& instance : this->instances) numPolygons += instance.geometry->numFacets();
+  ps->reserve(numPolygons);
+  for (const auto& instance : this->instances) {
+    const auto *base = dynamic_cast<const PolySet *>(instance.geometry.get());
+    assert(base);
+    PolySet transformed(*base);
+    transformed.transform(instance.matrix);
+    ps->append(transformed);
+  }
+  return ps;
+}
+
+size_t InstancedGeometry::memsize() const
+{
+  // The instanced geometries are shared, and accounted for where they are cached
+  return sizeof(InstancedGeometry) + this->instances.size() * sizeof(Instance);
+}
+
+BoundingBox InstancedGeometry::getBoundingBox() const
+{
+  BoundingBox bbox;
+  for (const auto& instance : this->instances) {
+    bbox.extend(instance.matrix * instance.geometry->getBoundingBox());
+  }
+  return bbox;
+}
+
+std::string InstancedGeometry::dump() const
+{
+  std::ostringstream out;
+  out << "InstancedGeometry:\n instances: " << this->instances.size() << "\n";
+  for (const auto& instance : this->instances) {
+    out << " matrix:\n" << instance.matrix.matrix() << "\n";
+    out << instance.geometry->dump();
+  }
+  return out.str();
+}
+
+bool InstancedGeometry::isEmpty() const
+{
+  return std::all_of(this->instances.begin(), this->instances.end(), [](const Instance& instance) {
+    return instance.geometry->isEmpty();
+  });
+}
+
+size_t InstancedGeometry::numFacets() const
+{
+  size_t count = 0;
+  for (const auto& instance : this->instances) count += instance.geometry->numFacets();
+  return count;
+}
+
+void InstancedGeometry::transform(const Transform3d& mat)
+{
+  for (auto& instance : this->instances) instance.matrix = mat * instance.matrix;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Geometry.h"
+#include "linalg.h"
+
+#include <string>
+#include <vector>
+
+/*!
+   One or more transformed instances of shared 3D geometries, which are not
+   copied or transformed until their vertices are needed.
+
+   The GeometryEvaluator creates these for transforms of cached geometry, and
+   for unions of instances which are far enough apart not to touch each other.
+   They travel through the geometry caches like any other Geometry. Boolean
+   operations, exporters and renderers see the materialized geometry: a
+   transformed copy of a single instance, or one PolySet holding all instances.
+ */
+class InstancedGeometry : public Geometry
+{
+public:
+  struct Instance {
+    shared_ptr<const Geometry> geometry;
+    Transform3d matrix;
+  };
+  using Instances = std::vector<Instance>;
+
+  InstancedGeometry(const shared_ptr<const Geometry>& geometry, const Transform3d& matrix);
+  InstancedGeometry(Instances instances);
+
+  /*!
+     Returns geom itself, or the materialized geometry if geom is an
+     InstancedGeometry. A GeometryList holding instances, at any depth, is
+     returned as a copy with all of them materialized.
+   */
+  static shared_ptr<const Geometry> materialize(const shared_ptr<const Geometry>& geom);
+  /*!
+     Returns the union of the given children as a single InstancedGeometry if all
+     of them are instances of (or plain) PolySets with disjoint bounding boxes.
+     Otherwise, returns nullptr and the union must be computed.
+   */
+  static shared_ptr<const InstancedGeometry> unionDisjoint(const Geometry::Geometries& children);
+
+  /*!
+     Builds the materialized geometry. It is not kept: it would hold a full mesh
+     in every cached instance, which the cache has not accounted for.
+   */
+  [[nodiscard]] shared_ptr<const Geometry> materialized() const;
+  [[nodiscard]] const Instances& getInstances() const { return this->instances; }
+
+  [[nodiscard]] size_t memsize() const override;
+  [[nodiscard]] BoundingBox getBoundingBox() const override;
+  [[nodiscard]] std::string dump() const override;
+  [[nodiscard]] unsigned int getDimension() const override { return 3; }
+  [[nodiscard]] bool isEmpty() const override;
+  [[nodiscard]] Geometry *copy() const override { return build(); }
+  [[nodiscard]] size_t numFacets() const override;
+
+  void transform(const Transform3d& mat) override;
+  void accept(GeometryVisitor& visitor) const override { materialized()->accept(visitor); }
+
+private:
+  [[nodiscard]] Geometry *build() const;
+  void addInstance(const shared_ptr<const Geometry>& geometry, const Transform3d& matrix);
+
+  Instances instances;
+};
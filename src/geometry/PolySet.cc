@@ -30,6 +30,7 @@
 #include "printutils.h"
 #include "Grid.h"
 #include <Eigen/LU>
+#include <limits>
 #include <utility>
 
 /*! /class PolySet
@@ -75,17 +76,28 @@ std::string PolySet::dump() const
   return out.str();
 }
 
-void PolySet::append_poly(size_t expected_vertex_count)
+void PolySet::append_poly(size_t /*expected_vertex_count*/)
 {
-  polygons.emplace_back().reserve(expected_vertex_count);
+  polygons.beginPolygon();
 }
 
 void PolySet::append_poly(const Polygon& poly)
 {
-  polygons.push_back(poly);
+  polygons.appendPolygon(poly);
   this->dirty = true;
 }
 
+size_t PolySet::add_vertex(const Vector3d& v)
+{
+  this->dirty = true;
+  return polygons.addVertex(v);
+}
+
+void PolySet::append_index(size_t index)
+{
+  polygons.appendIndex(static_cast<IndexedPolygonList::index_t>(index));
+}
+
 void PolySet::append_vertex(double x, double y, double z)
 {
   append_vertex(Vector3d(x, y, z));
@@ -93,7 +105,7 @@ void PolySet::append_vertex(double x, double y, double z)
 
 void PolySet::append_vertex(const Vector3d& v)
 {
-  polygons.back().push_back(v);
+  polygons.appendIndex(polygons.addVertex(v));
   this->dirty = true;
 }
 
@@ -109,7 +121,7 @@ void PolySet::insert_vertex(double x, double y, double z)
 
 void PolySet::insert_vertex(const Vector3d& v)
 {
-  polygons.back().insert(polygons.back().begin(), v);
+  polygons.insertIndex(polygons.addVertex(v));
   this->dirty = true;
 }
 
@@ -122,10 +134,8 @@ BoundingBox PolySet::getBoundingBox() const
 {
   if (this->dirty) {
     this->bbox.setNull();
-    for (const auto& poly : polygons) {
-      for (const auto& p : poly) {
-        this->bbox.extend(p);
-      }
+    for (const auto& v : polygons.getVertices()) {
+      this->bbox.extend(v);
     }
     this->dirty = false;
   }
@@ -135,7 +145,7 @@ BoundingBox PolySet::getBoundingBox() const
 size_t PolySet::memsize() const
 {
   size_t mem = 0;
-  for (const auto& p : this->polygons) mem += p.size() * sizeof(Vector3d);
+  mem += this->polygons.memsize();
   mem += this->polygon.memsize() - sizeof(this->polygon);
   mem += sizeof(PolySet);
   return mem;
@@ -143,7 +153,7 @@ size_t PolySet::memsize() const
 
 void PolySet::append(const PolySet& ps)
 {
-  this->polygons.insert(this->polygons.end(), ps.polygons.begin(), ps.polygons.end());
+  this->polygons.append(ps.polygons);
   if (!dirty && !this->bbox.isNull()) {
     this->bbox.extend(ps.getBoundingBox());
   }
@@ -155,11 +165,22 @@ void PolySet::transform(const Transform3d& mat)
   // If mirroring transform, flip faces to avoid the object to end up being inside-out
   bool mirrored = mat.matrix().determinant() < 0;
 
-  for (auto& p : this->polygons) {
-    for (auto& v : p) {
-      v = mat * v;
-    }
-    if (mirrored) std::reverse(p.begin(), p.end());
+  for (auto& v : this->polygons.getVertices()) {
+    v = mat * v;
+  }
+  if (mirrored) this->polygons.reverseAll();
+  this->dirty = true;
+}
+
+void PolySet::flip_faces()
+{
+  this->polygons.reverseAll();
+}
+
+void PolySet::translate(const Vector3d& translation)
+{
+  for (auto& v : this->polygons.getVertices()) {
+    v += translation;
   }
   this->dirty = true;
 }
@@ -179,35 +200,66 @@ void PolySet::resize(const Vector3d& newsize, const Eigen::Matrix<bool, 3, 1>& a
    Quantizes vertices by gridding them as well as merges close vertices belonging to
    neighboring grids.
    May reduce the number of polygons if polygons collapse into < 3 vertices.
+   Afterwards, all polygons share the vertices of the grid, which are also returned
+   in pPointsOut if given.
  */
 void PolySet::quantizeVertices(std::vector<Vector3d> *pPointsOut)
 {
-  Grid3d<unsigned int> grid(GRID_FINE);
-  std::vector<unsigned int> indices; // Vertex indices in one polygon
-  for (auto iter = this->polygons.begin(); iter != this->polygons.end();) {
-    Polygon& p = *iter;
+  using index_t = IndexedPolygonList::index_t;
+  constexpr auto unaligned = std::numeric_limits<index_t>::max();
+  Grid3d<index_t> grid(GRID_FINE);
+  const auto& vertices = this->polygons.getVertices();
+  // Grid index of each vertex, aligned in the order polygons use them
+  std::vector<index_t> gridIndices(vertices.size(), unaligned);
+  std::vector<Vector3d> gridVertices;
+  std::vector<index_t> newIndices;
+  std::vector<size_t> newEnds;
+  newIndices.reserve(this->polygons.getIndices().size());
+  newEnds.reserve(this->polygons.size());
+  std::vector<index_t> indices; // Vertex indices in one polygon
+  bool collapsed = false;
+  for (const auto& p : this->polygons) {
     indices.resize(p.size());
     // Quantize all vertices. Build index list
-    for (unsigned int i = 0; i < p.size(); ++i) {
-      indices[i] = grid.align(p[i]);
-      if (pPointsOut && pPointsOut->size() < grid.db.size()) {
-        pPointsOut->push_back(p[i]);
+    for (size_t i = 0; i < p.size(); ++i) {
+      auto& gridIndex = gridIndices[p.index(i)];
+      if (gridIndex == unaligned) {
+        Vector3d v = p[i];
+        gridIndex = grid.align(v);
+        if (gridIndex == gridVertices.size()) gridVertices.push_back(v);
       }
+      indices[i] = gridIndex;
     }
     // Remove consecutive duplicate vertices
-    auto currp = p.begin();
-    for (unsigned int i = 0; i < indices.size(); ++i) {
+    const size_t start = newIndices.size();
+    for (size_t i = 0; i < indices.size(); ++i) {
       if (indices[i] != indices[(i + 1) % indices.size()]) {
-        (*currp++) = p[i];
+        newIndices.push_back(indices[i]);
       }
     }
-    p.erase(currp, p.end());
-    if (p.size() < 3) {
+    if (newIndices.size() - start < 3) {
       PRINTD("Removing collapsed polygon due to quantizing");
-      this->polygons.erase(iter);
+      newIndices.resize(start);
+      collapsed = true;
     } else {
-      iter++;
+      newEnds.push_back(newIndices.size());
     }
   }
-}
+  if (pPointsOut) *pPointsOut = gridVertices;
 
+  if (collapsed) {
+    // Drop vertices only used by collapsed polygons
+    std::vector<index_t> remap(gridVertices.size(), unaligned);
+    std::vector<Vector3d> used;
+    for (auto& index : newIndices) {
+      if (remap[index] == unaligned) {
+        remap[index] = static_cast<index_t>(used.size());
+        used.push_back(gridVertices[index]);
+      }
+      index = remap[index];
+    }
+    gridVertices = std::move(used);
+  }
+  this->polygons.assign(std::move(gridVertices), std::move(newIndices), std::move(newEnds));
+  this->dirty = true;
+}
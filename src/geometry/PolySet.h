@@ -3,6 +3,7 @@
 #include "Geometry.h"
 #include "linalg.h"
 #include "GeometryUtils.h"
+#include "IndexedPolygonList.h"
 #include "Polygon2d.h"
 #include "boost-utils.h"
 
@@ -13,7 +14,7 @@ class PolySet : public Geometry
 {
 public:
   VISITABLE_GEOMETRY();
-  Polygons polygons;
+  IndexedPolygonList polygons;
 
   PolySet(unsigned int dim, boost::tribool convex = unknown);
   PolySet(Polygon2d origin);
@@ -30,8 +31,12 @@ public:
   void quantizeVertices(std::vector<Vector3d> *pPointsOut = nullptr);
   size_t numFacets() const override { return polygons.size(); }
   void reserve(size_t numFacets) { polygons.reserve(numFacets); }
+  void reserve_vertices(size_t numVertices) { polygons.reserveVertices(numVertices); }
   void append_poly(size_t expected_vertex_count);
   void append_poly(const Polygon& poly);
+  // Adds a vertex that polygons can share through append_index(), returning its index
+  size_t add_vertex(const Vector3d& v);
+  void append_index(size_t index);
   void append_vertex(double x, double y, double z = 0.0);
   void append_vertex(const Vector3d& v);
   void append_vertex(const Vector3f& v);
@@ -39,6 +44,9 @@ public:
   void insert_vertex(const Vector3d& v);
   void insert_vertex(const Vector3f& v);
   void append(const PolySet& ps);
+  // Reverses the vertex order of all polygons
+  void flip_faces();
+  void translate(const Vector3d& translation);
 
   void transform(const Transform3d& mat) override;
   void resize(const Vector3d& newsize, const Eigen::Matrix<bool, 3, 1>& autosize) override;
@@ -4,6 +4,7 @@
 #include "printutils.h"
 #include "GeometryUtils.h"
 #include "Reindexer.h"
+#include <limits>
 #ifdef ENABLE_CGAL
 #include "cgalutils.h"
 #endif
@@ -92,13 +93,20 @@ void tessellate_faces(const PolySet& inps, PolySet& outps)
   // This is usually an undercount, but still prevents a lot of reallocations.
   outps.polygons.reserve(polygons.size() );
 
+  // Output vertex index of each vertex, added when first used
+  std::vector<size_t> indices(verts.size(), std::numeric_limits<size_t>::max());
+  auto append_vertex = [&](int i) {
+    if (indices[i] == std::numeric_limits<size_t>::max()) indices[i] = outps.add_vertex(verts[i].cast<double>());
+    outps.append_index(indices[i]);
+  };
+
   for (const auto& faces : polygons) {
     if (faces[0].size() == 3) {
       // trivial case - triangles cannot be concave or have holes
       outps.append_poly(3);
-      outps.append_vertex(verts[faces[0][0]]);
-      outps.append_vertex(verts[faces[0][1]]);
-      outps.append_vertex(verts[faces[0][2]]);
+      append_vertex(faces[0][0]);
+      append_vertex(faces[0][1]);
+      append_vertex(faces[0][2]);
     }
     // Quads seem trivial, but can be concave, and can have degenerate cases.
     // So everything more complex than triangles goes into the general case.
@@ -108,9 +116,9 @@ void tessellate_faces(const PolySet& inps, PolySet& outps)
       if (!err) {
         for (const auto& t : triangles) {
           outps.append_poly(3);
-          outps.append_vertex(verts[t[0]]);
-          outps.append_vertex(verts[t[1]]);
-          outps.append_vertex(verts[t[2]]);
+          append_vertex(t[0]);
+          append_vertex(t[1]);
+          append_vertex(t[2]);
         }
       }
     }
@@ -121,6 +129,42 @@ void tessellate_faces(const PolySet& inps, PolySet& outps)
   }
 }
 
+/*!
+   Calls callback with the triangles tessellate_faces() would produce, with
+   vertices rounded to float precision the same way, but one polygon at a time.
+   Lets exporters stream large meshes without building a tessellated copy.
+ */
+void foreach_tessellated_triangle(const PolySet& ps, const std::function<void(const std::array<Vector3d, 3>&)>& callback)
+{
+  int degeneratePolygons = 0;
+  Polygon polygon;
+  Polygons triangles;
+  for (const auto& pgon : ps.polygons) {
+    if (pgon.size() < 3) {
+      degeneratePolygons++;
+    } else if (pgon.size() == 3) {
+      const Vector3f v0 = pgon[0].cast<float>();
+      const Vector3f v1 = pgon[1].cast<float>();
+      const Vector3f v2 = pgon[2].cast<float>();
+      // Cull empty triangles
+      if (v0 != v1 && v1 != v2 && v2 != v0) {
+        callback({v0.cast<double>(), v1.cast<double>(), v2.cast<double>()});
+      }
+    } else {
+      polygon.assign(pgon.begin(), pgon.end());
+      triangles.clear();
+      GeometryUtils::tessellatePolygon(polygon, triangles);
+      for (const auto& t : triangles) {
+        callback({t[0], t[1], t[2]});
+      }
+    }
+  }
+
+  if (degeneratePolygons > 0) {
+    LOG(message_group::Warning, "PolySet has degenerate polygons");
+  }
+}
+
 bool is_approximately_convex(const PolySet& ps) {
 #ifdef ENABLE_CGAL
   return CGALUtils::is_approximately_convex(ps);
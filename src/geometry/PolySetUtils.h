@@ -1,5 +1,10 @@
 #pragma once
 
+#include "linalg.h"
+
+#include <array>
+#include <functional>
+
 class Polygon2d;
 class PolySet;
 
@@ -7,6 +12,7 @@ namespace PolySetUtils {
 
 Polygon2d *project(const PolySet& ps);
 void tessellate_faces(const PolySet& inps, PolySet& outps);
+void foreach_tessellated_triangle(const PolySet& ps, const std::function<void(const std::array<Vector3d, 3>&)>& callback);
 bool is_approximately_convex(const PolySet& ps);
 
 }
@@ -9,13 +9,35 @@ CGALCache::CGALCache(size_t limit) : cache(limit)
 {
 }
 
+bool CGALCache::contains(const std::string& id) const
+{
+  return this->cache.contains(id);
+}
+
 shared_ptr<const Geometry> CGALCache::get(const std::string& id) const
 {
-  const auto& N = this->cache[id]->N;
+  shared_ptr<const Geometry> N;
+  lookup(id, N);
+  return N;
+}
+
+bool CGALCache::lookup(const std::string& id, shared_ptr<const Geometry>& N) const
+{
+  const auto entry = this->cache.get(id);
+  if (!entry) return false;
+  N = entry->N;
 #ifdef DEBUG
   LOG("CGAL Cache hit: %1$s (%2$d bytes)", id.substr(0, 40), N ? N->memsize() : 0);
 #endif
-  return N;
+  return true;
+}
+
+bool CGALCache::peek(const std::string& id, shared_ptr<const Geometry>& N) const
+{
+  const auto entry = this->cache.peek(id);
+  if (!entry) return false;
+  N = entry->N;
+  return true;
 }
 
 bool CGALCache::acceptsGeometry(const shared_ptr<const Geometry>& geom) {
@@ -27,7 +49,7 @@ bool CGALCache::acceptsGeometry(const shared_ptr<const Geometry>& geom) {
 bool CGALCache::insert(const std::string& id, const shared_ptr<const Geometry>& N)
 {
   assert(acceptsGeometry(N));
-  auto inserted = this->cache.insert(id, new cache_entry(N), N ? N->memsize() : 0);
+  auto inserted = this->cache.insert(id, std::make_shared<const cache_entry>(N), N ? N->memsize() : 0);
 #ifdef DEBUG
   if (inserted) LOG("CGAL Cache insert: %1$s (%2$d bytes)", id.substr(0, 40), (N ? N->memsize() : 0));
   else LOG("CGAL Cache insert failed: %1$s (%2$d bytes)", id.substr(0, 40), (N ? N->memsize() : 0));
@@ -64,6 +86,7 @@ void CGALCache::print()
 {
   LOG("CGAL Polyhedrons in cache: %1$d", this->cache.size());
   LOG("CGAL cache size in bytes: %1$d", this->cache.totalCost());
+  LOG("CGAL cache hits: %1$d, misses: %2$d, evictions: %3$d", this->cache.hits(), this->cache.misses(), this->cache.evictions());
 }
 
 CGALCache::cache_entry::cache_entry(const shared_ptr<const Geometry>& N)
@@ -15,14 +15,21 @@ public:
   static CGALCache *instance() { if (!inst) inst = new CGALCache; return inst; }
   static bool acceptsGeometry(const shared_ptr<const Geometry>& geom);
 
-  bool contains(const std::string& id) const { return this->cache.contains(id); }
+  bool contains(const std::string& id) const;
   shared_ptr<const Geometry> get(const std::string& id) const;
+  // Checks for id and gets its geometry in one step, so a concurrent eviction cannot come in between
+  bool lookup(const std::string& id, shared_ptr<const Geometry>& N) const;
+  // Like lookup(), but does not count a hit or miss
+  bool peek(const std::string& id, shared_ptr<const Geometry>& N) const;
   bool insert(const std::string& id, const shared_ptr<const Geometry>& N);
   size_t size() const;
   size_t totalCost() const;
   size_t maxSizeMB() const;
   void setMaxSizeMB(size_t limit);
   void clear();
+  size_t hits() const { return cache.hits(); }
+  size_t misses() const { return cache.misses(); }
+  size_t evictions() const { return cache.evictions(); }
   void print();
 
 private:
@@ -34,5 +41,6 @@ private:
     cache_entry(const shared_ptr<const Geometry>& N);
   };
 
-  Cache<std::string, cache_entry> cache;
+  // get() updates the LRU order
+  mutable Cache<std::string, const cache_entry> cache;
 };
@@ -9,6 +9,7 @@
 #include "printutils.h"
 #include "CGALHybridPolyhedron.h"
 #include "node.h"
+#include "parallel.h"
 
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 #include <CGAL/normal_vector_newell_3.h>
@@ -30,15 +31,89 @@ namespace CGALUtils {
 
 /*!
    children cannot contain nullptr objects
+
+   Operands are decomposed into convex parts (cached per geometry by
+   getConvexParts()), the parts are summed pairwise by hulling in parallel, and
+   the hulls are combined by applyUnion3D().
  */
 shared_ptr<const Geometry> applyMinkowskiHybrid(const Geometry::Geometries& children)
 {
   // TODO: use Surface_mesh everywhere!!!
-  using Hull_kernel = CGAL::Epick;
   using Hybrid_Polyhedron = CGAL::Polyhedron_3<CGAL_HybridKernel3>;
-  using Hull_Polyhedron = CGAL::Polyhedron_3<Hull_kernel>;
   using Hybrid_Nef = CGAL::Nef_polyhedron_3<CGAL_HybridKernel3>;
 
+  CGAL::Cartesian_converter<CGAL_HybridKernel3, K> conv;
+  auto getHullPoints = [&](const Hybrid_Polyhedron& poly) {
+      MinkowskiPoints points;
+      points.reserve(poly.size_of_vertices());
+      for (auto pi = poly.vertices_begin(); pi != poly.vertices_end(); ++pi) {
+        points.push_back(conv(pi->point()));
+      }
+      return points;
+    };
+
+  auto decompose = [&](const shared_ptr<const Geometry>& operand) {
+      CGAL::Timer t;
+      MinkowskiParts parts;
+      auto poly = make_shared<Hybrid_Polyhedron>();
+
+      auto ps = dynamic_pointer_cast<const PolySet>(operand);
+      auto hybrid = CGALUtils::getHybridPolyhedronFromGeometry(operand);
+      if (!hybrid) throw 0;
+
+      if (ps) CGALUtils::createPolyhedronFromPolySet(*ps, *poly);
+      else if (auto nef = hybrid->getNefPolyhedron()) {
+        if (nef->is_simple()) CGALUtils::convertNefToPolyhedron(*nef, *poly);
+        else throw 0;
+      } else if (auto mesh = hybrid->getMesh()) {
+        if (CGAL::is_valid_polygon_mesh(*mesh)) CGAL::copy_face_graph(*mesh, *poly);
+        else throw 0;
+      } else throw 0;
+
+      if ((ps && ps->is_convex()) ||
+          (!ps && CGALUtils::is_weakly_convex(*poly))) {
+        PRINTDB("Minkowski: child is convex and %s", (ps?"PolySet":"Hybrid"));
+        parts.push_back(getHullPoints(*poly));
+      } else {
+        PRINTDB("Minkowski: child is nonconvex, decomposing...");
+        shared_ptr<Hybrid_Nef> decomposed_nef;
+
+        if (auto mesh = hybrid->getMesh()) {
+          decomposed_nef = make_shared<Hybrid_Nef>(*mesh);
+        } else if (auto nef = hybrid->getNefPolyhedron()) {
+          decomposed_nef = make_shared<Hybrid_Nef>(*nef);
+        }
+
+        t.start();
+        CGAL::convex_decomposition_3(*decomposed_nef);
+
+        // the first volume is the outer volume, which ignored in the decomposition
+        Hybrid_Nef::Volume_const_iterator ci = ++decomposed_nef->volumes_begin();
+        for (; ci != decomposed_nef->volumes_end(); ++ci) {
+          if (ci->mark()) {
+            Hybrid_Polyhedron part;
+            decomposed_nef->convert_inner_shell_to_polyhedron(ci->shells_begin(), part);
+            parts.push_back(getHullPoints(part));
+          }
+        }
+
+        PRINTDB("Minkowski: decomposed into %d convex parts", parts.size());
+        t.stop();
+        PRINTDB("Minkowski: decomposition took %f s", t.time());
+      }
+      return parts;
+    };
+
+  // Hulls of the pairwise sums, as they are independent these are computed in parallel
+  auto combineParts = [](const MinkowskiPoints& points0, const MinkowskiPoints& points1) -> shared_ptr<const Geometry> {
+      MinkowskiMesh hull;
+      if (!hullMinkowskiParts(points0, points1, hull)) return nullptr;
+      auto mesh = make_shared<CGAL_HybridMesh>();
+      CGAL::copy_face_graph(hull, *mesh);
+      CGALUtils::triangulateFaces(*mesh);
+      return make_shared<CGALHybridPolyhedron>(mesh);
+    };
+
   CGAL::Timer t, t_tot;
   assert(children.size() >= 2);
   auto it = children.begin();
@@ -48,171 +123,26 @@ shared_ptr<const Geometry> applyMinkowskiHybrid(const Geometry::Geometries& chil
     while (++it != children.end()) {
       operands[1] = it->second;
 
-      std::list<shared_ptr<Hybrid_Polyhedron>> P[2];
-      std::list<shared_ptr<Hull_Polyhedron>> result_parts;
-
+      shared_ptr<const MinkowskiParts> parts[2];
       for (size_t i = 0; i < 2; ++i) {
-        auto poly = make_shared<Hybrid_Polyhedron>();
-
-        auto ps = dynamic_pointer_cast<const PolySet>(operands[i]);
-        auto hybrid = CGALUtils::getHybridPolyhedronFromGeometry(operands[i]);
-        if (!hybrid) throw 0;
-
-        if (ps) CGALUtils::createPolyhedronFromPolySet(*ps, *poly);
-        else if (auto nef = hybrid->getNefPolyhedron()) {
-          if (nef->is_simple()) CGALUtils::convertNefToPolyhedron(*nef, *poly);
-          else throw 0;
-        } else if (auto mesh = hybrid->getMesh()) {
-          if (CGAL::is_valid_polygon_mesh(*mesh)) CGAL::copy_face_graph(*mesh, *poly);
-          else throw 0;
-        } else throw 0;
-
-        if ((ps && ps->is_convex()) ||
-            (!ps && CGALUtils::is_weakly_convex(*poly))) {
-          PRINTDB("Minkowski: child %d is convex and %s", i % (ps?"PolySet":"Hybrid"));
-          P[i].push_back(poly);
-        } else {
-          PRINTDB("Minkowski: child %d is nonconvex, decomposing...", i);
-          shared_ptr<Hybrid_Nef> decomposed_nef;
-
-          if (auto mesh = hybrid->getMesh()) {
-            decomposed_nef = make_shared<Hybrid_Nef>(*mesh);
-          } else if (auto nef = hybrid->getNefPolyhedron()) {
-            decomposed_nef = make_shared<Hybrid_Nef>(*nef);
-          }
-
-          t.start();
-          CGAL::convex_decomposition_3(*decomposed_nef);
-
-          // the first volume is the outer volume, which ignored in the decomposition
-          Hybrid_Nef::Volume_const_iterator ci = ++decomposed_nef->volumes_begin();
-          for (; ci != decomposed_nef->volumes_end(); ++ci) {
-            if (ci->mark()) {
-              auto poly = make_shared<Hybrid_Polyhedron>();
-              decomposed_nef->convert_inner_shell_to_polyhedron(ci->shells_begin(), *poly);
-              P[i].push_back(poly);
-            }
-          }
-
-          PRINTDB("Minkowski: decomposed into %d convex parts", P[i].size());
-          t.stop();
-          PRINTDB("Minkowski: decomposition took %f s", t.time());
-        }
+        parts[i] = getConvexParts(operands[i], [&]() { return decompose(operands[i]); });
       }
 
-      std::vector<Hull_kernel::Point_3> points[2];
-      std::vector<Hull_kernel::Point_3> minkowski_points;
-
-      CGAL::Cartesian_converter<CGAL_HybridKernel3, Hull_kernel> conv;
-
-      for (size_t i = 0; i < P[0].size(); ++i) {
-        for (size_t j = 0; j < P[1].size(); ++j) {
-          t.start();
-          points[0].clear();
-          points[1].clear();
-
-          for (int k = 0; k < 2; ++k) {
-            auto it = P[k].begin();
-            std::advance(it, k == 0?i:j);
-
-            auto& poly = *it;
-            points[k].reserve(poly->size_of_vertices());
-
-            for (auto pi = poly->vertices_begin(); pi != poly->vertices_end(); ++pi) {
-              Hybrid_Polyhedron::Point_3 const& p = pi->point();
-              points[k].push_back(conv(p));
-            }
-          }
-
-          minkowski_points.clear();
-          minkowski_points.reserve(points[0].size() * points[1].size());
-          for (size_t i = 0; i < points[0].size(); ++i) {
-            for (size_t j = 0; j < points[1].size(); ++j) {
-              minkowski_points.push_back(points[0][i] + (points[1][j] - CGAL::ORIGIN));
-            }
-          }
-
-          if (minkowski_points.size() <= 3) {
-            t.stop();
-            continue;
-          }
-
-          auto result = make_shared<Hull_Polyhedron>();
-          t.stop();
-          PRINTDB("Minkowski: Point cloud creation (%d ⨉ %d -> %d) took %f ms", points[0].size() % points[1].size() % minkowski_points.size() % (t.time() * 1000));
-          t.reset();
-
-          t.start();
-
-          CGAL::convex_hull_3(minkowski_points.begin(), minkowski_points.end(), *result);
-
-          std::vector<Hull_kernel::Point_3> strict_points;
-          strict_points.reserve(minkowski_points.size());
-
-          for (auto i = result->vertices_begin(); i != result->vertices_end(); ++i) {
-            auto& p = i->point();
-
-            auto h = i->halfedge();
-            auto e = h;
-            bool collinear = false;
-            bool coplanar = true;
-
-            do {
-              auto& q = h->opposite()->vertex()->point();
-              if (coplanar && !CGAL::coplanar(p, q,
-                                              h->next_on_vertex()->opposite()->vertex()->point(),
-                                              h->next_on_vertex()->next_on_vertex()->opposite()->vertex()->point())) {
-                coplanar = false;
-              }
-
-
-              for (auto j = h->next_on_vertex();
-                   j != h && !collinear && !coplanar;
-                   j = j->next_on_vertex()) {
-
-                auto& r = j->opposite()->vertex()->point();
-                if (CGAL::collinear(p, q, r)) {
-                  collinear = true;
-                }
-              }
-
-              h = h->next_on_vertex();
-            } while (h != e && !collinear);
-
-            if (!collinear && !coplanar) strict_points.push_back(p);
-          }
-
-          result->clear();
-          CGAL::convex_hull_3(strict_points.begin(), strict_points.end(), *result);
-
-
-          t.stop();
-          PRINTDB("Minkowski: Computing convex hull took %f s", t.time());
-          t.reset();
-
-          result_parts.push_back(result);
-        }
-      }
+      std::vector<shared_ptr<const Geometry>> result_parts(parts[0]->size() * parts[1]->size());
+      parallelizable_cross_product_transform(*parts[0], *parts[1], result_parts.begin(), combineParts);
 
       if (it != std::next(children.begin())) operands[0].reset();
 
-      auto partToGeom = [&](auto& poly) -> shared_ptr<const Geometry> {
-          auto mesh = make_shared<CGAL_HybridMesh>();
-          CGAL::copy_face_graph(*poly, *mesh);
-          CGALUtils::triangulateFaces(*mesh);
-          return make_shared<CGALHybridPolyhedron>(mesh);
-        };
+      Geometry::Geometries fake_children;
+      for (const auto& part : result_parts) {
+        if (part) fake_children.push_back(std::make_pair(std::shared_ptr<const AbstractNode>(), part));
+      }
 
-      if (result_parts.size() == 1) {
-        operands[0] = partToGeom(*result_parts.begin());
-      } else if (!result_parts.empty()) {
+      if (fake_children.size() == 1) {
+        operands[0] = fake_children.front().second;
+      } else if (!fake_children.empty()) {
         t.start();
-        PRINTDB("Minkowski: Computing union of %d parts", result_parts.size());
-        Geometry::Geometries fake_children;
-        for (const auto& part : result_parts) {
-          fake_children.push_back(std::make_pair(std::shared_ptr<const AbstractNode>(),
-                                                 partToGeom(part)));
-        }
+        PRINTDB("Minkowski: Computing union of %d parts", fake_children.size());
         auto N = CGALUtils::applyUnion3D(fake_children.begin(), fake_children.end());
         // FIXME: This should really never throw.
         // Assert once we figured out what went wrong with issue #1069?
@@ -234,6 +164,12 @@ shared_ptr<const Geometry> applyMinkowskiHybrid(const Geometry::Geometries& chil
     LOG(message_group::Warning,
         "[fast-csg] Minkowski failed with error, falling back to Nef operation: %1$s\n", e.what());
 
+    auto N = shared_ptr<const Geometry>(applyOperator3D(children, OpenSCADOperator::MINKOWSKI));
+    return N;
+  } catch (...) {
+    LOG(message_group::Warning,
+        "[fast-csg] Minkowski failed, falling back to Nef operation.");
+
     auto N = shared_ptr<const Geometry>(applyOperator3D(children, OpenSCADOperator::MINKOWSKI));
     return N;
   }
@@ -4,7 +4,12 @@
 #ifdef ENABLE_CGAL
 
 #include "cgalutils.h"
+#include "cgalutils-union-queue.h"
 #include "CGALHybridPolyhedron.h"
+#include "PolySet.h"
+#if ENABLE_MANIFOLD
+#include "ManifoldGeometry.h"
+#endif
 #include "node.h"
 #include "progress.h"
 
@@ -37,6 +42,10 @@ shared_ptr<CGALHybridPolyhedron> applyUnion3DHybrid(
     // We'll fill the queue in one go to get linear time construction.
     std::vector<QueueItem> queueItems;
     queueItems.reserve(children.size());
+    // Only meshes built from doubles, i.e. from PolySets and manifolds, share no lazy
+    // exact numbers with cached geometry, so only those are unioned in parallel.
+    // Copies of hybrid and Nef polyhedra share the lazy representations of their points.
+    bool fromDoubles = true;
 
     for (auto& item : children) {
       auto chgeom = item.second;
@@ -47,6 +56,11 @@ shared_ptr<CGALHybridPolyhedron> applyUnion3DHybrid(
       if (!poly) {
         continue;
       }
+      fromDoubles = fromDoubles && (dynamic_pointer_cast<const PolySet>(chgeom)
+#if ENABLE_MANIFOLD
+                                    || dynamic_pointer_cast<const ManifoldGeometry>(chgeom)
+#endif
+                                    );
 
       auto node_mark = item.first ? item.first->progress_mark : -1;
       queueItems.emplace_back(poly, node_mark);
@@ -55,18 +69,12 @@ shared_ptr<CGALHybridPolyhedron> applyUnion3DHybrid(
     std::priority_queue<QueueItem, std::vector<QueueItem>, QueueItemGreater>
     q(queueItems.begin(), queueItems.end());
 
-    progress_tick();
-    while (q.size() > 1) {
-      auto p1 = q.top();
-      q.pop();
-      auto p2 = q.top();
-      q.pop();
+    reduceSmallestPairs(q, [](const QueueItem& p1, const QueueItem& p2) {
       assert(p1.first->numFacets() <= p2.first->numFacets());
       // Modify in-place the biggest polyhedron.
       *p2.first += *p1.first;
-      q.emplace(p2.first, -1);
-      progress_tick();
-    }
+      return p2.first;
+    }, fromDoubles);
 
     if (q.size() == 1) {
       return q.top().first;
@@ -5,6 +5,7 @@
 
 #include "cgal.h"
 #include "cgalutils.h"
+#include "cgalutils-union-queue.h"
 #include "Feature.h"
 #include "PolySet.h"
 #include "printutils.h"
@@ -139,15 +140,10 @@ shared_ptr<const Geometry> applyUnion3D(
       }
     }
 
-    progress_tick();
-    while (q.size() > 1) {
-      auto p1 = q.top();
-      q.pop();
-      auto p2 = q.top();
-      q.pop();
-      q.emplace(make_shared<const CGAL_Nef_polyhedron>(*p1.first + *p2.first), -1);
-      progress_tick();
-    }
+    // Children may share their Nef representation, so the unions stay serial
+    reduceSmallestPairs(q, [](const QueueConstItem& p1, const QueueConstItem& p2) {
+      return make_shared<const CGAL_Nef_polyhedron>(*p1.first + *p2.first);
+    }, false);
 
     if (q.size() == 1) {
       return shared_ptr<const Geometry>(new CGAL_Nef_polyhedron(q.top().first->p3));
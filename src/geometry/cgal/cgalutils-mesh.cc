@@ -6,6 +6,9 @@
 #include <CGAL/boost/graph/convert_nef_polyhedron_to_polygon_mesh.h>
 #include <CGAL/boost/graph/graph_traits_Surface_mesh.h>
 #include <CGAL/Surface_mesh.h>
+
+#include <limits>
+
 namespace CGALUtils {
 
 template <class TriangleMesh>
@@ -15,7 +18,7 @@ bool createMeshFromPolySet(const PolySet& ps, TriangleMesh& mesh)
   using vertex_descriptor = typename GT::vertex_descriptor;
 
   bool err = false;
-  auto num_vertices = ps.numFacets() * 3;
+  auto num_vertices = ps.polygons.getVertices().size();
   auto num_facets = ps.numFacets();
   auto num_edges = num_vertices + num_facets + 2; // Euler's formula.
   mesh.reserve(mesh.number_of_vertices() + num_vertices, mesh.number_of_halfedges() + num_edges,
@@ -23,17 +26,25 @@ bool createMeshFromPolySet(const PolySet& ps, TriangleMesh& mesh)
 
   std::vector<vertex_descriptor> polygon;
 
+  // PolySets may hold equal vertices at different indices, so each index is only
+  // resolved by position once
+  std::vector<vertex_descriptor> vertices(num_vertices, GT::null_vertex());
   std::unordered_map<Vector3d, vertex_descriptor> indices;
 
   for (const auto& p : ps.polygons) {
     polygon.clear();
-    for (auto& v : p) {
-      auto size_before = indices.size();
-      auto& index = indices[v];
-      if (size_before != indices.size()) {
-        index = mesh.add_vertex(vector_convert<typename TriangleMesh::Point>(v));
+    for (size_t i = 0; i < p.size(); ++i) {
+      auto& vertex = vertices[p.index(i)];
+      if (vertex == GT::null_vertex()) {
+        const auto& v = p[i];
+        auto size_before = indices.size();
+        auto& index = indices[v];
+        if (size_before != indices.size()) {
+          index = mesh.add_vertex(vector_convert<typename TriangleMesh::Point>(v));
+        }
+        vertex = index;
       }
-      polygon.push_back(index);
+      polygon.push_back(vertex);
     }
     mesh.add_face(polygon);
   }
@@ -48,18 +59,24 @@ bool createPolySetFromMesh(const TriangleMesh& mesh, PolySet& ps)
 {
   bool err = false;
   ps.reserve(ps.numFacets() + mesh.number_of_faces());
+  ps.reserve_vertices(mesh.number_of_vertices());
+  // PolySet vertex index of each mesh vertex, added when first used
+  std::vector<size_t> indices(mesh.num_vertices(), std::numeric_limits<size_t>::max());
   for (auto& f : mesh.faces()) {
     ps.append_poly(mesh.degree(f));
 
     CGAL::Vertex_around_face_iterator<TriangleMesh> vbegin, vend;
     for (boost::tie(vbegin, vend) = vertices_around_face(mesh.halfedge(f), mesh); vbegin != vend;
          ++vbegin) {
-      auto& v = mesh.point(*vbegin);
-      // for (auto &v : f) {
-      double x = CGAL::to_double(v.x());
-      double y = CGAL::to_double(v.y());
-      double z = CGAL::to_double(v.z());
-      ps.append_vertex(x, y, z);
+      auto& index = indices[(*vbegin).idx()];
+      if (index == std::numeric_limits<size_t>::max()) {
+        auto& v = mesh.point(*vbegin);
+        double x = CGAL::to_double(v.x());
+        double y = CGAL::to_double(v.y());
+        double z = CGAL::to_double(v.z());
+        index = ps.add_vertex(Vector3d(x, y, z));
+      }
+      ps.append_index(index);
     }
   }
   return err;
@@ -0,0 +1,134 @@
+// this file is split into many separate cgalutils* files
+// in order to workaround gcc 4.9.1 crashing on systems with only 2GB of RAM
+
+#ifdef ENABLE_CGAL
+
+#include "cgalutils.h"
+#include "printutils.h"
+
+#include <CGAL/convex_hull_3.h>
+
+#include <mutex>
+#include <unordered_map>
+
+namespace CGALUtils {
+
+namespace {
+
+struct ConvexPartsEntry {
+  std::weak_ptr<const Geometry> geometry;
+  shared_ptr<const MinkowskiParts> parts;
+};
+
+std::mutex convex_parts_mutex;
+std::unordered_map<const Geometry *, ConvexPartsEntry> convex_parts_cache;
+
+} // namespace
+
+/*!
+   Returns the convex parts of geom computed by decompose(), reusing the parts
+   computed for the same Geometry object before. Children of minkowski() come
+   from the GeometryCache, so repeated minkowski() with the same tool shape
+   (e.g. rounding edges with one sphere) decomposes it only once.
+
+   Entries only hold weak references to their geometries, and are dropped once
+   the geometry has been freed.
+ */
+shared_ptr<const MinkowskiParts> getConvexParts(const shared_ptr<const Geometry>& geom,
+                                                const std::function<MinkowskiParts()>& decompose)
+{
+  {
+    std::lock_guard<std::mutex> lock(convex_parts_mutex);
+    auto entry = convex_parts_cache.find(geom.get());
+    if (entry != convex_parts_cache.end() && entry->second.geometry.lock() == geom) {
+      PRINTDB("Minkowski: reusing %d convex parts", entry->second.parts->size());
+      return entry->second.parts;
+    }
+  }
+
+  // Decompose without holding the lock, other minkowski operations may run concurrently
+  auto parts = make_shared<const MinkowskiParts>(decompose());
+
+  std::lock_guard<std::mutex> lock(convex_parts_mutex);
+  for (auto it = convex_parts_cache.begin(); it != convex_parts_cache.end();) {
+    if (it->second.geometry.expired()) it = convex_parts_cache.erase(it);
+    else ++it;
+  }
+  convex_parts_cache[geom.get()] = {geom, parts};
+  return parts;
+}
+
+/*!
+   Computes the convex hull of the Minkowski sum of two convex parts, given as
+   their vertices. Vertices of the first hull which are not strictly convex
+   (collinear with or coplanar to their neighbours) are removed by hulling a
+   second time. Returns false if the sum has too few points for a volume.
+ */
+bool hullMinkowskiParts(const MinkowskiPoints& points0, const MinkowskiPoints& points1, MinkowskiMesh& mesh)
+{
+  using Point = MinkowskiPoints::value_type;
+
+  CGAL::Timer t;
+  t.start();
+  std::vector<Point> minkowski_points;
+  minkowski_points.reserve(points0.size() * points1.size());
+  for (const auto& p0 : points0) {
+    for (const auto& p1 : points1) {
+      minkowski_points.push_back(p0 + (p1 - CGAL::ORIGIN));
+    }
+  }
+  if (minkowski_points.size() <= 3) return false;
+  t.stop();
+  PRINTDB("Minkowski: Point cloud creation (%d ⨉ %d -> %d) took %f ms", points0.size() % points1.size() % minkowski_points.size() % (t.time() * 1000));
+  t.reset();
+
+  t.start();
+  mesh.clear();
+  CGAL::convex_hull_3(minkowski_points.begin(), minkowski_points.end(), mesh);
+
+  std::vector<Point> strict_points;
+  strict_points.reserve(minkowski_points.size());
+
+  for (auto v : mesh.vertices()) {
+    auto& p = mesh.point(v);
+
+    auto h = mesh.halfedge(v);
+    auto e = h;
+    bool collinear = false;
+    bool coplanar = true;
+
+    do {
+      auto& q = mesh.point(mesh.target(mesh.opposite(h)));
+      if (coplanar && !CGAL::coplanar(p, q,
+                                      mesh.point(mesh.target(mesh.next(h))),
+                                      mesh.point(mesh.target(mesh.next(mesh.opposite(mesh.next(h))))))) {
+        coplanar = false;
+      }
+
+      for (auto j = mesh.opposite(mesh.next(h));
+           j != h && !collinear && !coplanar;
+           j = mesh.opposite(mesh.next(j))) {
+
+        auto& r = mesh.point(mesh.target(mesh.opposite(j)));
+        if (CGAL::collinear(p, q, r)) {
+          collinear = true;
+        }
+      }
+
+      h = mesh.opposite(mesh.next(h));
+    } while (h != e && !collinear);
+
+    if (!collinear && !coplanar) strict_points.push_back(p);
+  }
+
+  mesh.clear();
+  CGAL::convex_hull_3(strict_points.begin(), strict_points.end(), mesh);
+
+  t.stop();
+  PRINTDB("Minkowski: Computing convex hull took %f s", t.time());
+  return true;
+}
+
+}  // namespace CGALUtils
+
+#endif // ENABLE_CGAL
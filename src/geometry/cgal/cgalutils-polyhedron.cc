@@ -8,6 +8,7 @@
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 
 #include <boost/range/adaptor/reversed.hpp>
+#include <unordered_map>
 
 #undef GEN_SURFACE_DEBUG
 namespace /* anonymous */ {
@@ -285,17 +286,25 @@ bool createPolySetFromPolyhedron(const Polyhedron& p, PolySet& ps)
   using HFCC = typename Polyhedron::Halfedge_around_facet_const_circulator;
 
   ps.reserve(p.size_of_facets());
+  ps.reserve_vertices(p.size_of_vertices());
 
+  // PolySet vertex index of each polyhedron vertex, added when first used
+  std::unordered_map<const Vertex *, size_t> indices;
+  indices.reserve(p.size_of_vertices());
   for (FCI fi = p.facets_begin(); fi != p.facets_end(); ++fi) {
     HFCC hc = fi->facet_begin();
     HFCC hc_end = hc;
     ps.append_poly(fi->facet_degree());
     do {
       Vertex const& v = *((hc++)->vertex());
-      double x = CGAL::to_double(v.point().x());
-      double y = CGAL::to_double(v.point().y());
-      double z = CGAL::to_double(v.point().z());
-      ps.append_vertex(x, y, z);
+      auto [it, inserted] = indices.emplace(&v, 0);
+      if (inserted) {
+        double x = CGAL::to_double(v.point().x());
+        double y = CGAL::to_double(v.point().y());
+        double z = CGAL::to_double(v.point().z());
+        it->second = ps.add_vertex(Vector3d(x, y, z));
+      }
+      ps.append_index(it->second);
     } while (hc != hc_end);
   }
   return err;
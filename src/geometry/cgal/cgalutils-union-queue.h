@@ -0,0 +1,78 @@
+#pragma once
+
+#include "parallel.h"
+#include "progress.h"
+
+#include <algorithm>
+#include <exception>
+#include <numeric>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace CGALUtils {
+
+/*!
+   Reduces a priority queue of (polyhedron, progress mark) items, smallest
+   first, by replacing pairs of items with their union, until at most one item
+   is left.
+
+   Serially this replaces the two smallest items in each step. With parallel
+   set and parallel processing available, up to one pair per hardware thread
+   is taken from the front of the queue in each round, and the pairs are
+   unioned concurrently. Union being associative and commutative, the
+   resulting geometry does not depend on the pairing.
+
+   The pairs of a round have no items in common, but items may still share
+   data: identical children share one cached polyhedron, and copies of a
+   polyhedron share the lazy exact numbers of its points, which are updated
+   even when read. Callers must only set parallel if no two items share any
+   such data, e.g. if all of them were built from doubles.
+
+   unite(smaller, larger) returns the union of the two polyhedra of the items,
+   and may modify larger in place. Exceptions thrown by unite are rethrown
+   after the round.
+ */
+template <typename Queue, typename Union>
+void reduceSmallestPairs(Queue& q, const Union& unite, bool parallel)
+{
+  using Item = typename Queue::value_type;
+  const size_t max_pairs = parallel && is_parallelizable() ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+
+  std::vector<std::pair<Item, Item>> pairs;
+  std::vector<size_t> indices;
+  std::vector<decltype(unite(std::declval<Item&>(), std::declval<Item&>()))> results;
+  std::vector<std::exception_ptr> errors;
+
+  progress_tick();
+  while (q.size() > 1) {
+    pairs.clear();
+    while (q.size() > 1 && pairs.size() < max_pairs) {
+      auto smaller = q.top();
+      q.pop();
+      pairs.emplace_back(std::move(smaller), q.top());
+      q.pop();
+    }
+
+    indices.resize(pairs.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    results.assign(pairs.size(), {});
+    errors.assign(pairs.size(), nullptr);
+    parallelizable_transform(indices.begin(), indices.end(), results.begin(), [&](size_t i) {
+      try {
+        return unite(pairs[i].first, pairs[i].second);
+      } catch (...) {
+        errors[i] = std::current_exception();
+        return decltype(unite(pairs[i].first, pairs[i].second))();
+      }
+    });
+
+    for (size_t i = 0; i < pairs.size(); ++i) {
+      if (errors[i]) std::rethrow_exception(errors[i]);
+      q.emplace(std::move(results[i]), -1);
+      progress_tick();
+    }
+  }
+}
+
+} // namespace CGALUtils
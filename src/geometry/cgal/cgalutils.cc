@@ -25,10 +25,12 @@
 #include "Reindexer.h"
 #include "GeometryUtils.h"
 #include "CGALHybridPolyhedron.h"
+#include "InstancedGeometry.h"
 #ifdef ENABLE_MANIFOLD
 #include "ManifoldGeometry.h"
 #endif
 
+#include <limits>
 #include <map>
 #include <queue>
 
@@ -243,7 +245,9 @@ bool is_approximately_convex(const PolySet& ps) {
 
 shared_ptr<const CGAL_Nef_polyhedron> getNefPolyhedronFromGeometry(const shared_ptr<const Geometry>& geom)
 {
-  if (auto ps = dynamic_pointer_cast<const PolySet>(geom)) {
+  if (auto instanced = dynamic_pointer_cast<const InstancedGeometry>(geom)) {
+    return getNefPolyhedronFromGeometry(instanced->materialized());
+  } else if (auto ps = dynamic_pointer_cast<const PolySet>(geom)) {
     return shared_ptr<CGAL_Nef_polyhedron>(createNefPolyhedronFromPolySet(*ps));
   } else if (auto poly = dynamic_pointer_cast<const CGALHybridPolyhedron>(geom)) {
     return createNefPolyhedronFromHybrid(*poly);
@@ -384,11 +388,16 @@ bool createPolySetFromNefPolyhedron3(const CGAL::Nef_polyhedron_3<K>& N, PolySet
   }
 
   ps.reserve(allTriangles.size());
+  ps.reserve_vertices(verts.size());
+  // PolySet vertex index of each vertex, added when first used
+  std::vector<size_t> indices(verts.size(), std::numeric_limits<size_t>::max());
   for (const auto& t : allTriangles) {
     ps.append_poly(3);
-    ps.append_vertex(verts[t[0]]);
-    ps.append_vertex(verts[t[1]]);
-    ps.append_vertex(verts[t[2]]);
+    for (int i = 0; i < 3; ++i) {
+      auto& index = indices[t[i]];
+      if (index == std::numeric_limits<size_t>::max()) index = ps.add_vertex(verts[t[i]].cast<double>());
+      ps.append_index(index);
+    }
   }
 
 #if 0 // For debugging
@@ -490,6 +499,9 @@ template Transform3d computeResizeTransform(
 
 shared_ptr<const PolySet> getGeometryAsPolySet(const shared_ptr<const Geometry>& geom)
 {
+  if (auto instanced = dynamic_pointer_cast<const InstancedGeometry>(geom)) {
+    return getGeometryAsPolySet(instanced->materialized());
+  }
   if (auto ps = dynamic_pointer_cast<const PolySet>(geom)) {
     return ps;
   }
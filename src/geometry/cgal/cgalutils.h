@@ -7,6 +7,8 @@
 
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 
+#include <functional>
+
 using K = CGAL::Epick;
 using Vertex3K = CGAL::Point_3<K>;
 using PolygonK = std::vector<Vertex3K>;
@@ -53,6 +55,12 @@ CGAL_Iso_cuboid_3 createIsoCuboidFromBoundingBox(const BoundingBox& bbox);
 bool is_approximately_convex(const PolySet& ps);
 shared_ptr<const Geometry> applyMinkowski(const Geometry::Geometries& children);
 shared_ptr<const Geometry> applyMinkowskiHybrid(const Geometry::Geometries& children);
+using MinkowskiPoints = std::vector<K::Point_3>;
+using MinkowskiParts = std::vector<MinkowskiPoints>;
+using MinkowskiMesh = CGAL::Surface_mesh<K::Point_3>;
+shared_ptr<const MinkowskiParts> getConvexParts(const shared_ptr<const Geometry>& geom,
+                                                const std::function<MinkowskiParts()>& decompose);
+bool hullMinkowskiParts(const MinkowskiPoints& points0, const MinkowskiPoints& points1, MinkowskiMesh& mesh);
 
 template <typename Polyhedron> bool createPolySetFromPolyhedron(const Polyhedron& p, PolySet& ps);
 template <class InputKernel, class OutputKernel>
@@ -79,12 +79,15 @@ std::shared_ptr<const PolySet> ManifoldGeometry::toPolySet() const {
   auto ps = std::make_shared<PolySet>(3);
   manifold::Mesh mesh = getManifold().GetMesh();
   ps->reserve(mesh.triVerts.size());
-  Polygon poly(3);
+  ps->reserve_vertices(mesh.vertPos.size());
+  for (const auto &v : mesh.vertPos) {
+    ps->add_vertex(vector_convert<Vector3d>(v));
+  }
   for (const auto &tv : mesh.triVerts) {
+    ps->append_poly(3);
     for (const int j : {0, 1, 2}) {
-      poly[j] = vector_convert<Vector3d>(mesh.vertPos[tv[j]]);
+      ps->append_index(tv[j]);
     }
-    ps->append_poly(poly);
   }
   return ps;
 }
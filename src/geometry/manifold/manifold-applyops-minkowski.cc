@@ -19,7 +19,6 @@ namespace ManifoldUtils {
 shared_ptr<const Geometry> applyMinkowskiManifold(const Geometry::Geometries& children)
 {
   using Hull_kernel = CGAL::Epick;
-  using Hull_Mesh = CGAL::Surface_mesh<CGAL::Point_3<Hull_kernel>>;
   using Hull_Points = std::vector<Hull_kernel::Point_3>;
   using Nef_kernel = CGAL_Kernel3;
   using Polyhedron = CGAL_Polyhedron;
@@ -59,128 +58,65 @@ shared_ptr<const Geometry> applyMinkowskiManifold(const Geometry::Geometries& ch
     return std::move(out);
   };
 
+  // Convex parts of an operand as hull points, decomposing it if it is not convex
+  auto decompose = [&](const shared_ptr<const Geometry>& operand) {
+    CGALUtils::MinkowskiParts part_points;
+
+    bool is_convex;
+    auto poly = polyhedronFromGeometry(operand, &is_convex);
+    if (!poly) throw 0;
+    if (poly->empty()) {
+      throw 0;
+    }
+
+    if (is_convex) {
+      part_points.emplace_back(getHullPoints(*poly));
+    } else {
+      CGAL::Timer t;
+      Nef decomposed_nef(*poly);
+
+      t.start();
+      CGAL::convex_decomposition_3(decomposed_nef);
+
+      // the first volume is the outer volume, which ignored in the decomposition
+      Nef::Volume_const_iterator ci = ++decomposed_nef.volumes_begin();
+      for (; ci != decomposed_nef.volumes_end(); ++ci) {
+        if (ci->mark()) {
+          Polyhedron poly;
+          decomposed_nef.convert_inner_shell_to_polyhedron(ci->shells_begin(), poly);
+          part_points.emplace_back(getHullPoints(poly));
+        }
+      }
+
+      PRINTDB("Minkowski: decomposed into %d convex parts", part_points.size());
+      t.stop();
+      PRINTDB("Minkowski: decomposition took %f s", t.time());
+    }
+    return part_points;
+  };
+
   try {
     // Note: we could parallelize more, e.g. compute all decompositions ahead of time instead of doing them 2 by 2,
     // but this could use substantially more memory.
     while (++it != children.end()) {
       operands[1] = it->second;
 
-      std::vector<std::list<Hull_Points>> part_points(2);
+      std::vector<shared_ptr<const CGALUtils::MinkowskiParts>> part_points(2);
 
       parallelizable_transform(operands.begin(), operands.begin() + 2, part_points.begin(), [&](const auto &operand) {
-        std::list<Hull_Points> part_points;
-
-        bool is_convex;
-        auto poly = polyhedronFromGeometry(operand, &is_convex);
-        if (!poly) throw 0;
-        if (poly->empty()) {
-          throw 0;
-        }
-
-        if (is_convex) {
-          part_points.emplace_back(getHullPoints(*poly));
-        } else {
-          Nef decomposed_nef(*poly);
-
-          t.start();
-          CGAL::convex_decomposition_3(decomposed_nef);
-
-          // the first volume is the outer volume, which ignored in the decomposition
-          Nef::Volume_const_iterator ci = ++decomposed_nef.volumes_begin();
-          for (; ci != decomposed_nef.volumes_end(); ++ci) {
-            if (ci->mark()) {
-              Polyhedron poly;
-              decomposed_nef.convert_inner_shell_to_polyhedron(ci->shells_begin(), poly);
-              part_points.emplace_back(getHullPoints(poly));
-            }
-          }
-
-          PRINTDB("Minkowski: decomposed into %d convex parts", part_points.size());
-          t.stop();
-          PRINTDB("Minkowski: decomposition took %f s", t.time());
-        }
-        return std::move(part_points);
+        return CGALUtils::getConvexParts(operand, [&]() { return decompose(operand); });
       });
 
-      std::vector<Hull_kernel::Point_3> minkowski_points;
-      
       auto combineParts = [&](const Hull_Points &points0, const Hull_Points &points1) -> shared_ptr<const ManifoldGeometry> {
-        CGAL::Timer t;
-
-        t.start();
-        std::vector<Hull_kernel::Point_3> minkowski_points;
-
-        minkowski_points.reserve(points0.size() * points1.size());
-        for (size_t i = 0; i < points0.size(); ++i) {
-          for (size_t j = 0; j < points1.size(); ++j) {
-            minkowski_points.push_back(points0[i] + (points1[j] - CGAL::ORIGIN));
-          }
-        }
-
-        if (minkowski_points.size() <= 3) {
-          t.stop();
-          return make_shared<const ManifoldGeometry>();
-        }
-
-        t.stop();
-        PRINTDB("Minkowski: Point cloud creation (%d ⨉ %d -> %d) took %f ms", points0.size() % points1.size() % minkowski_points.size() % (t.time() * 1000));
-        t.reset();
-
-        t.start();
-
-        Hull_Mesh mesh;
-        CGAL::convex_hull_3(minkowski_points.begin(), minkowski_points.end(), mesh);
-
-        std::vector<Hull_kernel::Point_3> strict_points;
-        strict_points.reserve(minkowski_points.size());
-
-        for (auto v : mesh.vertices()) {
-          auto &p = mesh.point(v);
-
-          auto h = mesh.halfedge(v);
-          auto e = h;
-          bool collinear = false;
-          bool coplanar = true;
-
-          do {
-            auto &q = mesh.point(mesh.target(mesh.opposite(h)));
-            if (coplanar && !CGAL::coplanar(p, q,
-                                            mesh.point(mesh.target(mesh.next(h))),
-                                            mesh.point(mesh.target(mesh.next(mesh.opposite(mesh.next(h))))))) {
-              coplanar = false;
-            }
-
-
-            for (auto j = mesh.opposite(mesh.next(h));
-                  j != h && !collinear && !coplanar;
-                  j = mesh.opposite(mesh.next(j))) {
-
-              auto& r = mesh.point(mesh.target(mesh.opposite(j)));
-              if (CGAL::collinear(p, q, r)) {
-                collinear = true;
-              }
-            }
-
-            h = mesh.opposite(mesh.next(h));
-          } while (h != e && !collinear);
-
-          if (!collinear && !coplanar) strict_points.push_back(p);
-        }
-
-        mesh.clear();
-        CGAL::convex_hull_3(strict_points.begin(), strict_points.end(), mesh);
-
-        t.stop();
-        PRINTDB("Minkowski: Computing convex hull took %f s", t.time());
-        t.reset();
-
+        CGALUtils::MinkowskiMesh mesh;
+        if (!CGALUtils::hullMinkowskiParts(points0, points1, mesh)) return make_shared<const ManifoldGeometry>();
         CGALUtils::triangulateFaces(mesh);
         return ManifoldUtils::createMutableManifoldFromSurfaceMesh(mesh);
       };
 
-      std::vector<shared_ptr<const ManifoldGeometry>> result_parts(part_points[0].size() * part_points[1].size());
+      std::vector<shared_ptr<const ManifoldGeometry>> result_parts(part_points[0]->size() * part_points[1]->size());
       parallelizable_cross_product_transform(
-          part_points[0], part_points[1],
+          *part_points[0], *part_points[1],
           result_parts.begin(),
           combineParts);
 
@@ -5,11 +5,15 @@
 
 #include "manifoldutils.h"
 #include "ManifoldGeometry.h"
+#include "PolySet.h"
 #include "node.h"
 #include "progress.h"
 #include "printutils.h"
+#include "parallel.h"
 
-#include <queue>
+#include <algorithm>
+#include <numeric>
+#include <vector>
 
 namespace ManifoldUtils {
 
@@ -18,56 +22,172 @@ Location getLocation(const std::shared_ptr<const AbstractNode>& node)
   return node && node->modinst ? node->modinst->location() : Location::NONE;
 }
 
+namespace {
+
+using ManifoldGeometries = std::vector<shared_ptr<ManifoldGeometry>>;
+
 /*!
-   Applies op to all children and returns the result.
-   The child list should be guaranteed to contain non-NULL 3D or empty Geometry objects
+   Composes the given parts into a single manifold without any boolean operation.
+   Only valid if the parts are pairwise disjoint.
  */
-shared_ptr<const ManifoldGeometry> applyOperator3DManifold(const Geometry::Geometries& children, OpenSCADOperator op)
+shared_ptr<ManifoldGeometry> compose(const ManifoldGeometries& parts)
+{
+  if (parts.size() == 1) return parts.front();
+  std::vector<manifold::Manifold> manifolds;
+  manifolds.reserve(parts.size());
+  for (const auto& part : parts) manifolds.push_back(part->getManifold());
+  return make_shared<ManifoldGeometry>(make_shared<manifold::Manifold>(manifold::Manifold::Compose(manifolds)));
+}
+
+/*!
+   Partitions the parts into groups with pairwise disjoint bounding boxes, and
+   composes each group into one manifold. The union of the result equals the union
+   of the input, with fewer operands left for actual boolean operations.
+ */
+ManifoldGeometries composeDisjointGroups(const ManifoldGeometries& parts)
+{
+  std::vector<ManifoldGeometries> groups;
+  std::vector<std::vector<BoundingBox>> group_bboxes;
+  for (const auto& part : parts) {
+    const auto bbox = part->getBoundingBox();
+    size_t i = 0;
+    for (; i < groups.size(); ++i) {
+      const auto& bboxes = group_bboxes[i];
+      if (std::none_of(bboxes.begin(), bboxes.end(), [&](const BoundingBox& other) {
+        return bbox.intersects(other);
+      })) break;
+    }
+    if (i == groups.size()) {
+      groups.emplace_back();
+      group_bboxes.emplace_back();
+    }
+    groups[i].push_back(part);
+    group_bboxes[i].push_back(bbox);
+  }
+
+  ManifoldGeometries result(groups.size());
+  parallelizable_transform(groups.begin(), groups.end(), result.begin(), [](const ManifoldGeometries& group) {
+    return compose(group);
+  });
+  return result;
+}
+
+/*!
+   Reduces the parts with the given (associative) operation using a balanced tree of
+   pairwise operations, each level of which is evaluated in parallel. Compared to a
+   left fold, this keeps operands small and the number of levels logarithmic.
+ */
+shared_ptr<ManifoldGeometry> reduceBalanced(ManifoldGeometries parts, OpenSCADOperator op)
 {
-  auto N = make_shared<ManifoldGeometry>();
+  assert(!parts.empty());
+  while (parts.size() > 1) {
+    std::vector<size_t> pairs(parts.size() / 2);
+    std::iota(pairs.begin(), pairs.end(), 0);
+    ManifoldGeometries next((parts.size() + 1) / 2);
+    parallelizable_transform(pairs.begin(), pairs.end(), next.begin(), [&](size_t i) {
+      auto result = make_shared<ManifoldGeometry>(*parts[2 * i]);
+      if (op == OpenSCADOperator::UNION) *result += *parts[2 * i + 1];
+      else *result *= *parts[2 * i + 1];
+      return result;
+    });
+    if (parts.size() % 2) next.back() = parts.back();
+    parts = std::move(next);
+  }
+  return parts.front();
+}
 
-  bool foundFirst = false;
+shared_ptr<ManifoldGeometry> unionBalanced(const ManifoldGeometries& parts)
+{
+  return reduceBalanced(composeDisjointGroups(parts), OpenSCADOperator::UNION);
+}
 
+/*!
+   Applies the Nef-based minkowski operation to the children, one at a time.
+ */
+shared_ptr<ManifoldGeometry> foldMinkowski(const Geometry::Geometries& children)
+{
+  shared_ptr<ManifoldGeometry> N;
   for (const auto& item : children) {
     auto chN = item.second ? createMutableManifoldFromGeometry(item.second) : nullptr;
+    if (!chN || chN->isEmpty()) continue;
 
-    // Intersecting something with nothing results in nothing
-    if (!chN || chN->isEmpty()) {
-      if (op == OpenSCADOperator::INTERSECTION) {
-        N = nullptr;
-        break;
-      }
-      if (op == OpenSCADOperator::DIFFERENCE && !foundFirst) {
-        N = nullptr;
-        break;
-      }
+    // Initialize N with first expected geometric object
+    if (!N) {
+      N = chN;
       continue;
     }
+    N->minkowski(*chN);
+    if (item.first) item.first->progress_report();
+  }
+  return N ? N : make_shared<ManifoldGeometry>();
+}
 
-    // Initialize N with first expected geometric object
-    if (!foundFirst) {
-      N = chN;
-      foundFirst = true;
+} // namespace
+
+/*!
+   Applies op to all children and returns the result.
+   The child list should be guaranteed to contain non-NULL 3D or empty Geometry objects
+
+   Unions are computed by first composing children with disjoint bounding boxes,
+   then reducing the remaining operands pairwise in a balanced tree. Intersections
+   are reduced the same way, and differences subtract the union of all subtrahends.
+ */
+shared_ptr<const ManifoldGeometry> applyOperator3DManifold(const Geometry::Geometries& children, OpenSCADOperator op)
+{
+  if (op == OpenSCADOperator::MINKOWSKI) return foldMinkowski(children);
+  if (op != OpenSCADOperator::UNION && op != OpenSCADOperator::INTERSECTION && op != OpenSCADOperator::DIFFERENCE) {
+    LOG(message_group::Error, "Unsupported CGAL operator: %1$d", static_cast<int>(op));
+    return make_shared<ManifoldGeometry>();
+  }
+
+  const std::vector<Geometry::GeometryItem> items(children.begin(), children.end());
+  ManifoldGeometries manifolds(items.size());
+  const auto convert = [](const Geometry::GeometryItem& item) {
+    return item.second ? createMutableManifoldFromGeometry(item.second) : nullptr;
+  };
+  // Cached Nef and hybrid children may share lazy exact numbers, which are updated
+  // even when read, so only PolySets and manifolds are converted in parallel
+  const bool parallel = std::all_of(items.begin(), items.end(), [](const Geometry::GeometryItem& item) {
+    return !item.second || dynamic_pointer_cast<const PolySet>(item.second) ||
+           dynamic_pointer_cast<const ManifoldGeometry>(item.second);
+  });
+  if (parallel) parallelizable_transform(items.begin(), items.end(), manifolds.begin(), convert);
+  else std::transform(items.begin(), items.end(), manifolds.begin(), convert);
+
+  ManifoldGeometries operands;
+  for (size_t i = 0; i < manifolds.size(); ++i) {
+    const auto& chN = manifolds[i];
+    // Intersecting something with nothing results in nothing
+    if (!chN || chN->isEmpty()) {
+      if (op == OpenSCADOperator::INTERSECTION) return nullptr;
+      if (op == OpenSCADOperator::DIFFERENCE && i == 0) return nullptr;
       continue;
     }
+    operands.push_back(chN);
+  }
+  if (operands.empty()) return make_shared<ManifoldGeometry>();
 
-    switch (op) {
-    case OpenSCADOperator::UNION:
-      *N += *chN;
-      break;
-    case OpenSCADOperator::INTERSECTION:
-      *N *= *chN;
-      break;
-    case OpenSCADOperator::DIFFERENCE:
-      *N -= *chN;
-      break;
-    case OpenSCADOperator::MINKOWSKI:
-      N->minkowski(*chN);
-      break;
-    default:
-      LOG(message_group::Error, "Unsupported CGAL operator: %1$d", static_cast<int>(op));
+  shared_ptr<ManifoldGeometry> N;
+  switch (op) {
+  case OpenSCADOperator::UNION:
+    N = unionBalanced(operands);
+    break;
+  case OpenSCADOperator::INTERSECTION:
+    N = reduceBalanced(operands, op);
+    break;
+  case OpenSCADOperator::DIFFERENCE:
+    N = operands.front();
+    if (operands.size() > 1) {
+      operands.erase(operands.begin());
+      *N -= *unionBalanced(operands);
     }
-    if (item.first) item.first->progress_report();
+    break;
+  default:
+    break;
+  }
+
+  for (auto it = std::next(children.begin()); it != children.end(); ++it) {
+    if (it->first) it->first->progress_report();
   }
   return N;
 }
@@ -7,6 +7,7 @@
 #include "cgalutils.h"
 #include "PolySetUtils.h"
 #include "CGALHybridPolyhedron.h"
+#include "InstancedGeometry.h"
 #include <CGAL/convex_hull_3.h>
 #include <CGAL/Surface_mesh.h>
 
@@ -146,6 +147,9 @@ std::shared_ptr<ManifoldGeometry> createMutableManifoldFromPolySet(const PolySet
 }
 
 std::shared_ptr<ManifoldGeometry> createMutableManifoldFromGeometry(const std::shared_ptr<const Geometry>& geom) {
+  if (auto instanced = dynamic_pointer_cast<const InstancedGeometry>(geom)) {
+    return createMutableManifoldFromGeometry(instanced->materialized());
+  }
   if (auto mani = dynamic_pointer_cast<const ManifoldGeometry>(geom)) {
     return std::make_shared<ManifoldGeometry>(*mani);
   }
@@ -131,7 +131,7 @@ PolySet *straight_skeleton_roof(const Polygon2d& poly)
       // poly has to go through clipper just as it does for the roof
       // because this may change coordinates
       PolySet *tess = poly_sanitized->tessellate();
-      for (const std::vector<Vector3d>& triangle : tess->polygons) {
+      for (const auto& triangle : tess->polygons) {
         Polygon floor;
         for (const Vector3d& tv : triangle) {
           floor.push_back(tv);
@@ -367,7 +367,7 @@ PolySet *voronoi_diagram_roof(const Polygon2d& poly, double fa, double fs)
       outline.vertices = face;
       face_poly.addOutline(outline);
       PolySet *tess = face_poly.tessellate();
-      for (const std::vector<Vector3d>& triangle : tess->polygons) {
+      for (const auto& triangle : tess->polygons) {
         Polygon roof;
         for (Vector3d tv : triangle) {
           Vector2d v;
@@ -395,7 +395,7 @@ PolySet *voronoi_diagram_roof(const Polygon2d& poly, double fa, double fs)
         poly_floor.addOutline(o);
       }
       PolySet *tess = poly_floor.tessellate();
-      for (const std::vector<Vector3d>& triangle : tess->polygons) {
+      for (const auto& triangle : tess->polygons) {
         Polygon floor;
         for (const Vector3d& tv : triangle) {
           floor.push_back(tv);
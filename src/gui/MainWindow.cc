@@ -286,7 +286,6 @@ MainWindow::MainWindow(const QStringList& filenames)
   knownFileExtensions["csg"] = "";
 
   root_file = nullptr;
-  parsed_file = nullptr;
   absolute_root_node = nullptr;
 
   // Open Recent
@@ -940,9 +939,6 @@ void MainWindow::updateReorderMode(bool reorderMode)
 
 MainWindow::~MainWindow()
 {
-  // If root_file is not null then it will be the same as parsed_file,
-  // so no need to delete it.
-  delete parsed_file;
 #ifdef ENABLE_CGAL
   delete this->cgalRenderer;
 #endif
@@ -1034,6 +1030,7 @@ void MainWindow::compile(bool reload, bool forcedone)
     compileWarnings = 0;
 
     this->renderStatistic.start();
+    RenderStatistic::resetCounts();
 
     // Reload checks the timestamp of the toplevel file and refreshes if necessary,
     if (reload) {
@@ -1226,14 +1223,31 @@ void MainWindow::instantiateRoot()
     LOG("Compiling design (CSG Tree generation)...");
     this->processEvents();
 
-    AbstractNode::resetIndexCounter();
+    const bool incremental = Feature::ExperimentalIncrementalEvaluation.is_enabled();
+    // Reused nodes keep their indices, so numbering never restarts with incremental evaluation
+    if (!incremental) AbstractNode::resetIndexCounter();
 
     EvaluationSession session{doc.parent_path().string()};
     ContextHandle<BuiltinContext> builtin_context{Context::create<BuiltinContext>(&session)};
     setRenderVariables(builtin_context);
 
     std::shared_ptr<const FileContext> file_context;
-    this->absolute_root_node = this->root_file->instantiate(*builtin_context, &file_context);
+    if (incremental) {
+      // Everything evaluation depends on besides the source text
+      std::ostringstream inputs;
+      inputs.precision(17);
+      inputs << this->is_preview << ' ' << this->animateWidget->getAnim_tval() << ' '
+             << qglview->cam.getVpt().transpose() << ' ' << qglview->cam.getVpr().transpose() << ' '
+             << qglview->cam.zoomValue() << ' ' << qglview->cam.fovValue() << ' '
+             << this->includes_mtime << ' ' << this->deps_mtime;
+      this->absolute_root_node = this->instantiation_cache.instantiate(
+        this->parsed_file, this->last_compiled_doc.toStdString(), inputs.str(), *builtin_context, &file_context);
+      LOG("Reused %1$d and instantiated %2$d top level objects.",
+          this->instantiation_cache.reusedCount(), this->instantiation_cache.instantiatedCount());
+    } else {
+      this->instantiation_cache.clear();
+      this->absolute_root_node = this->root_file->instantiate(*builtin_context, &file_context);
+    }
     if (file_context) {
       this->qglview->cam.updateView(file_context, false);
       viewportControlWidget->cameraChanged();
@@ -1801,10 +1815,12 @@ void MainWindow::parseTopLevelDocument()
 
   auto fnameba = activeEditor->filepath.toLocal8Bit();
   const char *fname = activeEditor->filepath.isEmpty() ? "" : fnameba;
-  delete this->parsed_file;
-  this->parsed_file = nullptr; // because the parse() call can throw and we don't want a stale pointer!
+  this->parsed_file.reset(); // because the parse() call can throw and we don't want a stale pointer!
   this->root_file = nullptr;  // ditto
-  this->root_file = parse(this->parsed_file, fulltext, fname, fname, false) ? this->parsed_file : nullptr;
+  SourceFile *parsed_file = nullptr;
+  const bool parsed = parse(parsed_file, fulltext, fname, fname, false);
+  this->parsed_file.reset(parsed_file);
+  this->root_file = parsed ? parsed_file : nullptr;
 
   this->activeEditor->resetHighlighting();
   if (this->root_file != nullptr) {
@@ -4,6 +4,7 @@
 #include "Geometry.h"
 #include "export.h"
 #include "ExportPdfDialog.h"
+#include "InstantiationCache.h"
 #include "memory.h"
 #include "RenderStatistic.h"
 #include "TabManager.h"
@@ -53,7 +54,8 @@ public:
   RenderStatistic renderStatistic;
 
   SourceFile *root_file; // Result of parsing
-  SourceFile *parsed_file; // Last parse for include list
+  std::shared_ptr<SourceFile> parsed_file; // Last parse for include list
+  InstantiationCache instantiation_cache; // Top-level instantiations of previous compiles
   std::shared_ptr<AbstractNode> absolute_root_node; // Result of tree evaluation
   std::shared_ptr<AbstractNode> root_node; // Root if the root modifier (!) is used
   Tree tree;
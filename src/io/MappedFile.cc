@@ -0,0 +1,95 @@
+#include "MappedFile.h"
+
+#include <fstream>
+#include <boost/filesystem.hpp>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = boost::filesystem;
+
+bool MappedFile::open(const std::string& filename)
+{
+  close();
+
+#ifdef _WIN32
+  HANDLE file = CreateFileW(fs::path(filename).wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file != INVALID_HANDLE_VALUE) {
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart == 0) {
+      CloseHandle(file);
+      this->begin = this->contents.data();
+      return true;
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping) {
+      void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      if (view) {
+        this->mapping = mapping;
+        this->begin = static_cast<const char *>(view);
+        this->length = static_cast<size_t>(size.QuadPart);
+        this->mapped = true;
+        return true;
+      }
+      CloseHandle(mapping);
+    }
+  }
+#else
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+    if (st.st_size == 0) {
+      ::close(fd);
+      this->begin = this->contents.data();
+      return true;
+    }
+    void *view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view != MAP_FAILED) {
+      ::close(fd);
+#ifdef POSIX_MADV_SEQUENTIAL
+      posix_madvise(view, static_cast<size_t>(st.st_size), POSIX_MADV_SEQUENTIAL);
+#endif
+      this->begin = static_cast<const char *>(view);
+      this->length = static_cast<size_t>(st.st_size);
+      this->mapped = true;
+      return true;
+    }
+  }
+  ::close(fd);
+#endif
+
+  // Fall back to reading the file, e.g. for pipes or file systems without mmap support
+  std::ifstream f(fs::path(filename).string(), std::ios::in | std::ios::binary);
+  if (!f.good()) return false;
+  this->contents.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+  this->begin = this->contents.data();
+  this->length = this->contents.size();
+  return true;
+}
+
+void MappedFile::close()
+{
+  if (this->mapped) {
+#ifdef _WIN32
+    UnmapViewOfFile(this->begin);
+    CloseHandle(static_cast<HANDLE>(this->mapping));
+    this->mapping = nullptr;
+#else
+    munmap(const_cast<char *>(this->begin), this->length);
+#endif
+  }
+  this->contents.clear();
+  this->contents.shrink_to_fit();
+  this->begin = nullptr;
+  this->length = 0;
+  this->mapped = false;
+}
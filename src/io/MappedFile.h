@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/*!
+   Read-only view of a whole file, memory mapped where the platform allows it.
+   Importers use this to tokenise large files in place, without copying them
+   into line buffers.
+ */
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile() { close(); }
+
+  // Returns false if the file cannot be opened or read
+  bool open(const std::string& filename);
+  void close();
+
+  const char *data() const { return this->begin; }
+  size_t size() const { return this->length; }
+
+private:
+  const char *begin = nullptr;
+  size_t length = 0;
+  bool mapped = false;
+  // Holds the file contents when it could not be mapped
+  std::string contents;
+#ifdef _WIN32
+  void *mapping = nullptr;
+#endif
+};
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <boost/lexical_cast.hpp>
+
+#include "parallel.h"
+
+/*!
+   Allocation-free tokenising helpers for the text importers (STL, OBJ),
+   also used by the ASCII STL exporter to read back its rounded output.
+   They work on string_views into a MappedFile instead of on std::getline
+   buffers, and are meant to accept the same input as the boost::regex and
+   boost::lexical_cast based parsing they replace.
+ */
+namespace TextUtils {
+
+inline bool is_space(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+inline bool is_digit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+inline std::string_view trim(std::string_view s)
+{
+  while (!s.empty() && is_space(s.front())) s.remove_prefix(1);
+  while (!s.empty() && is_space(s.back())) s.remove_suffix(1);
+  return s;
+}
+
+inline bool starts_with(std::string_view s, std::string_view prefix)
+{
+  return s.size() >= prefix.size() && s.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Returns true if s starts with keyword followed by whitespace
+inline bool is_keyword(std::string_view s, std::string_view keyword)
+{
+  return s.size() > keyword.size() && starts_with(s, keyword) && is_space(s[keyword.size()]);
+}
+
+// Removes the next whitespace separated token from s and returns it, or an empty view at the end of s
+inline std::string_view next_token(std::string_view& s)
+{
+  size_t begin = 0;
+  while (begin < s.size() && is_space(s[begin])) ++begin;
+  size_t end = begin;
+  while (end < s.size() && !is_space(s[end])) ++end;
+  std::string_view token = s.substr(begin, end - begin);
+  s.remove_prefix(end);
+  return token;
+}
+
+/*!
+   Parses a complete token as double. Plain decimal numbers with up to 19
+   significant digits and a small exponent are converted exactly using the
+   fast path described by Clinger (as fast_float does); everything else
+   (long mantissas, large exponents, nan, inf, ...) is left to
+   boost::lexical_cast. Returns false if the token is not a number.
+ */
+inline bool parse_double(std::string_view token, double& result)
+{
+  static const double powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  const char *p = token.data();
+  const char *end = p + token.size();
+  bool negative = false;
+  if (p != end && (*p == '+' || *p == '-')) negative = *p++ == '-';
+
+  uint64_t mantissa = 0;
+  int significant_digits = 0;
+  int exponent = 0;
+  bool any_digits = false;
+  bool fast = true;
+  auto add_digit = [&](char c) {
+    any_digits = true;
+    if (mantissa == 0 && c == '0') return;
+    if (++significant_digits > 19) fast = false;
+    else mantissa = mantissa * 10 + (c - '0');
+  };
+  for (; p != end && is_digit(*p); ++p) add_digit(*p);
+  if (p != end && *p == '.') {
+    for (++p; p != end && is_digit(*p); ++p) {
+      add_digit(*p);
+      --exponent;
+    }
+  }
+  if (any_digits && p != end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    bool negative_exponent = false;
+    if (p != end && (*p == '+' || *p == '-')) negative_exponent = *p++ == '-';
+    if (p == end || !is_digit(*p)) fast = false;
+    int value = 0;
+    for (; p != end && is_digit(*p); ++p) {
+      if (value < 10000) value = value * 10 + (*p - '0');
+    }
+    exponent += negative_exponent ? -value : value;
+  }
+
+  if (fast && any_digits && p == end) {
+    if (mantissa == 0) {
+      result = negative ? -0.0 : 0.0;
+      return true;
+    }
+    if (mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+      double value = static_cast<double>(mantissa);
+      value = exponent < 0 ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+      result = negative ? -value : value;
+      return true;
+    }
+  }
+  try {
+    result = boost::lexical_cast<double>(token.data(), token.size());
+    return true;
+  } catch (const boost::bad_lexical_cast&) {
+    return false;
+  }
+}
+
+// Parses a complete token as int, accepting what boost::lexical_cast<int> accepts
+inline bool parse_int(std::string_view token, int& result)
+{
+  const char *p = token.data();
+  const char *end = p + token.size();
+  bool negative = false;
+  if (p != end && (*p == '+' || *p == '-')) negative = *p++ == '-';
+  if (p != end && end - p <= 9) {
+    int value = 0;
+    for (; p != end && is_digit(*p); ++p) value = value * 10 + (*p - '0');
+    if (p == end) {
+      result = negative ? -value : value;
+      return true;
+    }
+  }
+  try {
+    result = boost::lexical_cast<int>(token.data(), token.size());
+    return true;
+  } catch (const boost::bad_lexical_cast&) {
+    return false;
+  }
+}
+
+/*!
+   Iterates over the lines of a text range. Lines are returned without their
+   '\n', and a final empty line after a trailing '\n' is not returned.
+ */
+class LineReader
+{
+public:
+  LineReader(const char *begin, const char *end) : pos(begin), end(end) {}
+
+  bool next(std::string_view& line) {
+    if (this->pos == this->end) return false;
+    const char *newline = static_cast<const char *>(memchr(this->pos, '\n', this->end - this->pos));
+    const char *line_end = newline ? newline : this->end;
+    line = std::string_view(this->pos, line_end - this->pos);
+    this->pos = newline ? newline + 1 : this->end;
+    ++this->count;
+    return true;
+  }
+  // Index of the line last returned by next(), starting at 0
+  size_t index() const { return this->count - 1; }
+  // Number of lines returned so far
+  size_t lines() const { return this->count; }
+
+private:
+  const char *pos;
+  const char *end;
+  size_t count = 0;
+};
+
+struct TextChunk {
+  const char *begin;
+  const char *end;
+};
+
+// Text smaller than this is always parsed in one chunk
+inline constexpr size_t PARALLEL_CHUNK_SIZE = 4ul << 20;
+
+/*!
+   Splits text into chunks of roughly PARALLEL_CHUNK_SIZE bytes for parsing with
+   parallelizable_transform(). Every chunk but the first starts at a line for
+   which is_boundary() returns true, so a parser can start on it without the
+   state of the preceding text. All chunks but the last end with a '\n'.
+   Returns a single chunk if parallel processing is not available.
+ */
+template <typename Predicate>
+std::vector<TextChunk> split_lines(const char *begin, const char *end, const Predicate& is_boundary)
+{
+  const bool parallel = is_parallelizable();
+  std::vector<TextChunk> chunks;
+  const char *start = begin;
+  while (start != end) {
+    if (!parallel || static_cast<size_t>(end - start) < 2 * PARALLEL_CHUNK_SIZE) {
+      chunks.push_back({start, end});
+      break;
+    }
+    const char *pos = start + PARALLEL_CHUNK_SIZE;
+    while (pos != end) {
+      const char *newline = static_cast<const char *>(memchr(pos, '\n', end - pos));
+      if (!newline) {
+        pos = end;
+        break;
+      }
+      pos = newline + 1;
+      const char *line_end = static_cast<const char *>(memchr(pos, '\n', end - pos));
+      if (is_boundary(std::string_view(pos, (line_end ? line_end : end) - pos))) break;
+    }
+    chunks.push_back({start, pos});
+    start = pos;
+  }
+  if (chunks.empty()) chunks.push_back({begin, end});
+  return chunks;
+}
+
+} // namespace TextUtils
@@ -27,6 +27,14 @@
 #include "export.h"
 #include "PolySet.h"
 #include "PolySetUtils.h"
+#include "TextUtils.h"
+#include "parallel.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <thread>
 #ifdef ENABLE_MANIFOLD
 #include "ManifoldGeometry.h"
 #endif
@@ -39,123 +47,197 @@
 
 namespace {
 
-std::string toString(const Vector3d& v)
-{
-  return STR(v[0], " ", v[1], " ", v[2]);
-}
+using Triangle = std::array<Vector3d, 3>;
+
+// Triangles per chunk; each chunk is formatted into one reusable buffer
+inline constexpr size_t STL_CHUNK_TRIANGLES = 4096;
 
 Vector3d toVector(const std::array<double, 3>& pt) {
   return {pt[0], pt[1], pt[2]};
 }
 
-Vector3d fromString(const std::string& vertexString)
-{
-  Vector3d v;
-  std::istringstream stream{vertexString};
-  stream >> v[0] >> v[1] >> v[2];
-  return v;
+void append_float(std::string& output, float f) {
+  static_assert(sizeof(float) == 4, "Need 32 bit float");
+  char data[4];
+  memcpy(data, &f, 4);
+  uint16_t test = 0x0001;
+  if (*reinterpret_cast<char *>(&test) != 1) {
+    std::reverse(data, data + 4);
+  }
+  output.append(data, 4);
+}
+
+void append_vector(std::string& output, const Vector3f& v) {
+  for (int i = 0; i < 3; ++i) append_float(output, v[i]);
+}
+
+void append_binary_triangle(std::string& output, const Triangle& p) {
+  Vector3f p0 = p[0].cast<float>();
+  Vector3f p1 = p[1].cast<float>();
+  Vector3f p2 = p[2].cast<float>();
+
+  Vector3f normal(0, 0, 0);
+  // Ensure 3 distinct vertices.
+  if ((p0 != p1) && (p0 != p2) && (p1 != p2)) {
+    normal = (p1 - p0).cross(p2 - p0);
+    normal.normalize();
+    if (!is_finite(normal) || is_nan(normal)) {
+      // Collinear vertices.
+      normal << 0, 0, 0;
+    }
+  }
+  append_vector(output, normal);
+  append_vector(output, p0);
+  append_vector(output, p1);
+  append_vector(output, p2);
+  output.append(2, '\0');
 }
 
-void write_vector(std::ostream& output, const Vector3f& v) {
-  for (int i = 0; i < 3; ++i) {
-    static_assert(sizeof(float) == 4, "Need 32 bit float");
-    float f = v[i];
-    char *fbeg = reinterpret_cast<char *>(&f);
-    char data[4];
+// Formats like the default std::ostream output (6 significant digits), which ASCII STL has always used.
+// std::to_chars does not depend on the locale, unlike snprintf().
+struct FormattedVertex {
+  char coords[3][32];
+  int lengths[3];
 
-    uint16_t test = 0x0001;
-    if (*reinterpret_cast<char *>(&test) == 1) {
-      std::copy(fbeg, fbeg + 4, data);
+  explicit FormattedVertex(const Vector3d& v) {
+    for (int i = 0; i < 3; ++i) {
+      lengths[i] = std::to_chars(coords[i], coords[i] + sizeof(coords[i]), v[i], std::chars_format::general, 6).ptr - coords[i];
+    }
+  }
+  bool operator==(const FormattedVertex& other) const {
+    for (int i = 0; i < 3; ++i) {
+      if (lengths[i] != other.lengths[i] || memcmp(coords[i], other.coords[i], lengths[i]) != 0) return false;
+    }
+    return true;
+  }
+  bool operator!=(const FormattedVertex& other) const { return !(*this == other); }
+  // The vertex as written to the file
+  Vector3d value() const {
+    Vector3d v;
+    for (int i = 0; i < 3; ++i) {
+      if (!TextUtils::parse_double(std::string_view(coords[i], lengths[i]), v[i])) v[i] = NAN;
+    }
+    return v;
+  }
+  void append(std::string& output) const {
+    for (int i = 0; i < 3; ++i) {
+      if (i > 0) output += ' ';
+      output.append(coords[i], lengths[i]);
+    }
+  }
+};
+
+void append_ascii_triangle(std::string& output, const Triangle& p) {
+  const std::array<FormattedVertex, 3> vertices{FormattedVertex(p[0]), FormattedVertex(p[1]), FormattedVertex(p[2])};
+
+  if (vertices[0] != vertices[1] &&
+      vertices[0] != vertices[2] &&
+      vertices[1] != vertices[2]) {
+
+    // The above condition ensures that there are 3 distinct
+    // vertices, but they may be collinear. If they are, the unit
+    // normal is meaningless so the default value of "0 0 0" can
+    // be used. If the vertices are not collinear then the unit
+    // normal must be calculated from the components, as written.
+    output += "  facet normal ";
+
+    Vector3d p0 = vertices[0].value();
+    Vector3d p1 = vertices[1].value();
+    Vector3d p2 = vertices[2].value();
+
+    Vector3d normal = (p1 - p0).cross(p2 - p0);
+    normal.normalize();
+    if (is_finite(normal) && !is_nan(normal)) {
+      FormattedVertex(normal).append(output);
+      output += '\n';
     } else {
-      std::reverse_copy(fbeg, fbeg + 4, data);
+      output += "0 0 0\n";
     }
-    output.write(data, 4);
+    output += "    outer loop\n";
+
+    for (const auto& vertex : vertices) {
+      output += "      vertex ";
+      vertex.append(output);
+      output += '\n';
+    }
+    output += "    endloop\n";
+    output += "  endfacet\n";
   }
 }
 
+/*!
+   Streams triangles to an STL file. Triangles are collected into chunks of
+   STL_CHUNK_TRIANGLES, which are formatted into reusable buffers (several
+   chunks in parallel where available) and then written in order, so memory
+   use does not depend on the size of the mesh.
+ */
+class StlWriter
+{
+public:
+  StlWriter(std::ostream& output, bool binary) : output(output), binary(binary) {
+    const size_t chunks = is_parallelizable() ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+    this->triangles.reserve(chunks * STL_CHUNK_TRIANGLES);
+    this->buffers.resize(chunks);
+  }
+
+  void add(const Triangle& triangle) {
+    this->triangles.push_back(triangle);
+    this->triangle_count++;
+    if (this->triangles.size() == this->triangles.capacity()) flush();
+  }
+
+  void flush() {
+    std::vector<size_t> chunks((this->triangles.size() + STL_CHUNK_TRIANGLES - 1) / STL_CHUNK_TRIANGLES);
+    std::iota(chunks.begin(), chunks.end(), 0);
+    std::vector<size_t> sizes(chunks.size());
+    parallelizable_transform(chunks.begin(), chunks.end(), sizes.begin(), [this](size_t chunk) {
+      auto& buffer = this->buffers[chunk];
+      buffer.clear();
+      const size_t begin = chunk * STL_CHUNK_TRIANGLES;
+      const size_t end = std::min(begin + STL_CHUNK_TRIANGLES, this->triangles.size());
+      for (size_t i = begin; i < end; ++i) {
+        if (this->binary) append_binary_triangle(buffer, this->triangles[i]);
+        else append_ascii_triangle(buffer, this->triangles[i]);
+      }
+      return buffer.size();
+    });
+    for (size_t chunk = 0; chunk < chunks.size(); ++chunk) {
+      this->output.write(this->buffers[chunk].data(), sizes[chunk]);
+    }
+    this->triangles.clear();
+  }
+
+  uint64_t count() const { return this->triangle_count; }
+
+private:
+  std::ostream& output;
+  bool binary;
+  std::vector<Triangle> triangles;
+  std::vector<std::string> buffers;
+  uint64_t triangle_count = 0;
+};
 
 uint64_t append_stl(const PolySet& ps, std::ostream& output, bool binary)
 {
-  uint64_t triangle_count = 0;
-  PolySet triangulated(3);
-  PolySetUtils::tessellate_faces(ps, triangulated);
-
-  auto processTriangle = [&](const std::array<Vector3d, 3>& p) {
-      triangle_count++;
-
-      if (binary) {
-        Vector3f p0 = p[0].cast<float>();
-        Vector3f p1 = p[1].cast<float>();
-        Vector3f p2 = p[2].cast<float>();
-
-        // Ensure 3 distinct vertices.
-        if ((p0 != p1) && (p0 != p2) && (p1 != p2)) {
-          Vector3f normal = (p1 - p0).cross(p2 - p0);
-          normal.normalize();
-          if (!is_finite(normal) || is_nan(normal)) {
-            // Collinear vertices.
-            normal << 0, 0, 0;
-          }
-          write_vector(output, normal);
-        }
-        write_vector(output, p0);
-        write_vector(output, p1);
-        write_vector(output, p2);
-        char attrib[2] = {0, 0};
-        output.write(attrib, 2);
-      } else { // ascii
-        std::array<std::string, 3> vertexStrings;
-        std::transform(p.cbegin(), p.cend(), vertexStrings.begin(),
-                       toString);
-
-        if (vertexStrings[0] != vertexStrings[1] &&
-            vertexStrings[0] != vertexStrings[2] &&
-            vertexStrings[1] != vertexStrings[2]) {
-
-          // The above condition ensures that there are 3 distinct
-          // vertices, but they may be collinear. If they are, the unit
-          // normal is meaningless so the default value of "0 0 0" can
-          // be used. If the vertices are not collinear then the unit
-          // normal must be calculated from the components.
-          output << "  facet normal ";
-
-          Vector3d p0 = fromString(vertexStrings[0]);
-          Vector3d p1 = fromString(vertexStrings[1]);
-          Vector3d p2 = fromString(vertexStrings[2]);
-
-          Vector3d normal = (p1 - p0).cross(p2 - p0);
-          normal.normalize();
-          if (is_finite(normal) && !is_nan(normal)) {
-            output << normal[0] << " " << normal[1] << " " << normal[2]
-                   << "\n";
-          } else {
-            output << "0 0 0\n";
-          }
-          output << "    outer loop\n";
-
-          for (const auto& vertexString : vertexStrings) {
-            output << "      vertex " << vertexString << "\n";
-          }
-          output << "    endloop\n";
-          output << "  endfacet\n";
-        }
-      }
-    };
+  StlWriter writer(output, binary);
 
   if (Feature::ExperimentalPredictibleOutput.is_enabled()) {
+    // Sorting the output needs the whole tessellated mesh
+    PolySet triangulated(3);
+    PolySetUtils::tessellate_faces(ps, triangulated);
     Export::ExportMesh exportMesh { triangulated };
     exportMesh.foreach_triangle([&](const auto& pts) {
-        processTriangle({ toVector(pts[0]), toVector(pts[1]), toVector(pts[2]) });
+        writer.add({ toVector(pts[0]), toVector(pts[1]), toVector(pts[2]) });
         return true;
       });
   } else {
-    for (const auto& p : triangulated.polygons) {
-      assert(p.size() == 3); // STL only allows triangles
-      processTriangle({ p[0], p[1], p[2] });
-    }
+    PolySetUtils::foreach_tessellated_triangle(ps, [&](const Triangle& triangle) {
+        writer.add(triangle);
+      });
   }
+  writer.flush();
 
-  return triangle_count;
+  return writer.count();
 }
 
 /*!
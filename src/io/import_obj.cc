@@ -1,92 +1,165 @@
 #include "import.h"
+#include "MappedFile.h"
+#include "TextUtils.h"
 #include "PolySet.h"
-#include <fstream>
+#include "printutils.h"
+#include "parallel.h"
+
+#include <string>
 #include <vector>
-#include <boost/regex.hpp>
-#include <boost/lexical_cast.hpp>
-#include <boost/algorithm/string.hpp>
-#include <boost/algorithm/string/split.hpp>
+
+namespace {
+
+struct ObjMessage {
+  size_t line; // index of the line in its chunk
+  const char *error; // nullptr for an unrecognized line
+  std::string text;
+};
+
+struct ObjFace {
+  size_t line;
+  size_t vertices; // vertices of the chunk defined before the face
+  size_t begin, end; // range in ObjChunk::indices
+};
+
+struct ObjChunk {
+  std::vector<Vector3d> vertices;
+  std::vector<int> indices;
+  std::vector<ObjFace> faces;
+  std::vector<ObjMessage> messages;
+  size_t lines = 0;
+  bool failed = false;
+};
+
+ObjChunk parse_obj(const TextUtils::TextChunk& chunk)
+{
+  using namespace TextUtils;
+  ObjChunk result;
+  LineReader reader(chunk.begin, chunk.end);
+  std::string_view line;
+
+  auto AsciiError = [&](const char *errstr){
+      result.messages.push_back({reader.index(), errstr, std::string(line)});
+      result.failed = true;
+    };
+
+  while (reader.next(line)) {
+    line = trim(line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    if (is_keyword(line, "v")) {
+      std::string_view args = line.substr(1);
+      const std::string_view x = next_token(args);
+      const std::string_view y = next_token(args);
+      const std::string_view z = next_token(args);
+      if (!z.empty() && trim(args).empty()) {
+        Vector3d v;
+        if (!parse_double(x, v[0]) || !parse_double(y, v[1]) || !parse_double(z, v[2])) {
+          AsciiError("can't parse vertex");
+          break;
+        }
+        result.vertices.push_back(v);
+        continue;
+      }
+    }
+    if (is_keyword(line, "f")) {
+      ObjFace face{reader.index(), result.vertices.size(), result.indices.size(), 0};
+      std::string_view args = line.substr(1);
+      bool valid = true;
+      for (std::string_view word = next_token(args); !word.empty(); word = next_token(args)) {
+        // Only the vertex index is used of "v/vt/vn" references
+        int index;
+        if (!parse_int(word.substr(0, word.find('/')), index)) {
+          valid = false;
+          break;
+        }
+        result.indices.push_back(index);
+      }
+      if (!valid) {
+        AsciiError("can't parse face index");
+        break;
+      }
+      face.end = result.indices.size();
+      result.faces.push_back(face);
+    } else if (starts_with(line, "vt") || // ignore texture coords
+               starts_with(line, "vn") || // ignore normal coords
+               starts_with(line, "mtllib") || // ignore material lib
+               starts_with(line, "usemtl") || // ignore usemtl
+               line[0] == 'o' || // ignore object name
+               line[0] == 's' || // ignore smoothing
+               line[0] == 'g') { // ignore group name
+    } else {
+      result.messages.push_back({reader.index(), nullptr, std::string(line)});
+    }
+  }
+  result.lines = reader.lines();
+  return result;
+}
+
+} // namespace
 
 PolySet *import_obj(const std::string& filename, const Location& loc) {
   std::unique_ptr<PolySet> p = std::make_unique<PolySet>(3);
 
-  
-  std::ifstream f(filename.c_str(), std::ios::in | std::ios::binary );
-  if (!f.good()) {
+  MappedFile file;
+  if (!file.open(filename)) {
     LOG(message_group::Warning,
         "Can't open import file '%1$s', import() at line %2$d",
         filename, loc.firstLine());
     return p.release();
   }
-  std::vector<Vector3d> pts;
-  boost::regex ex_comment(R"(^\s*#)");
-  boost::regex ex_v( R"(^\s*v\s+([^\s]+)\s+([^\s]+)\s+([^\s]+)\s*$)");
-  boost::regex ex_f( R"(^\s*f\s+(.*)$)");
-  boost::regex ex_vt( R"(^\s*vt)");
-  boost::regex ex_vn( R"(^\s*vn)");
-  boost::regex ex_mtllib( R"(^\s*mtllib)");
-  boost::regex ex_usemtl( R"(^\s*usemtl)");
-  boost::regex ex_o( R"(^\s*o)");
-  boost::regex ex_s( R"(^\s*s)");
-  boost::regex ex_g( R"(^\s*g)");
-  int lineno = 1;
-  std::string line;
-
-  auto AsciiError = [&](const auto& errstr){
-    LOG(message_group::Error, loc, "",
-    "OBJ File line %1$s, %2$s line '%3$s' importing file '%4$s'",
-    lineno, errstr, line, filename);
-  };
-
-  while (!f.eof()) {
-    lineno++;
-    std::getline(f, line);
-    boost::trim(line);
-
-    boost::smatch results;
-    if (line.length() == 0 || boost::regex_search(line, ex_comment)) {
-      continue;
-    } else if (boost::regex_search(line, results, ex_v) && results.size() >= 4) {
-      try {
-	Vector3d v;
-        for (int i = 0; i < 3; i++) {
-          v[i]= boost::lexical_cast<double>(results[i + 1]); 
+
+  // Any line can start a chunk, faces are resolved against the vertices of
+  // all preceding chunks when merging.
+  const auto chunks = TextUtils::split_lines(file.data(), file.data() + file.size(),
+                                             [](std::string_view) { return true; });
+  std::vector<ObjChunk> results(chunks.size());
+  parallelizable_transform(chunks.begin(), chunks.end(), results.begin(), parse_obj);
+
+  size_t num_vertices = 0;
+  size_t num_faces = 0;
+  for (const auto& chunk : results) {
+    num_vertices += chunk.vertices.size();
+    num_faces += chunk.faces.size();
+  }
+  p->reserve_vertices(num_vertices);
+  p->reserve(num_faces);
+
+  // Line numbers are reported as before, counting from 2 for the first line
+  size_t lineno = 2;
+  size_t vertex_base = 0;
+  for (const auto& chunk : results) {
+    auto log_message = [&](const ObjMessage& message) {
+        if (message.error) {
+          LOG(message_group::Error, loc, "",
+              "OBJ File line %1$s, %2$s line '%3$s' importing file '%4$s'",
+              lineno + message.line, message.error, message.text, filename);
+        } else {
+          LOG(message_group::Warning, "Unrecognized Line  %1$s in line Line %2$d", message.text, lineno + message.line);
         }
-        pts.push_back(v);
-      } catch (const boost::bad_lexical_cast& blc) {
-        AsciiError("can't parse vertex");
-        return new PolySet(3);
-      }
-    } else if (boost::regex_search(line, results, ex_f) && results.size() >= 2) {
-      std::string args=results[1];
-      std::vector<std::string> words;
-      boost::split(words, results[1], boost::is_any_of(" \t"));
-      p->append_poly(words.size());
-      for (const std::string& word : words) {
-        std::vector<std::string> wordindex;
-        boost::split(wordindex, word, boost::is_any_of("/"));
-	if(wordindex.size() < 1)
-          LOG(message_group::Warning, "Invalid Face index in File %1$s in Line %2$d", filename, lineno);
-	else {
-	  int ind=boost::lexical_cast<int>(wordindex[0]);
-          if(ind >= 1 && ind  <= pts.size()) {
-            p->append_vertex(pts[ind-1][0], pts[ind-1][1], pts[ind-1][2]);
-	  } else {  
-            LOG(message_group::Warning, "Index %1$d out of range in Line %2$d", filename, lineno);
-	  }
-	} 
-      }
+      };
 
-    } else if (boost::regex_search(line, results, ex_vt)) { // ignore texture coords
-    } else if (boost::regex_search(line, results, ex_vn)) { // ignore normal coords
-    } else if (boost::regex_search(line, results, ex_mtllib)) { // ignore material lib
-    } else if (boost::regex_search(line, results, ex_usemtl)) { // ignore usemtl
-    } else if (boost::regex_search(line, results, ex_o)) { // ignore object name
-    } else if (boost::regex_search(line, results, ex_s)) { // ignore smooting
-    } else if (boost::regex_search(line, results, ex_g)) { // ignore group name
-    } else {
-      LOG(message_group::Warning, "Unrecognized Line  %1$s in line Line %2$d", line, lineno);
+    for (const auto& v : chunk.vertices) p->add_vertex(v);
+    auto message = chunk.messages.begin();
+    for (const auto& face : chunk.faces) {
+      for (; message != chunk.messages.end() && message->line < face.line; ++message) log_message(*message);
+      const size_t defined_vertices = vertex_base + face.vertices;
+      p->append_poly(face.end - face.begin);
+      for (size_t i = face.begin; i < face.end; ++i) {
+        const int ind = chunk.indices[i];
+        if (ind >= 1 && static_cast<size_t>(ind) <= defined_vertices) {
+          p->append_index(ind - 1);
+        } else {
+          LOG(message_group::Warning, "Index %1$d out of range in Line %2$d", ind, lineno + face.line);
+        }
+      }
     }
+    for (; message != chunk.messages.end(); ++message) log_message(*message);
+    if (chunk.failed) return new PolySet(3);
+
+    lineno += chunk.lines;
+    vertex_base += chunk.vertices.size();
   }
   return p.release();
 }
@@ -1,35 +1,25 @@
 #include "import.h"
+#include "MappedFile.h"
+#include "TextUtils.h"
 #include "PolySet.h"
 #include "printutils.h"
+#include "parallel.h"
 #include "AST.h"
 
-#include <fstream>
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <boost/predef.h>
-#include <boost/regex.hpp>
-#include <boost/lexical_cast.hpp>
-#include <boost/algorithm/string.hpp>
 
 #if !defined(BOOST_ENDIAN_BIG_BYTE_AVAILABLE) && !defined(BOOST_ENDIAN_LITTLE_BYTE_AVAILABLE)
 #error Byte order undefined or unknown. Currently only BOOST_ENDIAN_BIG_BYTE and BOOST_ENDIAN_LITTLE_BYTE are supported.
 #endif
 
 inline constexpr size_t STL_FACET_NUMBYTES = 4ul * 3ul * 4ul + 2ul;
-// as there is no 'float32_t' standard, we assume the systems 'float'
-// is a 'binary32' aka 'single' standard IEEE 32-bit floating point type
-union stl_facet {
-  static_assert(sizeof(unsigned char) == sizeof(uint8_t), "existence check");
-  unsigned char data8[ STL_FACET_NUMBYTES ];
-  struct facet_data {
-    float i, j, k;
-    float x1, y1, z1;
-    float x2, y2, z2;
-    float x3, y3, z3;
-    uint16_t attribute_byte_count;
-  } data;
-};
-
-static_assert(offsetof(stl_facet::facet_data, attribute_byte_count) == 4ul * 3ul * 4ul,
-              "Invalid padding in stl_facet");
+// Offset of the first vertex in a facet, after the normal
+inline constexpr size_t STL_FACET_VERTEX_OFFSET = 3ul * 4ul;
+// Facets converted per task when importing binary STL in parallel
+inline constexpr size_t STL_FACET_CHUNK = 1ul << 16;
 
 #if BOOST_ENDIAN_BIG_BYTE
 static void uint32_byte_swap(unsigned char *p) {
@@ -50,144 +40,297 @@ static void uint32_byte_swap(uint32_t& x) {
 }
 #endif // if BOOST_ENDIAN_BIG_BYTE
 
-static void read_stl_facet(std::ifstream& f, stl_facet& facet) {
-  f.read((char *)facet.data8, STL_FACET_NUMBYTES);
-  if (f.gcount() < STL_FACET_NUMBYTES) {
-    throw std::ios_base::failure("facet data truncated");
+namespace {
+
+/*!
+   A binary STL vertex as the bit patterns of its three floats in host byte
+   order, as we assume the systems 'float' is a 'binary32' aka 'single'
+   standard IEEE 32-bit floating point type. -0 is stored as 0, so vertices
+   which compare equal have equal keys.
+ */
+struct VertexKey {
+  uint32_t bits[3];
+
+  bool operator==(const VertexKey& other) const {
+    return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
   }
-#if BOOST_ENDIAN_BIG_BYTE
-  for (int i = 0; i < 12; ++i) {
-    uint32_byte_swap(facet.data8 + i * 4);
+  size_t hash() const {
+    uint64_t h = (uint64_t(bits[0]) << 32 | bits[1]) * 0x9E3779B97F4A7C15ull;
+    h ^= (h >> 29) ^ (uint64_t(bits[2]) * 0xC2B2AE3D27D4EB4Full);
+    return static_cast<size_t>(h ^ (h >> 32));
+  }
+  Vector3d toVector() const {
+    float f[3];
+    memcpy(f, bits, sizeof(f));
+    return {f[0], f[1], f[2]};
   }
-  // we ignore attribute byte count
+};
+
+static_assert(sizeof(float) == sizeof(uint32_t), "Need 32 bit float");
+
+VertexKey read_stl_vertex(const char *data) {
+  VertexKey key;
+  memcpy(key.bits, data, sizeof(key.bits));
+  for (auto& bits : key.bits) {
+#if BOOST_ENDIAN_BIG_BYTE
+    uint32_byte_swap(bits);
 #endif
+    if (bits == 0x80000000u) bits = 0;
+  }
+  return key;
+}
+
+/*!
+   Welds equal vertices using an open addressing hash table, which maps each
+   distinct vertex to its index in vertices.
+ */
+class VertexWelder
+{
+public:
+  explicit VertexWelder(size_t expected) {
+    size_t capacity = 16;
+    while (capacity < 2 * expected) capacity *= 2;
+    this->slots.resize(capacity, EMPTY);
+    this->vertices.reserve(expected);
+  }
+
+  uint32_t lookup(const VertexKey& key) {
+    if (2 * (this->vertices.size() + 1) > this->slots.size()) grow();
+    const size_t mask = this->slots.size() - 1;
+    for (size_t slot = key.hash() & mask;; slot = (slot + 1) & mask) {
+      const uint32_t index = this->slots[slot];
+      if (index == EMPTY) {
+        this->slots[slot] = static_cast<uint32_t>(this->vertices.size());
+        this->vertices.push_back(key);
+        return this->slots[slot];
+      }
+      if (this->vertices[index] == key) return index;
+    }
+  }
+
+  std::vector<VertexKey> vertices;
+
+private:
+  void grow() {
+    std::vector<uint32_t> old(this->slots.size() * 2, EMPTY);
+    old.swap(this->slots);
+    const size_t mask = this->slots.size() - 1;
+    for (uint32_t index = 0; index < this->vertices.size(); ++index) {
+      size_t slot = this->vertices[index].hash() & mask;
+      while (this->slots[slot] != EMPTY) slot = (slot + 1) & mask;
+      this->slots[slot] = index;
+    }
+  }
+
+  static constexpr uint32_t EMPTY = 0xFFFFFFFFu;
+  std::vector<uint32_t> slots;
+};
+
+struct BinaryStlChunk {
+  std::vector<VertexKey> vertices; // distinct vertices of the chunk
+  std::vector<uint32_t> indices; // three per facet, into vertices
+};
+
+BinaryStlChunk read_binary_stl(const char *begin, const char *end)
+{
+  const size_t facets = (end - begin) / STL_FACET_NUMBYTES;
+  VertexWelder welder(facets);
+  BinaryStlChunk result;
+  result.indices.reserve(3 * facets);
+  for (const char *facet = begin; facet != end; facet += STL_FACET_NUMBYTES) {
+    // the facet normal and attribute byte count are ignored
+    for (size_t v = 0; v < 3; ++v) {
+      result.indices.push_back(welder.lookup(read_stl_vertex(facet + STL_FACET_VERTEX_OFFSET * (v + 1))));
+    }
+  }
+  result.vertices = std::move(welder.vertices);
+  return result;
+}
+
+struct AsciiMessage {
+  size_t line; // index of the line in its chunk
+  const char *error;
+  std::string text;
+};
+
+struct AsciiStlChunk {
+  std::vector<Vector3d> vertices; // three per facet
+  std::vector<AsciiMessage> messages;
+  size_t lines = 0;
+  bool reached_end = false;
+  bool failed = false;
+};
+
+AsciiStlChunk parse_ascii_stl(const TextUtils::TextChunk& chunk)
+{
+  using namespace TextUtils;
+  AsciiStlChunk result;
+  LineReader reader(chunk.begin, chunk.end);
+  std::array<Vector3d, 3> vdata;
+  int i = 0;
+  std::string_view line;
+
+  auto AsciiError = [&](const char *errstr){
+      result.messages.push_back({reader.index(), errstr, std::string(line)});
+    };
+
+  while (reader.next(line)) {
+    line = trim(line);
+    if (line.empty() || starts_with(line, "solid") || starts_with(line, "facet") || starts_with(line, "endfacet")) {
+      continue;
+    } else if (line == "outer loop") {
+      i = 0;
+    } else if (line == "endloop") {
+      if (i < 3) {
+        AsciiError("missing vertex");
+      }
+    } else if (starts_with(line, "endsolid")) {
+      result.reached_end = true;
+      break;
+    } else if (i >= 3) {
+      AsciiError("extra vertex");
+      result.failed = true;
+      break;
+    } else if (is_keyword(line, "vertex")) {
+      std::string_view args = line.substr(6);
+      const std::string_view x = next_token(args);
+      const std::string_view y = next_token(args);
+      const std::string_view z = next_token(args);
+      if (z.empty() || !trim(args).empty()) continue; // not a vertex line, ignored as before
+      if (!parse_double(x, vdata[i][0]) || !parse_double(y, vdata[i][1]) || !parse_double(z, vdata[i][2])) {
+        AsciiError("can't parse vertex");
+        result.failed = true;
+        break;
+      }
+      if (++i == 3) {
+        result.vertices.insert(result.vertices.end(), vdata.begin(), vdata.end());
+      }
+    }
+  }
+  result.lines = reader.lines();
+  return result;
 }
 
+} // namespace
+
 PolySet *import_stl(const std::string& filename, const Location& loc) {
   std::unique_ptr<PolySet> p = std::make_unique<PolySet>(3);
 
-  // Open file and position at the end
-  std::ifstream f(filename.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
-  if (!f.good()) {
+  MappedFile file;
+  if (!file.open(filename)) {
     LOG(message_group::Warning,
         "Can't open import file '%1$s', import() at line %2$d",
         filename, loc.firstLine());
     return p.release();
   }
-
-  boost::regex ex_sfe(R"(^\s*solid|^\s*facet|^\s*endfacet)");
-  boost::regex ex_outer("^\\s*outer loop$");
-  boost::regex ex_loopend("^\\s*endloop$");
-  boost::regex ex_vertex("^\\s*vertex");
-  boost::regex ex_vertices(
-    R"(^\s*vertex\s+([^\s]+)\s+([^\s]+)\s+([^\s]+)\s*$)");
-  boost::regex ex_endsolid("^\\s*endsolid");
+  const char *data = file.data();
+  const size_t file_size = file.size();
 
   bool binary = false;
-  std::streampos file_size = f.tellg();
-  f.seekg(80);
-  if (f.good() && !f.eof()) {
-    uint32_t facenum = 0;
-    f.read((char *)&facenum, sizeof(uint32_t));
+  uint32_t facenum = 0;
+  if (file_size >= 80ul + 4ul) {
+    memcpy(&facenum, data + 80, sizeof(uint32_t));
 #if BOOST_ENDIAN_BIG_BYTE
     uint32_byte_swap(facenum);
 #endif
-    if (file_size == static_cast<std::streamoff>(80ul + 4ul + 50ul * facenum)) {
-      binary = true;
-      p->reserve(facenum);
-    }
+    binary = file_size == 80ul + 4ul + 50ul * facenum;
   }
-  f.seekg(0);
 
-  char data[5];
-  f.read(data, 5);
-  if (!binary && !f.eof() && f.good() && !memcmp(data, "solid", 5)) {
-    int i = 0;
-    int lineno = 1;
-    std::array<std::array<double, 3>, 3> vdata;
-    std::string line;
+  if (!binary && file_size >= 5 && !memcmp(data, "solid", 5)) {
+    // The first line holds the solid name. The body is split at "outer loop"
+    // lines, where the parser state is reset anyway, so chunks can be parsed
+    // in parallel and merged in order.
+    const char *end = data + file_size;
+    const char *first_newline = static_cast<const char *>(memchr(data, '\n', file_size));
+    const char *body = first_newline ? first_newline + 1 : end;
+    const auto chunks = TextUtils::split_lines(body, end, [](std::string_view line) {
+      return TextUtils::trim(line) == "outer loop";
+    });
+    std::vector<AsciiStlChunk> results(chunks.size());
+    parallelizable_transform(chunks.begin(), chunks.end(), results.begin(), parse_ascii_stl);
 
-    auto AsciiError = [&](const auto& errstr){
+    size_t lineno = 2;
+    size_t num_vertices = 0;
+    bool reached_end = false;
+    for (const auto& chunk : results) {
+      for (const auto& message : chunk.messages) {
         LOG(message_group::Error, loc, "",
             "STL line %1$s, %2$s line '%3$s' importing file '%4$s'",
-            lineno, errstr, line, filename);
-      };
-
-    std::getline(f, line);
-    bool reached_end = false;
-    while (!f.eof()) {
-      lineno++;
-      std::getline(f, line);
-      boost::trim(line);
-      boost::smatch results;
-
-      if (line.length() == 0 || boost::regex_search(line, ex_sfe)) {
-        continue;
-      } else if (boost::regex_search(line, ex_outer)) {
-        i = 0;
-        continue;
-      } else if (boost::regex_search(line, ex_loopend)) {
-        if (i < 3) {
-          AsciiError("missing vertex");
-        }
-        continue;
-      } else if (boost::regex_search(line, ex_endsolid)) {
+            lineno + message.line, message.error, message.text, filename);
+      }
+      if (chunk.failed) return new PolySet(3);
+      num_vertices += chunk.vertices.size();
+      lineno += chunk.lines;
+      if (chunk.reached_end) {
         reached_end = true;
         break;
-      } else if (i >= 3) {
-        AsciiError("extra vertex");
-        return new PolySet(3);
-      } else if (boost::regex_search(line, results, ex_vertices) &&
-                 results.size() >= 4) {
-        try {
-          for (int v = 0; v < 3; ++v) {
-            vdata.at(i).at(v) =
-              boost::lexical_cast<double>(results[v + 1]);
-          }
-          if (++i == 3) {
-            p->append_poly(3);
-            p->append_vertex(vdata[0][0], vdata[0][1], vdata[0][2]);
-            p->append_vertex(vdata[1][0], vdata[1][1], vdata[1][2]);
-            p->append_vertex(vdata[2][0], vdata[2][1], vdata[2][2]);
-          }
-        } catch (const boost::bad_lexical_cast& blc) {
-          AsciiError("can't parse vertex");
-          return new PolySet(3);
-        }
       }
     }
+
+    p->reserve(num_vertices / 3);
+    p->reserve_vertices(num_vertices);
+    for (const auto& chunk : results) {
+      for (size_t v = 0; v < chunk.vertices.size(); v += 3) {
+        p->append_poly(3);
+        p->append_vertex(chunk.vertices[v]);
+        p->append_vertex(chunk.vertices[v + 1]);
+        p->append_vertex(chunk.vertices[v + 2]);
+      }
+      if (chunk.reached_end) break;
+    }
+
     if (!reached_end) {
-      AsciiError("file incomplete");
+      const char *last_line = end;
+      while (last_line != data && last_line[-1] != '\n') --last_line;
+      const std::string line(TextUtils::trim(std::string_view(last_line, end - last_line)));
+      LOG(message_group::Error, loc, "",
+          "STL line %1$s, %2$s line '%3$s' importing file '%4$s'",
+          std::count(data, end, '\n') + 1, "file incomplete", line, filename);
     }
-  } else if (binary && !f.eof() && f.good()) {
-    try {
-      f.ignore(80 - 5 + 4);
-      while (!f.eof() ) {
-        stl_facet facet;
-        try {
-          read_stl_facet(f, facet);
-        } catch (const std::ios_base::failure& ex) {
-          if (f.eof()) break;
-          throw;
-        }
+  } else if (binary) {
+    // Facets are read and welded in chunks, in parallel where available, and
+    // the chunks' vertices are then welded into one shared vertex buffer.
+    const char *facets = data + 80 + 4;
+    const size_t chunk_facets = is_parallelizable() ? STL_FACET_CHUNK : std::max<size_t>(facenum, 1);
+    std::vector<std::pair<const char *, const char *>> chunks;
+    for (size_t first = 0; first < facenum; first += chunk_facets) {
+      const size_t last = std::min<size_t>(first + chunk_facets, facenum);
+      chunks.emplace_back(facets + first * STL_FACET_NUMBYTES, facets + last * STL_FACET_NUMBYTES);
+    }
+    std::vector<BinaryStlChunk> results(chunks.size());
+    parallelizable_transform(chunks.begin(), chunks.end(), results.begin(), [](const auto& chunk) {
+      return read_binary_stl(chunk.first, chunk.second);
+    });
+
+    p->reserve(facenum);
+    if (results.size() == 1) {
+      p->reserve_vertices(results[0].vertices.size());
+      for (const auto& v : results[0].vertices) p->add_vertex(v.toVector());
+      for (size_t i = 0; i < results[0].indices.size(); i += 3) {
         p->append_poly(3);
-        p->append_vertex(facet.data.x1, facet.data.y1, facet.data.z1);
-        p->append_vertex(facet.data.x2, facet.data.y2, facet.data.z2);
-        p->append_vertex(facet.data.x3, facet.data.y3, facet.data.z3);
+        p->append_index(results[0].indices[i]);
+        p->append_index(results[0].indices[i + 1]);
+        p->append_index(results[0].indices[i + 2]);
       }
-    } catch (const std::ios_base::failure& ex) {
-      int64_t offset = -1;
-      try { offset = f.tellg(); } catch (...) {}
-      if (offset < 0) {
-        LOG(message_group::Error, loc, "",
-            "Binary STL '%1$s' error: %3$s",
-            filename, ex.what());
-      } else {
-        LOG(message_group::Error, loc, "",
-            "Binary STL '%1$s' error at byte %2$s: %3$s",
-            filename, offset, ex.what());
+    } else {
+      VertexWelder welder(facenum / 2);
+      std::vector<uint32_t> remap;
+      for (auto& chunk : results) {
+        remap.resize(chunk.vertices.size());
+        for (size_t i = 0; i < chunk.vertices.size(); ++i) remap[i] = welder.lookup(chunk.vertices[i]);
+        for (auto& index : chunk.indices) index = remap[index];
+        std::vector<VertexKey>().swap(chunk.vertices);
+      }
+      p->reserve_vertices(welder.vertices.size());
+      for (const auto& v : welder.vertices) p->add_vertex(v.toVector());
+      for (const auto& chunk : results) {
+        for (size_t i = 0; i < chunk.indices.size(); i += 3) {
+          p->append_poly(3);
+          p->append_index(chunk.indices[i]);
+          p->append_index(chunk.indices[i + 1]);
+          p->append_index(chunk.indices[i + 2]);
+        }
       }
-      return new PolySet(3);
     }
   } else {
     LOG(message_group::Error, loc, "",
@@ -43,10 +43,19 @@
 #include "FontCache.h"
 #include "OffscreenView.h"
 #include "GeometryEvaluator.h"
+#include "GeometryDiskCache.h"
 #include "RenderStatistic.h"
+#include "Profiler.h"
+#ifdef ENABLE_TEST_HOOKS
+#include "IncrementalInstantiation.h"
+#include "InstantiationCache.h"
+#endif
 #include "ParameterObject.h"
 #include "ParameterSet.h"
 #include "openscad_mimalloc.h"
+#include <algorithm>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 #include <fstream>
@@ -73,6 +82,9 @@
 #ifdef _WIN32
 #include <io.h>
 #include <fcntl.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
 #endif
 
 #ifdef __APPLE__
@@ -98,31 +110,48 @@ using boost::is_any_of;
 
 std::string commandline_commands;
 static bool arg_info = false;
+// Set while exporting animation frames whose summary would be overwritten by a later frame
+static bool skip_summary_file = false;
 static std::string arg_colorscheme;
+#ifdef ENABLE_TEST_HOOKS
+// An earlier version of the input file, for testing which objects incremental evaluation reuses
+static std::string arg_previous_version;
+#endif
 
+/*!
+   Captures messages into one or more echo output files while installed.
+   With tee set, messages are also printed to the console as usual.
+ */
 class Echostream
 {
 public:
-  Echostream(std::ostream& stream) : stream(stream)
+  Echostream(bool tee) : tee(tee)
   {
     set_output_handler(&Echostream::output, nullptr, this);
   }
-  Echostream(const std::string& filename) : fstream(filename), stream(fstream)
+  void add(std::ostream& stream)
   {
-    set_output_handler(&Echostream::output, nullptr, this);
+    streams.push_back(&stream);
+  }
+  void add(const std::string& filename)
+  {
+    fstreams.push_back(std::make_unique<std::ofstream>(filename));
+    streams.push_back(fstreams.back().get());
   }
   static void output(const Message& msgObj, void *userdata)
   {
     auto self = static_cast<Echostream *>(userdata);
-    self->stream << msgObj.str() << "\n";
+    for (auto stream : self->streams) *stream << msgObj.str() << "\n";
+    if (self->tee) std::cerr << msgObj.str() << "\n";
   }
   ~Echostream() {
-    if (fstream.is_open()) fstream.close();
+    set_output_handler(nullptr, nullptr, nullptr);
   }
 
 private:
-  std::ofstream fstream;
-  std::ostream& stream;
+  bool tee;
+  std::vector<std::unique_ptr<std::ofstream>> fstreams;
+  std::vector<std::ostream *> streams;
 };
 
 static void help(const char *arg0, const po::options_description& desc, bool failure = false)
@@ -315,8 +344,7 @@ struct CommandLine
 {
   const bool is_stdin;
   const std::string& filename;
-  const bool is_stdout;
-  std::string output_file;
+  const std::vector<std::string> output_files;
   const fs::path& original_path;
   const std::string& parameterFile;
   const std::string& setName;
@@ -324,6 +352,7 @@ struct CommandLine
   const Camera& camera;
   const boost::optional<FileFormat> export_format;
   unsigned animate_frames;
+  unsigned animate_jobs;
   const std::vector<std::string> summaryOptions;
   const std::string summaryFile;
 };
@@ -334,46 +363,152 @@ struct RenderVariables
   double time;
 };
 
-int do_export(const CommandLine& cmd, const RenderVariables& render_variables, FileFormat curFormat, SourceFile *root_file);
+// One output file of a command line run
+struct ExportTarget
+{
+  bool is_stdout;
+  std::string output_file;
+  FileFormat format;
+};
+
+int do_export(const CommandLine& cmd, const RenderVariables& render_variables, const std::vector<ExportTarget>& targets,
+              SourceFile *root_file, unique_ptr<Echostream>& echostream);
 
-int cmdline(const CommandLine& cmd)
+/*!
+   Resolves the format of an output file, and checks its output directory.
+   Returns false if the file cannot be exported.
+ */
+static bool resolveTarget(const CommandLine& cmd, const std::string& output, ExportTarget& target)
 {
   ExportFileFormatOptions exportFileFormatOptions;
-  FileFormat export_format;
+
+  target.is_stdout = output == "-";
+  target.output_file = target.is_stdout ? "<stdout>" : output;
 
   // Determine output file format and assign it to formatName
   if (cmd.export_format.is_initialized()) {
-    export_format = cmd.export_format.get();
+    target.format = cmd.export_format.get();
   } else {
     // else extract format from file extension
-    const auto path = fs::path(cmd.output_file);
+    const auto path = fs::path(target.output_file);
     std::string suffix = path.has_extension() ? path.extension().generic_string().substr(1) : "";
     boost::algorithm::to_lower(suffix);
     const auto format_iter = exportFileFormatOptions.exportFileFormats.find(suffix);
     if (format_iter != exportFileFormatOptions.exportFileFormats.end()) {
-      export_format = format_iter->second;
+      target.format = format_iter->second;
     } else {
       LOG("Either add a valid suffix or specify one using the --export-format option.");
-      return 1;
+      return false;
     }
   }
 
   // Do some minimal checking of output directory before rendering (issue #432)
-  auto output_dir = fs::path(cmd.output_file).parent_path();
+  auto output_dir = fs::path(target.output_file).parent_path();
   if (output_dir.empty()) {
     // If output_file_str has no directory prefix, set output directory to current directory.
     output_dir = fs::current_path();
   }
   if (!fs::is_directory(output_dir)) {
-    LOG("\n'%1$s' is not a directory for output file %2$s - Skipping\n", output_dir.generic_string(), cmd.output_file);
-    return 1;
+    LOG("\n'%1$s' is not a directory for output file %2$s - Skipping\n", output_dir.generic_string(), target.output_file);
+    return false;
+  }
+  return true;
+}
+
+/*!
+   Exports animation frames with the given number of worker processes.
+
+   The workers are forked before any frame is evaluated: the parallel backends
+   (TBB, also used by Manifold) start thread pools on first use, and a child
+   forked from a process with running pools can deadlock in them. This process
+   is the first worker, and each worker renders every jobs-th frame. Workers do
+   not share in-memory caches, but with a geometry cache directory they share
+   what they compute. Processes are used rather than threads, since evaluation
+   changes the working directory of the process.
+ */
+static int exportFramesInParallel(unsigned frames, unsigned jobs, const std::function<int(unsigned)>& exportFrame)
+{
+#ifdef _WIN32
+  for (unsigned frame = 0; frame < frames; ++frame) {
+    const int rc = exportFrame(frame);
+    if (rc != 0) return rc;
+  }
+  return 0;
+#else
+  auto exportFrames = [&](unsigned job) {
+    int r = 0;
+    for (unsigned frame = job; frame < frames && r == 0; frame += jobs) {
+      // Only the last frame writes the summary file, as if frames were exported in order
+      skip_summary_file = frame != frames - 1;
+      r = exportFrame(frame);
+    }
+    skip_summary_file = false;
+    return r;
+  };
+
+  std::cout.flush();
+  std::cerr.flush();
+  fflush(nullptr);
+
+  // Frames already run in parallel, so workers don't also evaluate subtrees concurrently
+  setenv("OPENSCAD_NO_PARALLEL", "1", 1);
+  std::vector<pid_t> workers;
+  std::vector<unsigned> serialjobs{0};
+  for (unsigned job = 1; job < jobs; ++job) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+      const int r = exportFrames(job);
+      std::cout.flush();
+      std::cerr.flush();
+      fflush(nullptr);
+      _exit(r == 0 ? 0 : 1);
+    } else if (pid < 0) {
+      LOG(message_group::Warning, "Could not start animation worker process, exporting its frames serially.");
+      serialjobs.push_back(job);
+    } else {
+      workers.push_back(pid);
+    }
+  }
+  int rc = 0;
+  for (const auto job : serialjobs) rc |= exportFrames(job);
+  for (const auto pid : workers) {
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) rc = 1;
+  }
+  return rc;
+#endif
+}
+
+/*!
+   Parses the input file once and exports it to all output files. Outputs are
+   grouped by the value of $preview they need, and each group is evaluated once
+   (per animation frame) and fanned out to its exporters.
+ */
+int cmdline(const CommandLine& cmd)
+{
+  int rc = 0;
+  std::vector<ExportTarget> targets;
+  for (const auto& output : cmd.output_files) {
+    ExportTarget target;
+    if (resolveTarget(cmd, output, target)) targets.push_back(target);
+    else rc = 1;
   }
+  if (targets.empty()) return rc;
 
   set_render_color_scheme(arg_colorscheme, true);
 
-  shared_ptr<Echostream> echostream;
-  if (export_format == FileFormat::ECHO) {
-    echostream.reset(cmd.is_stdout ? new Echostream(std::cout) : new Echostream(cmd.output_file));
+  // Echo outputs capture messages from parsing and instantiation
+  unique_ptr<Echostream> echostream;
+  for (const auto& target : targets) {
+    if (target.format != FileFormat::ECHO) continue;
+    if (!echostream) {
+      const bool tee = std::any_of(targets.begin(), targets.end(), [](const ExportTarget& t) {
+        return t.format != FileFormat::ECHO;
+      });
+      echostream = std::make_unique<Echostream>(tee);
+    }
+    if (target.is_stdout) echostream->add(std::cout);
+    else echostream->add(target.output_file);
   }
 
   std::string text;
@@ -418,45 +553,101 @@ int cmdline(const CommandLine& cmd)
 
   root_file->handleDependencies();
 
-  RenderVariables render_variables;
-  render_variables.preview = canPreview(export_format) ? (cmd.viewOptions.renderer == RenderType::OPENCSG || cmd.viewOptions.renderer == RenderType::THROWNTOGETHER) : false;
+  // Group outputs by $preview; the group holding echo outputs is evaluated first,
+  // so its instantiation is captured by the echo stream.
+  const bool previewRenderer = cmd.viewOptions.renderer == RenderType::OPENCSG || cmd.viewOptions.renderer == RenderType::THROWNTOGETHER;
+  std::vector<std::pair<bool, std::vector<ExportTarget>>> groups;
+  for (const auto& target : targets) {
+    const bool preview = canPreview(target.format) && previewRenderer;
+    auto group = std::find_if(groups.begin(), groups.end(), [preview](const auto& g) { return g.first == preview; });
+    if (group == groups.end()) group = groups.insert(groups.end(), {preview, {}});
+    group->second.push_back(target);
+  }
+  std::stable_partition(groups.begin(), groups.end(), [](const auto& group) {
+    return std::any_of(group.second.begin(), group.second.end(), [](const ExportTarget& target) {
+      return target.format == FileFormat::ECHO;
+    });
+  });
 
   if (cmd.animate_frames == 0) {
+    RenderVariables render_variables;
     render_variables.time = 0;
-    return do_export(cmd, render_variables, export_format, root_file);
+    for (const auto& group : groups) {
+      render_variables.preview = group.first;
+      rc |= do_export(cmd, render_variables, group.second, root_file, echostream);
+    }
+    return rc;
   } else {
     // export the requested number of animated frames
-    for (unsigned frame = 0; frame < cmd.animate_frames; ++frame) {
+    auto exportFrame = [&](unsigned frame) -> int {
+      RenderVariables render_variables;
       render_variables.time = frame * (1.0 / cmd.animate_frames);
 
       std::ostringstream oss;
       oss << std::setw(5) << std::setfill('0') << frame;
 
-      auto frame_file = fs::path(cmd.output_file);
-      auto extension = frame_file.extension();
-      frame_file.replace_extension();
-      frame_file += oss.str();
-      frame_file.replace_extension(extension);
-      string frame_str = frame_file.generic_string();
-
       LOG("Exporting %1$s...", cmd.filename);
 
-      CommandLine frame_cmd = cmd;
-      frame_cmd.output_file = frame_str;
+      for (const auto& group : groups) {
+        std::vector<ExportTarget> frame_targets = group.second;
+        for (auto& target : frame_targets) {
+          auto frame_file = fs::path(target.output_file);
+          auto extension = frame_file.extension();
+          frame_file.replace_extension();
+          frame_file += oss.str();
+          frame_file.replace_extension(extension);
+          target.output_file = frame_file.generic_string();
+        }
 
-      int r = do_export(frame_cmd, render_variables, export_format, root_file);
+        render_variables.preview = group.first;
+        int r = do_export(cmd, render_variables, frame_targets, root_file, echostream);
+        if (r != 0) {
+          return r;
+        }
+      }
+      return 0;
+    };
+
+    // Echo outputs collect the messages of all frames in order, so they keep frames sequential
+    const unsigned jobs = echostream ? 1 : std::min(cmd.animate_jobs, cmd.animate_frames);
+    if (jobs > 1) return rc | exportFramesInParallel(cmd.animate_frames, jobs, exportFrame);
+
+    for (unsigned frame = 0; frame < cmd.animate_frames; ++frame) {
+      int r = exportFrame(frame);
       if (r != 0) {
         return r;
       }
     }
 
-    return 0;
+    return rc;
   }
 }
 
-int do_export(const CommandLine& cmd, const RenderVariables& render_variables, FileFormat curFormat, SourceFile *root_file)
+static bool isExport3D(FileFormat format)
+{
+  return format == FileFormat::ASCIISTL ||
+         format == FileFormat::STL ||
+         format == FileFormat::OBJ ||
+         format == FileFormat::OFF ||
+         format == FileFormat::WRL ||
+         format == FileFormat::AMF ||
+         format == FileFormat::_3MF ||
+         format == FileFormat::NEFDBG ||
+         format == FileFormat::NEF3;
+}
+
+static bool isExport2D(FileFormat format)
+{
+  return format == FileFormat::DXF || format == FileFormat::SVG || format == FileFormat::PDF;
+}
+
+/*!
+   Instantiates root_file once and writes all targets from the resulting node
+   tree, evaluating geometry only if some target needs it.
+ */
+int do_export(const CommandLine& cmd, const RenderVariables& render_variables, const std::vector<ExportTarget>& targets,
+              SourceFile *root_file, unique_ptr<Echostream>& echostream)
 {
-  auto filename_str = fs::path(cmd.output_file).generic_string();
   auto fpath = fs::absolute(fs::path(cmd.filename));
   auto fparent = fpath.parent_path();
 
@@ -473,7 +664,18 @@ int do_export(const CommandLine& cmd, const RenderVariables& render_variables, F
 
   AbstractNode::resetIndexCounter();
   std::shared_ptr<const FileContext> file_context;
+#ifdef ENABLE_TEST_HOOKS
+  InstantiationCache instantiation_cache; // must outlive the nodes it reuses
+  std::ostringstream inputs;
+  inputs << render_variables.preview << ' ' << render_variables.time;
+  auto absolute_root_node = arg_previous_version.empty() || cmd.is_stdin ?
+    root_file->instantiate(*builtin_context, &file_context) :
+    TestHooks::instantiateAfterPreviousVersion(fs::absolute(fs::path(arg_previous_version), cmd.original_path),
+                                               fs::absolute(fs::path(cmd.filename), cmd.original_path), inputs.str(),
+                                               root_file, *builtin_context, instantiation_cache, &file_context);
+#else
   auto absolute_root_node = root_file->instantiate(*builtin_context, &file_context);
+#endif
   Camera camera = cmd.camera;
   if (file_context) {
     camera.updateView(file_context, true);
@@ -493,115 +695,127 @@ int do_export(const CommandLine& cmd, const RenderVariables& render_variables, F
   }
   Tree tree(root_node, fparent.string());
 
-  if (curFormat == FileFormat::CSG) {
-    // https://github.com/openscad/openscad/issues/128
-    // When I use the csg ouptput from the command line the paths in 'import'
-    // statements become relative. But unfortunately they become relative to
-    // the current working dir and neither to the location of the input nor
-    // the output.
-    fs::current_path(fparent); // Force exported filenames to be relative to document path
-    with_output(cmd.is_stdout, filename_str, [&tree, root_node](std::ostream& stream) {
-      stream << tree.getString(*root_node, "\t") << "\n";
-    });
-    fs::current_path(cmd.original_path);
-  } else if (curFormat == FileFormat::AST) {
-    fs::current_path(fparent); // Force exported filenames to be relative to document path
-    with_output(cmd.is_stdout, filename_str, [root_file](std::ostream& stream) {
-      stream << root_file->dump("");
-    });
-    fs::current_path(cmd.original_path);
-  } else if (curFormat == FileFormat::PARAM) {
-    with_output(cmd.is_stdout, filename_str, [&root_file, &fpath](std::ostream& stream) {
-      export_param(root_file, fpath, stream);
-    });
-  } else if (curFormat == FileFormat::TERM) {
-    CSGTreeEvaluator csgRenderer(tree);
-    auto root_raw_term = csgRenderer.buildCSGTree(*root_node);
-    with_output(cmd.is_stdout, filename_str, [root_raw_term](std::ostream& stream) {
-      if (!root_raw_term || root_raw_term->isEmptySet()) {
-        stream << "No top-level CSG object\n";
-      } else {
-        stream << root_raw_term->dump() << "\n";
-      }
-    });
-  } else if (curFormat == FileFormat::ECHO) {
-    // echo -> don't need to evaluate any geometry
-  } else {
+  // echo -> don't need to evaluate any geometry. Echo outputs capture instantiation
+  // only, except for animations, where they collect the messages of all frames.
+  if (cmd.animate_frames == 0) echostream.reset();
+
+  bool needsGeometry = false;
+  for (const auto& target : targets) {
+    const auto filename_str = fs::path(target.output_file).generic_string();
+    if (target.format == FileFormat::CSG) {
+      // https://github.com/openscad/openscad/issues/128
+      // When I use the csg ouptput from the command line the paths in 'import'
+      // statements become relative. But unfortunately they become relative to
+      // the current working dir and neither to the location of the input nor
+      // the output.
+      fs::current_path(fparent); // Force exported filenames to be relative to document path
+      with_output(target.is_stdout, filename_str, [&tree, root_node](std::ostream& stream) {
+        stream << tree.getString(*root_node, "\t") << "\n";
+      });
+      fs::current_path(cmd.original_path);
+    } else if (target.format == FileFormat::AST) {
+      fs::current_path(fparent); // Force exported filenames to be relative to document path
+      with_output(target.is_stdout, filename_str, [root_file](std::ostream& stream) {
+        stream << root_file->dump("");
+      });
+      fs::current_path(cmd.original_path);
+    } else if (target.format == FileFormat::PARAM) {
+      with_output(target.is_stdout, filename_str, [&root_file, &fpath](std::ostream& stream) {
+        export_param(root_file, fpath, stream);
+      });
+    } else if (target.format == FileFormat::TERM) {
+      CSGTreeEvaluator csgRenderer(tree);
+      auto root_raw_term = csgRenderer.buildCSGTree(*root_node);
+      with_output(target.is_stdout, filename_str, [root_raw_term](std::ostream& stream) {
+        if (!root_raw_term || root_raw_term->isEmptySet()) {
+          stream << "No top-level CSG object\n";
+        } else {
+          stream << root_raw_term->dump() << "\n";
+        }
+      });
+    } else if (target.format != FileFormat::ECHO) {
+      needsGeometry = true;
+    }
+  }
+  if (!needsGeometry) return 0;
+
 #ifdef ENABLE_CGAL
 
-    // start measuring render time
-    RenderStatistic renderStatistic;
-    GeometryEvaluator geomevaluator(tree);
-    unique_ptr<OffscreenView> glview;
-    shared_ptr<const Geometry> root_geom;
-    if ((curFormat == FileFormat::ECHO || curFormat == FileFormat::PNG) && (cmd.viewOptions.renderer == RenderType::OPENCSG || cmd.viewOptions.renderer == RenderType::THROWNTOGETHER)) {
-      // OpenCSG or throwntogether png -> just render a preview
-      glview = prepare_preview(tree, cmd.viewOptions, camera);
-      if (!glview) return 1;
-    } else {
-      // Force creation of CGAL objects (for testing)
-      root_geom = geomevaluator.evaluateGeometry(*tree.root(), true);
-      if (root_geom) {
-        if (cmd.viewOptions.renderer == RenderType::CGAL && root_geom->getDimension() == 3) {
-          if (auto geomlist = dynamic_pointer_cast<const GeometryList>(root_geom)) {
-            auto flatlist = geomlist->flatten();
-            for (auto& child : flatlist) {
-              if (child.second->getDimension() == 3) {
-                child.second = CGALUtils::getNefPolyhedronFromGeometry(child.second);
-              }
+  // start measuring render time
+  RenderStatistic::resetCounts();
+  RenderStatistic renderStatistic;
+  GeometryEvaluator geomevaluator(tree);
+  unique_ptr<OffscreenView> glview;
+  shared_ptr<const Geometry> root_geom;
+  const bool previewRenderer = cmd.viewOptions.renderer == RenderType::OPENCSG || cmd.viewOptions.renderer == RenderType::THROWNTOGETHER;
+  const bool needsPreview = previewRenderer && std::any_of(targets.begin(), targets.end(), [](const ExportTarget& target) {
+    return target.format == FileFormat::PNG;
+  });
+  const bool needsRender = std::any_of(targets.begin(), targets.end(), [previewRenderer](const ExportTarget& target) {
+    return isExport3D(target.format) || isExport2D(target.format) || (target.format == FileFormat::PNG && !previewRenderer);
+  });
+  if (needsPreview) {
+    // OpenCSG or throwntogether png -> just render a preview
+    glview = prepare_preview(tree, cmd.viewOptions, camera);
+    if (!glview) return 1;
+  }
+  if (needsRender) {
+    // Force creation of CGAL objects (for testing)
+    root_geom = geomevaluator.evaluateGeometry(*tree.root(), true);
+    if (root_geom) {
+      if (cmd.viewOptions.renderer == RenderType::CGAL && root_geom->getDimension() == 3) {
+        if (auto geomlist = dynamic_pointer_cast<const GeometryList>(root_geom)) {
+          auto flatlist = geomlist->flatten();
+          for (auto& child : flatlist) {
+            if (child.second->getDimension() == 3) {
+              child.second = CGALUtils::getNefPolyhedronFromGeometry(child.second);
             }
-            root_geom.reset(new GeometryList(flatlist));
-          } else {
-            root_geom = CGALUtils::getNefPolyhedronFromGeometry(root_geom);
           }
-          LOG("Converted to Nef polyhedron");
+          root_geom.reset(new GeometryList(flatlist));
+        } else {
+          root_geom = CGALUtils::getNefPolyhedronFromGeometry(root_geom);
         }
-      } else {
-        root_geom.reset(new CGAL_Nef_polyhedron());
-      }
-    }
-    if (curFormat == FileFormat::ASCIISTL ||
-        curFormat == FileFormat::STL ||
-        curFormat == FileFormat::OBJ ||
-        curFormat == FileFormat::OFF ||
-        curFormat == FileFormat::WRL ||
-        curFormat == FileFormat::AMF ||
-        curFormat == FileFormat::_3MF ||
-        curFormat == FileFormat::NEFDBG ||
-        curFormat == FileFormat::NEF3) {
-      if (!checkAndExport(root_geom, 3, curFormat, cmd.is_stdout, filename_str)) {
-        return 1;
+        LOG("Converted to Nef polyhedron");
       }
+    } else {
+      root_geom.reset(new CGAL_Nef_polyhedron());
     }
+  }
 
-    if (curFormat == FileFormat::DXF || curFormat == FileFormat::SVG || curFormat == FileFormat::PDF) {
-      if (!checkAndExport(root_geom, 2, curFormat, cmd.is_stdout, filename_str)) {
-        return 1;
-      }
+  // Exports stay serial: exporters switch the process-wide numeric locale, and
+  // reading lazily evaluated geometry may update it
+  int rc = 0;
+  for (const auto& target : targets) {
+    if (!isExport3D(target.format) && !isExport2D(target.format)) continue;
+    if (!checkAndExport(root_geom, isExport3D(target.format) ? 3 : 2, target.format, target.is_stdout,
+                        fs::path(target.output_file).generic_string())) {
+      rc = 1;
     }
+  }
 
-    if (curFormat == FileFormat::PNG) {
-      bool success = true;
-      bool wrote = with_output(cmd.is_stdout, filename_str, [&success, &root_geom, &cmd, &camera, &glview](std::ostream& stream) {
-        if (cmd.viewOptions.renderer == RenderType::CGAL || cmd.viewOptions.renderer == RenderType::GEOMETRY) {
-          success = export_png(root_geom, cmd.viewOptions, camera, stream);
-        } else {
-          success = export_png(*glview, stream);
-        }
-      }, std::ios::out | std::ios::binary);
-      if (!success || !wrote) {
-        return 1;
+  for (const auto& target : targets) {
+    if (target.format != FileFormat::PNG) continue;
+    bool success = true;
+    bool wrote = with_output(target.is_stdout, fs::path(target.output_file).generic_string(), [&success, &root_geom, &cmd, &camera, &glview](std::ostream& stream) {
+      if (cmd.viewOptions.renderer == RenderType::CGAL || cmd.viewOptions.renderer == RenderType::GEOMETRY) {
+        success = export_png(root_geom, cmd.viewOptions, camera, stream);
+      } else {
+        success = export_png(*glview, stream);
       }
+    }, std::ios::out | std::ios::binary);
+    if (!success || !wrote) {
+      rc = 1;
     }
+  }
 
+  if (cmd.summaryFile.empty() || !skip_summary_file) {
     renderStatistic.printAll(root_geom, camera, cmd.summaryOptions, cmd.summaryFile);
+  }
+  return rc;
 #else
-    LOG("OpenSCAD has been compiled without CGAL support!\n");
-    return 1;
+  LOG("OpenSCAD has been compiled without CGAL support!\n");
+  return 1;
 #endif // ifdef ENABLE_CGAL
-
-  }
-  return 0;
 }
 
 #ifdef OPENSCAD_QTGUI
@@ -955,11 +1169,16 @@ int main(int argc, char **argv)
     ("render", po::value<string>()->implicit_value(""), "for full geometry evaluation when exporting png")
     ("preview", po::value<string>()->implicit_value(""), "[=throwntogether] -for ThrownTogether preview png")
     ("animate", po::value<unsigned>(), "export N animated frames")
+    ("animate-jobs", po::value<unsigned>(), "=n -export animated frames with n worker processes (default 1)")
     ("view", po::value<CommaSeparatedVector>(), ("=view options: " + boost::algorithm::join(viewOptions.names(), " | ")).c_str())
     ("projection", po::value<string>(), "=(o)rtho or (p)erspective when exporting png")
     ("csglimit", po::value<unsigned int>(), "=n -stop rendering at n CSG elements when exporting png")
     ("summary", po::value<vector<string>>(), "enable additional render summary and statistics: all | cache | time | camera | geometry | bounding-box | area")
     ("summary-file", po::value<string>(), "output summary information in JSON format to the given file, using '-' outputs to stdout")
+    ("profile", po::value<string>(), "=file -record the time spent per node, function and module and write it as Chrome trace (.json) or folded stacks (.folded)")
+    ("profile-summary", "print call counts, total and self time, and allocations per function and module")
+    ("geometry-cache-dir", po::value<string>(), "=dir -persist evaluated geometry in dir and reuse it across runs")
+    ("geometry-cache-size", po::value<size_t>(), "=n -maximum size of the geometry cache directory in MB (default 1024)")
     ("colorscheme", po::value<string>(), ("=colorscheme: " +
                                           str_join(ColorMap::inst()->colorSchemeNames(), " | ",
                                                    [](const std::string& colorScheme) {
@@ -983,6 +1202,9 @@ int main(int argc, char **argv)
   hidden.add_options()
 #ifdef Q_OS_MACX
   ("psn", po::value<string>(), "process serial number")
+#endif
+#ifdef ENABLE_TEST_HOOKS
+  ("previous-version", po::value<string>(), "=file -instantiate file first and reuse its unchanged top level objects, for testing incremental evaluation")
 #endif
   ("input-file", po::value<vector<string>>(), "input file");
 
@@ -1096,6 +1318,13 @@ int main(int argc, char **argv)
     }
   }
 
+  if (vm.count("geometry-cache-size")) {
+    GeometryDiskCache::instance()->setMaxSizeMB(vm["geometry-cache-size"].as<size_t>());
+  }
+  if (vm.count("geometry-cache-dir")) {
+    GeometryDiskCache::instance()->setDirectory(vm["geometry-cache-dir"].as<string>());
+  }
+
   string parameterFile;
   if (vm.count("p")) {
     if (!parameterFile.empty()) {
@@ -1121,6 +1350,12 @@ int main(int argc, char **argv)
     arg_colorscheme = vm["colorscheme"].as<string>();
   }
 
+#ifdef ENABLE_TEST_HOOKS
+  if (vm.count("previous-version")) {
+    arg_previous_version = vm["previous-version"].as<string>();
+  }
+#endif
+
   ExportFileFormatOptions exportFileFormatOptions;
   if (vm.count("export-format")) {
     const auto format = vm["export-format"].as<string>();
@@ -1137,6 +1372,10 @@ int main(int argc, char **argv)
   if (vm.count("animate")) {
     animate_frames = vm["animate"].as<unsigned>();
   }
+  unsigned animate_jobs = 1;
+  if (vm.count("animate-jobs")) {
+    animate_jobs = std::max(1u, vm["animate-jobs"].as<unsigned>());
+  }
 
   Camera camera = get_camera(vm);
 
@@ -1152,6 +1391,11 @@ int main(int argc, char **argv)
     }
   }
 
+  std::string profile_file;
+  if (vm.count("profile")) {
+    profile_file = fs::absolute(vm["profile"].as<string>()).generic_string();
+  }
+
   auto cmdlinemode = false;
   if (!output_files.empty()) { // cmd-line mode
     cmdlinemode = true;
@@ -1166,33 +1410,36 @@ int main(int argc, char **argv)
       if (arg_info) {
         rc = info();
       } else {
-        for (const auto& filename : output_files) {
-          const bool is_stdin = inputFiles[0] == "-";
-          const std::string input_file = is_stdin ? "<stdin>" : inputFiles[0];
-          const bool is_stdout = filename == "-";
-          const std::string output_file = is_stdout ? "<stdout>" : filename;
-          const CommandLine cmd{
-            is_stdin,
-            input_file,
-            is_stdout,
-            output_file,
-            original_path,
-            parameterFile,
-            parameterSet,
-            viewOptions,
-            camera,
-            export_format,
-            animate_frames,
-            vm.count("summary") ? vm["summary"].as<std::vector<std::string>>() : std::vector<std::string>{},
-            vm.count("summary-file") ? vm["summary-file"].as<std::string>() : ""
-          };
-          rc |= cmdline(cmd);
-        }
+        if (!profile_file.empty() || vm.count("profile-summary")) Profiler::instance().enable();
+        const bool is_stdin = inputFiles[0] == "-";
+        const std::string input_file = is_stdin ? "<stdin>" : inputFiles[0];
+        const CommandLine cmd{
+          is_stdin,
+          input_file,
+          output_files,
+          original_path,
+          parameterFile,
+          parameterSet,
+          viewOptions,
+          camera,
+          export_format,
+          animate_frames,
+          animate_jobs,
+          vm.count("summary") ? vm["summary"].as<std::vector<std::string>>() : std::vector<std::string>{},
+          vm.count("summary-file") ? vm["summary-file"].as<std::string>() : ""
+        };
+        rc |= cmdline(cmd);
       }
     } catch (const HardWarningException&) {
       rc = 1;
     }
 
+    if (!profile_file.empty() && !Profiler::instance().write(profile_file)) {
+      LOG("Error writing profile to %1$s", profile_file);
+      rc = 1;
+    }
+    if (vm.count("profile-summary")) Profiler::instance().printSummary();
+
     if (deps_output_file) {
       std::string deps_out(deps_output_file);
       const vector<std::string>& geom_out(output_files);
@@ -1,4 +1,7 @@
 #include "hash.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 #include <boost/functional/hash.hpp>
 
 namespace std {
@@ -33,3 +36,184 @@ size_t hash_value(Eigen::Matrix<int64_t, 3, 1> const& v) {
   return seed;
 }
 }
+
+namespace {
+
+constexpr uint64_t c1 = 0x87c37b91114253d5ULL;
+constexpr uint64_t c2 = 0x4cf5ad432745937fULL;
+
+inline uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t fmix64(uint64_t k)
+{
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+inline uint64_t load64(const unsigned char *p)
+{
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+  return v;
+}
+
+} // namespace
+
+void Hash128::block(uint64_t k1, uint64_t k2)
+{
+  k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+  h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+  k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+  h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+}
+
+Hash128& Hash128::update(const void *data, size_t len)
+{
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  this->length += len;
+  if (this->taillen > 0) {
+    const size_t n = std::min(len, sizeof(this->tail) - this->taillen);
+    std::memcpy(this->tail + this->taillen, bytes, n);
+    this->taillen += n;
+    bytes += n;
+    len -= n;
+    if (this->taillen < sizeof(this->tail)) return *this;
+    block(load64(this->tail), load64(this->tail + 8));
+    this->taillen = 0;
+  }
+  for (; len >= 16; bytes += 16, len -= 16) {
+    block(load64(bytes), load64(bytes + 8));
+  }
+  std::memcpy(this->tail, bytes, len);
+  this->taillen = len;
+  return *this;
+}
+
+std::pair<uint64_t, uint64_t> Hash128::digest() const
+{
+  uint64_t d1 = this->h1, d2 = this->h2;
+  uint64_t k1 = 0, k2 = 0;
+  for (size_t i = this->taillen; i > 8; --i) k2 = (k2 << 8) | this->tail[i - 1];
+  for (size_t i = std::min<size_t>(this->taillen, 8); i > 0; --i) k1 = (k1 << 8) | this->tail[i - 1];
+  if (this->taillen > 8) {
+    k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; d2 ^= k2;
+  }
+  if (this->taillen > 0) {
+    k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; d1 ^= k1;
+  }
+  d1 ^= this->length; d2 ^= this->length;
+  d1 += d2; d2 += d1;
+  d1 = fmix64(d1); d2 = fmix64(d2);
+  d1 += d2; d2 += d1;
+  return {d1, d2};
+}
+
+std::string Hash128::hexdigest() const
+{
+  return hex(digest());
+}
+
+std::string Hash128::hex(const std::pair<uint64_t, uint64_t>& d)
+{
+  static const char digits[] = "0123456789abcdef";
+  std::string hex(32, '0');
+  for (int i = 0; i < 16; ++i) {
+    hex[15 - i] = digits[(d.first >> (4 * i)) & 0xf];
+    hex[31 - i] = digits[(d.second >> (4 * i)) & 0xf];
+  }
+  return hex;
+}
+
+namespace {
+
+constexpr uint32_t sha256_k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline uint32_t rotr32(uint32_t x, int r) { return (x >> r) | (x << (32 - r)); }
+
+} // namespace
+
+Sha256::Sha256()
+  : state{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19}
+{
+}
+
+void Sha256::block(const unsigned char *data)
+{
+  uint32_t w[64];
+  for (int i = 0; i < 16; ++i) {
+    w[i] = (uint32_t(data[4 * i]) << 24) | (uint32_t(data[4 * i + 1]) << 16) |
+           (uint32_t(data[4 * i + 2]) << 8) | uint32_t(data[4 * i + 3]);
+  }
+  for (int i = 16; i < 64; ++i) {
+    const uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    const uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+  uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+  for (int i = 0; i < 64; ++i) {
+    const uint32_t t1 = h + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+    const uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g; g = f; f = e; e = d + t1;
+    d = c; c = b; b = a; a = t1 + t2;
+  }
+  state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+  state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+Sha256& Sha256::update(const void *data, size_t len)
+{
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  this->length += len;
+  if (this->taillen > 0) {
+    const size_t n = std::min(len, sizeof(this->tail) - this->taillen);
+    std::memcpy(this->tail + this->taillen, bytes, n);
+    this->taillen += n;
+    bytes += n;
+    len -= n;
+    if (this->taillen < sizeof(this->tail)) return *this;
+    block(this->tail);
+    this->taillen = 0;
+  }
+  for (; len >= 64; bytes += 64, len -= 64) {
+    block(bytes);
+  }
+  std::memcpy(this->tail, bytes, len);
+  this->taillen = len;
+  return *this;
+}
+
+std::string Sha256::hexdigest() const
+{
+  // Pad a copy, so that more data can still be added to this one
+  Sha256 padded = *this;
+  const uint64_t bits = this->length * 8;
+  const unsigned char pad = 0x80;
+  const unsigned char zero[64] = {};
+  padded.update(&pad, 1);
+  padded.update(zero, (padded.taillen <= 56 ? 56 : 120) - padded.taillen);
+  unsigned char size[8];
+  for (int i = 0; i < 8; ++i) size[i] = static_cast<unsigned char>(bits >> (56 - 8 * i));
+  padded.update(size, sizeof(size));
+  assert(padded.taillen == 0);
+
+  static const char digits[] = "0123456789abcdef";
+  std::string hex(64, '0');
+  for (size_t i = 0; i < 8; ++i) {
+    for (int j = 0; j < 8; ++j) hex[8 * i + j] = digits[(padded.state[i] >> (28 - 4 * j)) & 0xf];
+  }
+  return hex;
+}
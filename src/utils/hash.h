@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <string>
 #include "linalg.h"
 
 using Vector3l = Eigen::Matrix<int64_t, 3, 1>;
@@ -15,3 +18,56 @@ size_t hash_value(Vector3f const& v);
 size_t hash_value(Vector3d const& v);
 size_t hash_value(Vector3l const& v);
 }
+
+/*!
+   Incremental 128-bit non-cryptographic hash (MurmurHash3 x64_128), used to derive
+   compact, content-addressed keys from long strings such as node ID strings.
+   Collisions can be crafted, so keys which are persisted must not rely on it alone.
+ */
+class Hash128
+{
+public:
+  Hash128(uint64_t seed = 0) : h1(seed), h2(seed) {}
+
+  Hash128& update(const void *data, size_t len);
+  Hash128& update(const std::string& str) { return update(str.data(), str.size()); }
+
+  /*! Returns the 128-bit digest as two 64-bit words. Does not modify the state. */
+  [[nodiscard]] std::pair<uint64_t, uint64_t> digest() const;
+  /*! Returns the digest as a 32 character lower case hex string. */
+  [[nodiscard]] std::string hexdigest() const;
+  /*! Formats a digest as a 32 character lower case hex string. */
+  static std::string hex(const std::pair<uint64_t, uint64_t>& digest);
+
+private:
+  void block(uint64_t k1, uint64_t k2);
+
+  uint64_t h1, h2;
+  uint64_t length{0};
+  unsigned char tail[16];
+  size_t taillen{0};
+};
+
+/*!
+   Incremental SHA-256, for digests which end up in persisted keys such as those of
+   the disk cache, where a crafted collision must not be feasible.
+ */
+class Sha256
+{
+public:
+  Sha256();
+
+  Sha256& update(const void *data, size_t len);
+  Sha256& update(const std::string& str) { return update(str.data(), str.size()); }
+
+  /*! Returns the digest as a 64 character lower case hex string. Does not modify the state. */
+  [[nodiscard]] std::string hexdigest() const;
+
+private:
+  void block(const unsigned char *data);
+
+  std::array<uint32_t, 8> state;
+  uint64_t length{0};
+  unsigned char tail[64];
+  size_t taillen{0};
+};
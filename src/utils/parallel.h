@@ -1,11 +1,24 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdlib>
+
 #ifdef ENABLE_TBB
 #include <thrust/transform.h>
 #include <thrust/functional.h>
 #include <thrust/execution_policy.h>
 #endif
 
+// Returns true if the parallelizable_* functions actually run in parallel
+inline bool is_parallelizable()
+{
+#ifdef ENABLE_TBB
+  return !getenv("OPENSCAD_NO_PARALLEL");
+#else
+  return false;
+#endif
+}
+
 template <class InputIterator, class OutputIterator, class Operation>
 void parallelizable_transform(
   const InputIterator begin1, const InputIterator end1,
@@ -1,6 +1,7 @@
 #include "printutils.h"
 #include <sstream>
 #include <cstdio>
+#include <mutex>
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/circular_buffer.hpp>
@@ -32,6 +33,8 @@ int count = 0;
 namespace {
 bool no_throw;
 bool deferred;
+// Messages may be emitted from concurrent geometry evaluation threads
+std::recursive_mutex print_mutex;
 }
 
 void set_output_handler(OutputHandlerFunc *newhandler, OutputHandlerFunc2 *newhandler2, void *userdata)
@@ -76,6 +79,7 @@ void PRINT(const Message& msgObj)
 {
   if (msgObj.msg.empty() && msgObj.group != message_group::Echo) return;
 
+  std::lock_guard<std::recursive_mutex> lock(print_mutex);
   if (print_messages_stack.size() > 0) {
     if (!print_messages_stack.back().empty()) {
       print_messages_stack.back() += "\n";
@@ -99,6 +103,7 @@ void PRINT_NOCACHE(const Message& msgObj)
 
   const auto msg = msgObj.str();
 
+  std::lock_guard<std::recursive_mutex> lock(print_mutex);
   if (msgObj.group == message_group::Warning || msgObj.group == message_group::Error || msgObj.group == message_group::Trace) {
     size_t i;
     for (i = 0; i < lastmessages.size(); ++i) {
@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+#
+# Tests exporting animation frames with several worker processes
+#
+# Usage: animate_jobs_test.py --openscad=<binary> [--frames=N] [--jobs=N] <file.scad> [openscad args]
+#
+# Exports all frames of the given file once in order and once with worker
+# processes, and checks that both runs write the same frames and a valid
+# summary file.
+#
+# Returns 0 on success, 1 on failure
+#
+
+import argparse
+import filecmp
+import json
+import os
+import sys
+import tempfile
+
+from script_test_utils import run_openscad
+
+
+def export(openscad, scadfile, outdir, frames, jobs, extra_args):
+    os.makedirs(outdir)
+    summary = os.path.join(outdir, "summary.json")
+    result = run_openscad(openscad, scadfile, os.path.join(outdir, "frame.off"),
+                          ["--animate=%d" % frames, "--animate-jobs=%d" % jobs, "--summary=all",
+                           "--summary-file=" + summary] + extra_args)
+    if result.returncode != 0:
+        return None
+    with open(summary) as f:
+        json.load(f)
+    return sorted(name for name in os.listdir(outdir) if name != "summary.json")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Test --animate-jobs")
+    parser.add_argument("--openscad", required=True, help="OpenSCAD binary")
+    parser.add_argument("--frames", type=int, default=6, help="number of frames")
+    parser.add_argument("--jobs", type=int, default=3, help="number of worker processes")
+    parser.add_argument("scadfile")
+    options, extra_args = parser.parse_known_args()
+
+    with tempfile.TemporaryDirectory(prefix="openscad-animate-") as workdir:
+        serial = os.path.join(workdir, "serial")
+        parallel = os.path.join(workdir, "parallel")
+        expected = export(options.openscad, options.scadfile, serial, options.frames, 1, extra_args)
+        actual = export(options.openscad, options.scadfile, parallel, options.frames, options.jobs, extra_args)
+        if expected is None or actual is None:
+            print("Export failed")
+            return 1
+        if len(expected) != options.frames or actual != expected:
+            print("Frames differ: %s != %s" % (actual, expected))
+            return 1
+        match, mismatch, errors = filecmp.cmpfiles(serial, parallel, expected, shallow=False)
+        if mismatch or errors:
+            print("Frame contents differ: %s" % (mismatch + errors))
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
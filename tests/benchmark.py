@@ -0,0 +1,248 @@
+#!/usr/bin/env python3
+#
+# Benchmark driver for the openscad-bench target
+#
+# Usage: benchmark.py --openscad=<binary> [--output=results.json] [--baseline=baseline.json]
+#                     [--repeat=N] [--filter=regex] [--tolerance=0.1] [--fail-on-regression]
+#
+# Runs each benchmark case N times with the given OpenSCAD binary and writes the
+# minimum and median wall clock time (and the rendering time reported by
+# --summary, where available) to a JSON file. If a baseline JSON file from an
+# earlier run is given, the medians are compared against it.
+#
+# The micro/ cases each exercise a single hot path. Their results also hold
+# the median net of micro/startup, the time of starting OpenSCAD on a trivial
+# file, so they can be compared across machines with different start up times.
+#
+# Returns 0 on success
+#         1 if --fail-on-regression is given and a case got slower than the tolerance
+#         2 on invalid cmd-line options
+#
+
+import argparse
+import datetime
+import json
+import os
+import re
+import statistics
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+BENCH_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "data", "scad", "bench")
+
+# name, input file (relative to BENCH_DIR), output suffix, extra arguments, required feature
+CASES = [
+    ("micro/startup",                  "micro/startup.scad",                  "echo", [], None),
+    ("micro/packed-vector-arithmetic", "micro/packed-vector-arithmetic.scad", "echo", [], None),
+    ("micro/vector-access",            "micro/vector-access.scad",            "echo", [], None),
+    ("micro/variable-lookup",          "micro/variable-lookup.scad",          "echo", [], None),
+    ("parse/large-file",           "@large-file",              "ast",  [], None),
+    ("eval/list-comprehension",    "list-comprehension.scad",  "echo", [], None),
+    ("eval/recursion",             "recursion.scad",           "echo", [], None),
+    ("eval/recursion-vm",          "recursion.scad",           "echo", ["--enable=function-vm"], "function-vm"),
+    ("polyset/primitives",         "primitives.scad",          "off",  [], None),
+    ("csg/union-spheres-cgal",     "union-spheres.scad",       "off",  [], None),
+    ("csg/union-spheres-fast-csg", "union-spheres.scad",       "off",  ["--enable=fast-csg"], "fast-csg"),
+    ("csg/union-spheres-manifold", "union-spheres.scad",       "off",  ["--enable=manifold"], "manifold"),
+    ("csg/minkowski",              "minkowski.scad",           "off",  [], None),
+    ("csg/hull",                   "hull.scad",                "off",  [], None),
+    ("extrude/linear-rotate",      "extrude.scad",             "off",  [], None),
+    ("export/stl",                 "primitives.scad",          "stl",  [], None),
+    ("export/3mf",                 "primitives.scad",          "3mf",  [], None),
+    ("export/off",                 "primitives.scad",          "off",  [], None),
+    ("import/stl-ascii",           "@import-stl",              "off",  [], None),
+    ("import/stl-binary",          "@import-binstl",           "off",  [], None),
+    ("import/obj",                 "@import-obj",              "off",  [], None),
+]
+
+
+def generate_large_file(path, modules=2000):
+    """Writes a large, syntactically varied file for parser and AST benchmarks."""
+    with open(path, "w") as f:
+        for i in range(modules):
+            f.write("function f%d(x, y = %d) = let(z = x * y + %d) [for (i = [0:z %% 5]) i * %d.5] ;\n" % (i, i, i, i))
+            f.write("module m%d(size = [%d, %d, %d]) {\n" % (i, i, i + 1, i + 2))
+            f.write("  if (size[0] > %d) translate([%d, 0, 0]) cube(size); else m%d(size + [1, 1, 1]);\n" % (i, i, max(i - 1, 0)))
+            f.write("  echo(str(\"module %d\", f%d(%d)));\n" % (i, i, i))
+            f.write("}\n")
+        f.write("echo(f%d(1));\n" % (modules - 1))
+
+
+def generate_mesh_import(path, suffix, size=300, binary=False):
+    """Writes a scanned-mesh sized STL or OBJ height field and a file importing it."""
+    def height(x, y):
+        return 0.1 * ((x * 7 + y * 13) % 17) + x * 0.001234567 - y * 0.000765432
+
+    def triangles():
+        for x in range(size):
+            for y in range(size):
+                quad = [(x, y), (x + 1, y), (x + 1, y + 1), (x, y + 1)]
+                for tri in ((0, 1, 2), (0, 2, 3)):
+                    yield [(quad[i][0], quad[i][1], height(*quad[i])) for i in tri]
+
+    mesh = os.path.splitext(path)[0] + "." + suffix
+    if binary:
+        with open(mesh, "wb") as f:
+            f.write(b"OpenSCAD benchmark".ljust(80, b" "))
+            f.write(struct.pack("<I", 2 * size * size))
+            for tri in triangles():
+                f.write(struct.pack("<12fH", 0.0, 0.0, 1.0, *(c for v in tri for c in v), 0))
+    elif suffix == "stl":
+        with open(mesh, "w") as f:
+            f.write("solid bench\n")
+            for tri in triangles():
+                f.write("  facet normal 0 0 1\n    outer loop\n")
+                for v in tri:
+                    f.write("      vertex %.6e %.6e %.6e\n" % v)
+                f.write("    endloop\n  endfacet\n")
+            f.write("endsolid bench\n")
+    else:
+        with open(mesh, "w") as f:
+            for x in range(size + 1):
+                for y in range(size + 1):
+                    f.write("v %.6f %.6f %.6f\n" % (x, y, height(x, y)))
+            for x in range(size):
+                for y in range(size):
+                    i = x * (size + 1) + y + 1
+                    f.write("f %d %d %d\nf %d %d %d\n" % (i, i + size + 1, i + size + 2, i, i + size + 2, i + 1))
+    with open(path, "w") as f:
+        f.write("import(\"%s\");\n" % os.path.basename(mesh))
+
+
+def available_features(openscad):
+    """Returns the experimental features known to the binary, as listed by --help."""
+    result = subprocess.run([openscad, "--help"], stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                            universal_newlines=True)
+    match = re.search(r"--enable arg[^:]*:(.*?)\n\s*-", result.stdout, re.S)
+    return set(re.findall(r"[\w-]+", match.group(1))) if match else set()
+
+
+def run_case(openscad, infile, suffix, args, workdir, repeat):
+    outfile = os.path.join(workdir, "out." + suffix)
+    summaryfile = os.path.join(workdir, "summary.json")
+    cmd = [openscad, infile, "-o", outfile, "--summary=time", "--summary-file=" + summaryfile] + args
+    wall, render = [], []
+    for _ in range(repeat):
+        if os.path.exists(summaryfile):
+            os.remove(summaryfile)
+        start = time.perf_counter()
+        result = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+        elapsed = time.perf_counter() - start
+        if result.returncode != 0:
+            return {"error": result.stderr.strip().splitlines()[-1:] or "exit code %d" % result.returncode}
+        wall.append(elapsed * 1000.0)
+        try:
+            with open(summaryfile) as f:
+                render.append(json.load(f)["time"]["total"])
+        except (OSError, ValueError, KeyError):
+            pass
+    entry = {"wall_ms": summarize(wall)}
+    if len(render) == len(wall):
+        entry["render_ms"] = summarize(render)
+    return entry
+
+
+def summarize(samples):
+    return {"min": min(samples), "median": statistics.median(samples), "runs": samples}
+
+
+def compare(results, baseline, tolerance):
+    """Prints a comparison table and returns the names of regressed cases."""
+    regressions = []
+    print("\n%-30s %12s %12s %8s" % ("benchmark", "baseline ms", "current ms", "change"))
+    for name, entry in results.items():
+        base = baseline.get("results", {}).get(name)
+        if "wall_ms" not in entry or not base or "wall_ms" not in base:
+            continue
+        old, new = base["wall_ms"]["median"], entry["wall_ms"]["median"]
+        change = (new - old) / old if old > 0 else 0.0
+        status = ""
+        if change > tolerance:
+            status = "  REGRESSION"
+            regressions.append(name)
+        elif change < -tolerance:
+            status = "  improved"
+        print("%-30s %12.1f %12.1f %+7.1f%%%s" % (name, old, new, change * 100, status))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run OpenSCAD benchmarks")
+    parser.add_argument("--openscad", required=True, help="OpenSCAD binary to benchmark")
+    parser.add_argument("--output", default="bench-results.json", help="JSON file to write results to")
+    parser.add_argument("--baseline", help="JSON results of an earlier run to compare against")
+    parser.add_argument("--repeat", type=int, default=5, help="number of runs per case")
+    parser.add_argument("--filter", default="", help="only run cases matching this regex")
+    parser.add_argument("--tolerance", type=float, default=0.10, help="relative change reported as regression")
+    parser.add_argument("--fail-on-regression", action="store_true", help="exit with 1 on regressions")
+    options = parser.parse_args()
+
+    if not os.path.isfile(options.openscad):
+        print("OpenSCAD binary not found: %s" % options.openscad, file=sys.stderr)
+        return 2
+
+    features = available_features(options.openscad)
+    version = subprocess.run([options.openscad, "--version"], stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                             universal_newlines=True).stdout.strip()
+    results = {}
+    with tempfile.TemporaryDirectory(prefix="openscad-bench-") as workdir:
+        # Generated inputs are only written when a selected case needs them
+        generators = {
+            "@large-file": ("large-file.scad", generate_large_file),
+            "@import-stl": ("import-stl.scad", lambda path: generate_mesh_import(path, "stl")),
+            "@import-binstl": ("import-binstl.scad",
+                               lambda path: generate_mesh_import(path, "stl", size=1000, binary=True)),
+            "@import-obj": ("import-obj.scad", lambda path: generate_mesh_import(path, "obj")),
+        }
+        generated = {}
+        for name, infile, suffix, args, feature in CASES:
+            if not re.search(options.filter, name):
+                continue
+            if feature and feature not in features:
+                results[name] = {"skipped": "feature '%s' not available" % feature}
+                print("%-30s skipped" % name)
+                continue
+            if infile in generators:
+                if infile not in generated:
+                    filename, generate = generators[infile]
+                    generated[infile] = os.path.join(workdir, filename)
+                    generate(generated[infile])
+                path = generated[infile]
+            else:
+                path = os.path.join(BENCH_DIR, infile)
+            results[name] = run_case(options.openscad, path, suffix, args, workdir, options.repeat)
+            startup = results.get("micro/startup", {}).get("wall_ms")
+            if name.startswith("micro/") and name != "micro/startup" and startup and "wall_ms" in results[name]:
+                results[name]["net_ms"] = results[name]["wall_ms"]["median"] - startup["median"]
+            if "net_ms" in results[name]:
+                print("%-30s %10.1f ms (%.1f ms net)" % (name, results[name]["wall_ms"]["median"], results[name]["net_ms"]))
+            elif "wall_ms" in results[name]:
+                print("%-30s %10.1f ms" % (name, results[name]["wall_ms"]["median"]))
+            else:
+                print("%-30s failed: %s" % (name, results[name]["error"]))
+
+    output = {
+        "version": version,
+        "date": datetime.datetime.now().isoformat(timespec="seconds"),
+        "repeat": options.repeat,
+        "results": results,
+    }
+    outdir = os.path.dirname(os.path.abspath(options.output))
+    os.makedirs(outdir, exist_ok=True)
+    with open(options.output, "w") as f:
+        json.dump(output, f, indent=2)
+    print("\nResults written to %s" % options.output)
+
+    if options.baseline:
+        with open(options.baseline) as f:
+            regressions = compare(results, json.load(f), options.tolerance)
+        if regressions and options.fail_on_regression:
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,30 @@
+#!/usr/bin/env python3
+#
+# Records the boolean operations avoided by bounding box culling
+#
+# Usage: culling_test.py <file.scad> --openscad=<binary> [openscad args] <outputfile>
+#
+# Exports two animation frames of the given file with a summary file, and
+# writes the culled operation counts of the summary, which is the one of the
+# last frame, to outputfile for comparison with the expected output by
+# test_cmdline_tool.py. Files whose geometry depends on $t thus check that the
+# counts are per render and not accumulated over frames.
+#
+# Returns 0 if the summary could be read, 1 otherwise
+#
+
+import os
+
+from script_test_utils import export, main, read_json
+
+
+def test(scadfile, openscad, args, values, workdir):
+    summary = os.path.join(workdir, "summary.json")
+    export(openscad, scadfile, os.path.join(workdir, "frame.off"),
+           ["--animate=2", "--summary=cache", "--summary-file=" + summary] + args)
+    culled = read_json(summary, "cache", "culled_operations")
+    return ["%s = %d" % (key, culled[key]) for key in ("unions", "differences", "intersections")]
+
+
+if __name__ == "__main__":
+    main(test)
@@ -0,0 +1,30 @@
+#!/usr/bin/env python3
+#
+# Records the warnings and errors of rendering a file, for import tests
+#
+# Usage: import_log_test.py <file.scad> --openscad=<binary> [openscad args] <outputfile>
+#
+# Renders the given file to OFF and writes the WARNING and ERROR lines logged
+# by OpenSCAD to outputfile, with directories stripped from file names, for
+# comparison with the expected output by test_cmdline_tool.py.
+#
+# Returns 0 if OpenSCAD could be run, 1 otherwise
+#
+
+import os
+import re
+import subprocess
+
+from script_test_utils import main, run_openscad
+
+
+def test(scadfile, openscad, args, values, workdir):
+    result = run_openscad(openscad, scadfile, os.path.join(workdir, "out.off"), args,
+                          stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    # Paths depend on the build and source directories
+    return [re.sub(r"[^\s'\"]*[/\\]([^/\\\s'\",]+)", r"\1", line) for line in result.stdout.splitlines()
+            if line.startswith("WARNING:") or line.startswith("ERROR:")]
+
+
+if __name__ == "__main__":
+    main(test)
@@ -0,0 +1,34 @@
+#!/usr/bin/env python3
+#
+# Records which nodes the geometry evaluation takes from the cache
+#
+# Usage: profile_cache_test.py <file.scad> --openscad=<binary> [--node=<name>] [openscad args] <outputfile>
+#
+# Renders the given file serially with a profile, and writes the name,
+# location and cache annotation of every geometry node, or only of the nodes
+# named by --node, in order of evaluation to outputfile for comparison with
+# the expected output by test_cmdline_tool.py.
+#
+# Returns 0 if the profile could be read, 1 otherwise
+#
+
+import os
+
+from script_test_utils import export, main, read_json
+
+
+def test(scadfile, openscad, args, values, workdir):
+    profile = os.path.join(workdir, "profile.json")
+    # Concurrent subtrees could both miss the cache for identical nodes
+    export(openscad, scadfile, os.path.join(workdir, "out.off"), ["--profile=" + profile] + args,
+           env=dict(os.environ, OPENSCAD_NO_PARALLEL="1"))
+    nodes = values["node"]
+    events = [event for event in read_json(profile, "traceEvents")
+              if event["cat"] == "geometry" and "cache" in event["args"] and (not nodes or event["name"] in nodes)]
+    events.sort(key=lambda event: event["ts"])
+    return ["%s %s cache=%s" % (event["name"], event["args"].get("location", "-"), event["args"]["cache"])
+            for event in events]
+
+
+if __name__ == "__main__":
+    main(test, options=["node"])
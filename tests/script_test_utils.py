@@ -0,0 +1,77 @@
+#
+# Shared parts of the test scripts which test_cmdline_tool.py runs as
+#
+#   <script> <file.scad> --openscad=<binary> [script options] [openscad args] <outputfile>
+#
+# and whose outputfile it compares with the expected output. A script defines
+# the test itself and passes it to main().
+#
+
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+
+class TestFailure(Exception):
+    pass
+
+
+def run_openscad(openscad, scadfile, outfile, args, **kwargs):
+    """Runs OpenSCAD on scadfile exporting to outfile, and returns the CompletedProcess."""
+    cmd = [openscad, scadfile, "-o", outfile] + args
+    print(" ".join(cmd))
+    sys.stdout.flush()
+    return subprocess.run(cmd, **kwargs)
+
+
+def export(openscad, scadfile, outfile, args, **kwargs):
+    """Like run_openscad(), but fails the test if OpenSCAD fails."""
+    if run_openscad(openscad, scadfile, outfile, args, **kwargs).returncode != 0:
+        raise TestFailure("OpenSCAD failed exporting %s" % os.path.basename(outfile))
+
+
+def read_json(filename, *keys):
+    """Returns the value at keys in the JSON file."""
+    try:
+        with open(filename) as f:
+            value = json.load(f)
+        for key in keys:
+            value = value[key]
+    except (OSError, ValueError, KeyError) as e:
+        raise TestFailure("Can't read %s from %s: %s" % ("/".join(keys) or "JSON", os.path.basename(filename), e))
+    return value
+
+
+def main(test, options=()):
+    """Runs test from the command line and exits with 0 on success, 1 otherwise.
+
+    test(scadfile, openscad, args, values, workdir) returns the lines to write
+    to outputfile, or raises TestFailure. values maps each of options, e.g.
+    "node" for --node=<name>, to the list of its values. workdir is a
+    temporary directory which is removed afterwards.
+    """
+    script = os.path.basename(sys.argv[0])
+    prefixes = ["--openscad="] + ["--%s=" % option for option in options]
+    values = {prefix: [arg[len(prefix):] for arg in sys.argv[2:-1] if arg.startswith(prefix)] for prefix in prefixes}
+    if len(sys.argv) < 4 or len(values["--openscad="]) != 1:
+        print("Usage: %s <file.scad> --openscad=<binary> %s[openscad args] <outputfile>" %
+              (script, "".join("[--%s=<%s>] " % (option, option) for option in options)), file=sys.stderr)
+        sys.exit(1)
+    scadfile = sys.argv[1]
+    openscad = values["--openscad="][0]
+    args = [arg for arg in sys.argv[2:-1] if not any(arg.startswith(prefix) for prefix in prefixes)]
+    outputfile = sys.argv[-1]
+
+    prefix = "openscad-%s-" % script.replace("_test.py", "").replace("_", "")
+    try:
+        with tempfile.TemporaryDirectory(prefix=prefix) as workdir:
+            lines = test(scadfile, openscad, args, {option: values["--%s=" % option] for option in options}, workdir)
+    except TestFailure as e:
+        print("%s: %s" % (script, e), file=sys.stderr)
+        sys.exit(1)
+    with open(outputfile, "w") as f:
+        for line in lines:
+            f.write(line + "\n")
+    sys.exit(0)
@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+#
+# Lists the facets of the binary and ASCII STL export of a file, for
+# regression tests of degenerate facets and their normals
+#
+# Usage: stl_facets_test.py <file.scad> --openscad=<binary> [openscad args] <outputfile>
+#
+# Exports the given file as binary and as ASCII STL and writes the normal and
+# vertices of every facet to outputfile, for comparison with the expected
+# output by test_cmdline_tool.py. Binary files must consist of whole 50 byte
+# facets matching the facet count in the header, and normals must be finite.
+#
+# Returns 0 if both exports are well-formed, 1 otherwise
+#
+
+import math
+import os
+import struct
+
+from script_test_utils import TestFailure, export, main
+
+
+def format_vector(v):
+    # Adding 0.0 turns -0 into 0
+    return " ".join("%g" % (x + 0.0) for x in v)
+
+
+def read_binary_stl(filename):
+    with open(filename, "rb") as f:
+        data = f.read()
+    if len(data) < 84:
+        raise ValueError("binary STL is truncated")
+    count = struct.unpack("<I", data[80:84])[0]
+    if len(data) != 84 + 50 * count:
+        raise ValueError("binary STL has %d bytes for %d facets" % (len(data), count))
+    facets = []
+    for offset in range(84, len(data), 50):
+        values = struct.unpack("<12f", data[offset:offset + 48])
+        facets.append([values[i:i + 3] for i in range(0, 12, 3)])
+    return facets
+
+
+def read_ascii_stl(filename):
+    facets = []
+    with open(filename, "r") as f:
+        for line in f:
+            words = line.split()
+            if words[:2] == ["facet", "normal"]:
+                facets.append([tuple(float(x) for x in words[2:5])])
+            elif words[:1] == ["vertex"]:
+                facets[-1].append(tuple(float(x) for x in words[1:4]))
+    return facets
+
+
+def test(scadfile, openscad, args, values, workdir):
+    lines = []
+    for export_format, read in (("binstl", read_binary_stl), ("asciistl", read_ascii_stl)):
+        stlfile = os.path.join(workdir, "out.stl")
+        export(openscad, scadfile, stlfile, ["--export-format", export_format] + args)
+        try:
+            facets = read(stlfile)
+        except ValueError as e:
+            raise TestFailure("%s: %s" % (export_format, e))
+        lines.append("%s: %d facets" % (export_format, len(facets)))
+        for facet in facets:
+            if not all(math.isfinite(x) for x in facet[0]):
+                raise TestFailure("%s: facet normal is not finite" % export_format)
+            lines.append("normal %s vertices %s" % (format_vector(facet[0]),
+                                                    ", ".join(format_vector(v) for v in facet[1:])))
+    return lines
+
+
+if __name__ == "__main__":
+    main(test)
@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+#
+# Checks that the surface-decimation feature keeps the shape of heightmaps
+#
+# Usage: surface_decimation_test.py <file.scad> --openscad=<binary> [openscad args] <outputfile>
+#
+# Exports the given file as binary STL with and without surface-decimation,
+# and writes the bounds and volume of the decimated export to outputfile for
+# comparison with the expected output by test_cmdline_tool.py. Both exports
+# must have the same bounds and volume, and the decimated one may not have
+# more facets.
+#
+# Returns 0 if both exports match, 1 otherwise
+#
+
+import os
+
+from script_test_utils import TestFailure, export, main
+from stl_facets_test import format_vector, read_binary_stl
+
+
+def measure(facets):
+    volume = 0.0
+    for _, a, b, c in facets:
+        volume += (a[0] * (b[1] * c[2] - b[2] * c[1]) + a[1] * (b[2] * c[0] - b[0] * c[2]) +
+                   a[2] * (b[0] * c[1] - b[1] * c[0])) / 6
+    points = [v for facet in facets for v in facet[1:]]
+    bounds = [tuple(f(v[i] for v in points) for i in range(3)) for f in (min, max)] if points else []
+    return bounds, volume
+
+
+def test(scadfile, openscad, args, values, workdir):
+    exports = {}
+    for name, feature in (("full", []), ("decimated", ["--enable=surface-decimation"])):
+        stlfile = os.path.join(workdir, name + ".stl")
+        export(openscad, scadfile, stlfile, ["--export-format", "binstl"] + feature + args)
+        try:
+            exports[name] = read_binary_stl(stlfile)
+        except ValueError as e:
+            raise TestFailure("%s: %s" % (name, e))
+
+    bounds, volume = measure(exports["decimated"])
+    full_bounds, full_volume = measure(exports["full"])
+    # Binary STL stores single precision floats
+    if bounds != full_bounds or abs(volume - full_volume) > 1e-4 * max(1.0, abs(full_volume)):
+        raise TestFailure("decimated bounds %s and volume %g differ from %s and %g" %
+                          (bounds, volume, full_bounds, full_volume))
+    if len(exports["decimated"]) > len(exports["full"]):
+        raise TestFailure("decimated export has %d facets, more than %d" %
+                          (len(exports["decimated"]), len(exports["full"])))
+    return ["bounds %s" % ", ".join(format_vector(v) for v in bounds), "volume %g" % volume]
+
+
+if __name__ == "__main__":
+    main(test)
@@ -0,0 +1,55 @@
+#include "IncrementalInstantiation.h"
+#include "InstantiationCache.h"
+#include "SourceFile.h"
+#include "openscad.h"
+#include "printutils.h"
+
+#include <fstream>
+#include <iterator>
+
+namespace fs = boost::filesystem;
+
+namespace TestHooks {
+
+namespace {
+
+bool readText(const fs::path& path, std::string& text)
+{
+  std::ifstream ifs(path.string());
+  if (!ifs.is_open()) {
+    LOG("Can't open input file '%1$s'!\n", path.generic_string());
+    return false;
+  }
+  text = std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+  text += "\n\x03\n" + commandline_commands;
+  return true;
+}
+
+} // namespace
+
+std::shared_ptr<AbstractNode> instantiateAfterPreviousVersion(
+  const fs::path& previous_path, const fs::path& path, const std::string& inputs,
+  SourceFile *root_file, const std::shared_ptr<const Context>& context, InstantiationCache& cache,
+  std::shared_ptr<const FileContext> *file_context)
+{
+  std::string previous_text, text;
+  if (!readText(previous_path, previous_text) || !readText(path, text)) return nullptr;
+  const auto filename = path.generic_string();
+  SourceFile *previous_file = nullptr;
+  if (!parse(previous_file, previous_text, filename, filename, false)) {
+    delete previous_file;
+    LOG("Can't parse file '%1$s'!\n", previous_path.generic_string());
+    return nullptr;
+  }
+  previous_file->handleDependencies();
+
+  // root_file lives until exit, the cache keeps the previous version alive
+  const std::shared_ptr<const SourceFile> root{root_file, [](const SourceFile *) {}};
+  std::shared_ptr<const FileContext> previous_context;
+  cache.instantiate(std::shared_ptr<const SourceFile>(previous_file), previous_text, inputs, context, &previous_context);
+  auto node = cache.instantiate(root, text, inputs, context, file_context);
+  LOG("Reused %1$d and instantiated %2$d top level objects.", cache.reusedCount(), cache.instantiatedCount());
+  return node;
+}
+
+} // namespace TestHooks
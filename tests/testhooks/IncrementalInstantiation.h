@@ -0,0 +1,31 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <boost/filesystem.hpp>
+
+class AbstractNode;
+class Context;
+class FileContext;
+class InstantiationCache;
+class SourceFile;
+
+/*!
+   Test hooks of the openscad binary, only built with ENABLE_TESTS.
+ */
+namespace TestHooks {
+
+/*!
+   Implements --previous-version: instantiates the file at previous_path and
+   then root_file, read from path, through cache, like the GUI does when
+   recompiling with incremental evaluation, so tests can check which top level
+   objects are reused. Both files are read with the command line assignments
+   appended, and the previous version is parsed as if it was the input file.
+   inputs are the render variables the cache compares between versions.
+ */
+std::shared_ptr<AbstractNode> instantiateAfterPreviousVersion(
+  const boost::filesystem::path& previous_path, const boost::filesystem::path& path, const std::string& inputs,
+  SourceFile *root_file, const std::shared_ptr<const Context>& context, InstantiationCache& cache,
+  std::shared_ptr<const FileContext> *file_context);
+
+} // namespace TestHooks